@@ -18,7 +18,6 @@ typedef uint16_t Value;
 
 // #define CORE_DECOMPOSITION 
 // -------------------- index construction ------------------------------------
-#define MAX_SAMPLE_NUM 20000
 
 // AVX instructions are used to optimize the index construction/validation as well as the subgraph enumeration algorithm
 // 0 stands for no optimization; 1; 2 for AVX512
@@ -27,9 +26,15 @@ typedef uint16_t Value;
 #define HYBRID 0 // related to the intersection operation using AVX
 
 // comment to disable OVERFLOW_CHECK. When the frequencies/supports are recorded by 16-bit short integers, it is likely to be overflow
-// during the counting process. Turn on the OVERFLOW_CHECK mechanism at a cost of index construction speed.
+// during the counting process. Turn on the OVERFLOW_CHECK mechanism to saturate the counts at the largest Value instead;
+// the vector additions then use the saturating adds of AVX-512BW/AVX2 when compiled with -march=native, the scalar
+// fallback costs some index construction speed.
 #define OVERFLOW_CHECK 0
 
+// graphs per thread that the threads of a graph database build may count ahead of the index writer,
+// which bounds the counted tensors waiting in memory
+#define DATABASE_WINDOW_PER_THREAD 4
+
 // ------------------ subgraph enumeration/retrieval --------------------------
 #define MAX_QUERY_SIZE 60
 
@@ -7,6 +7,7 @@ Graph::Graph(vector<vector<Vertex> >& adj_, vector<Label>& label_map_){
         copy(it->begin(), it->end(), inserter(tail, tail.begin()));
     }
     common_edge_neighbor = NULL;
+    common_edge_neighbor_data = NULL;
     copy(label_map_.begin(), label_map_.end(), inserter(label_map, label_map.begin()));
 }
 
@@ -17,11 +18,13 @@ Graph::Graph(vector<unordered_set<Vertex> >& adj_, vector<Label>& label_map_){
         copy(it->begin(), it->end(), inserter(tail, tail.begin()));
     }
     common_edge_neighbor = NULL;
+    common_edge_neighbor_data = NULL;
     copy(label_map_.begin(), label_map_.end(), inserter(label_map, label_map.begin()));
 }
 
 Graph::Graph(string filename){
     common_edge_neighbor = NULL;
+    common_edge_neighbor_data = NULL;
     string line;
     ifstream in(filename);
     unordered_map<Vertex, Label> label_map_unordered;
@@ -60,7 +63,7 @@ Graph::Graph(string filename){
     }
 }
 
-Graph::Graph(){common_edge_neighbor = NULL;};
+Graph::Graph(){common_edge_neighbor = NULL; common_edge_neighbor_data = NULL;};
 
 Vertex Graph::get_edge_count(){
     if(edge_count == 0){
@@ -97,58 +100,209 @@ void Graph::set_up_edge_id_map(){
     }
 }
 
-void Graph::construct_edge_common_neighbor(){
+// adjacency of the edge common neighbor construction: the neighbors of v sorted ascendingly in
+// neighbors[offsets[v], offsets[v+1]), with the id of the connecting edge at the same position of edge_ids
+struct common_neighbor_task{
+    Graph* graph;
+    vector<size_t>* offsets;
+    vector<Vertex>* neighbors;
+    vector<Vertex>* edge_ids;
+    Vertex begin; // edges [begin, end)
+    Vertex end;
+};
+
+// first pass (graph->common_edge_neighbor == NULL): the size of every list, stored in
+// common_edge_neighbor_offsets[e_id+1]; second pass: the lists themselves
+static void* compute_common_neighbor_func(void* arg){
+    common_neighbor_task& task = *((common_neighbor_task*)arg);
+    Graph* graph = task.graph;
+    vector<size_t>& offsets = *task.offsets;
+    vector<Vertex>& neighbors = *task.neighbors;
+    vector<Vertex>& edge_ids = *task.edge_ids;
+    bool fill = (graph->common_edge_neighbor != NULL);
+    for(Vertex e_id=task.begin; e_id<task.end; ++e_id){
+        Vertex v = graph->edge_set[e_id*2];
+        Vertex n = graph->edge_set[e_id*2+1];
+        size_t i = offsets[v], i_end = offsets[v+1];
+        size_t j = offsets[n], j_end = offsets[n+1];
+        Vertex* vec = fill ? graph->common_edge_neighbor[e_id] : NULL;
+        Vertex count = 0;
+        while(i<i_end && j<j_end){
+            if(neighbors[i] < neighbors[j]){
+                ++i;
+            }else if(neighbors[i] > neighbors[j]){
+                ++j;
+            }else{
+                if(fill){
+                    // the neighbor, the e_id connecting the source vertex and the e_id connecting the target vertex
+                    vec[count*3+1] = neighbors[i];
+                    vec[count*3+2] = edge_ids[i];
+                    vec[count*3+3] = edge_ids[j];
+                }
+                count ++;
+                ++i;
+                ++j;
+            }
+        }
+        if(fill){
+            vec[0] = count;
+        }else{
+            graph->common_edge_neighbor_offsets[e_id+1] = 3*count+1;
+        }
+    }
+    return NULL;
+}
+
+static void run_common_neighbor_tasks(vector<common_neighbor_task>& tasks){
+    if(tasks.size() == 1){
+        compute_common_neighbor_func((void*)&tasks[0]);
+        return;
+    }
+    pthread_t* threads = new pthread_t [tasks.size()];
+    for(int i=0;i<tasks.size();++i){
+        int res = pthread_create(&(threads[i]), NULL, compute_common_neighbor_func, (void*)&tasks[i]);
+        if(res != 0){
+            cout<<"Create thread:"<<i<<" failed for common neighbor computation"<<endl;
+            exit(res);
+        }
+    }
+    for(int i=0;i<tasks.size();++i){
+        void* ret;
+        pthread_join(threads[i], &ret);
+    }
+    delete [] threads;
+}
+
+// The lists are intersections of sorted adjacency lists. A first pass counts the common neighbors
+// of every edge, so all lists are laid out back to back in one exactly sized array, which a second
+// pass fills; the edges are split evenly over the threads in the first pass and by list size in the
+// second one.
+void Graph::construct_edge_common_neighbor(int thread_num){
     set_up_edge_id_map();
     if(common_edge_neighbor != NULL){
         return;
     }
-    common_edge_neighbor = new Vertex* [get_edge_count()];
+    Vertex edge_count = get_edge_count();
+    vector<size_t> offsets(adj.size()+1, 0);
     for(Vertex v=0; v<adj.size(); ++v){
+        offsets[v+1] = offsets[v]+adj[v].size();
+    }
+    vector<Vertex> neighbors(offsets.back());
+    vector<Vertex> edge_ids(offsets.back());
+    // edge ids follow the order of set_up_edge_id_map, and the smaller neighbors of v come first in
+    // its sorted list, in the order they are visited here
+    vector<size_t> cursor(offsets.begin(), offsets.end()-1);
+    Vertex e_id = 0;
+    for(Vertex v=0; v<adj.size(); ++v){
+        size_t begin = cursor[v];
         for(auto n : adj[v]){
-            if(v < n){
-                Vertex e_id = edge_id_map[v][n];
-                common_edge_neighbor[e_id] = new Vertex [estimated_common_neighbor_count[e_id]*3+1];
-                Vertex* vec = common_edge_neighbor[e_id];
-                int offset = 1;
-                int count = 0;
-                for(auto v_n : adj[n]){
-                    if(v_n !=v && adj[v].find(v_n) != adj[v].end()){
-                        vec[offset++] = v_n;
-                        count++;
-                        // first push_back the e_id connecting source vertex
-                        if(v_n<v){
-                            // if(edge_id_map[v_n].find(v)==edge_id_map[v_n].end()){
-                            //     cout<<"Error1:"<<v_n<<" is not connected to "<<v<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v_n][v];
-                            // vec.push_back(edge_id_map[v_n][v]);
-                        }else{
-                            // if(edge_id_map[v].find(v_n)==edge_id_map[v].end()){
-                            //     cout<<"Error2:"<<v<<" is not connected to "<<v_n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v][v_n];
-                            // vec.push_back(edge_id_map[v][v_n]);
-                        }
-                        // second push_back the e_id connecting target vertex
-                        if(v_n<n){
-                            // if(edge_id_map[v_n].find(n)==edge_id_map[v_n].end()){
-                            //     cout<<"Error3:"<<v_n<<" is not connected to "<<n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v_n][n];
-                            // vec.push_back(edge_id_map[v_n][n]);
-                        }else{
-                            // if(edge_id_map[n].find(v_n)==edge_id_map[n].end()){
-                            //     cout<<"Error4:"<<n<<" is not connected to "<<v_n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[n][v_n];
-                            // vec.push_back(edge_id_map[n][v_n]);
-                        }
-                    }
+            if(n > v){
+                neighbors[cursor[v]++] = n;
+            }
+        }
+        sort(neighbors.begin()+begin, neighbors.begin()+cursor[v]);
+        for(size_t i=begin; i<cursor[v]; ++i){
+            Vertex n = neighbors[i];
+            edge_ids[i] = e_id;
+            neighbors[cursor[n]] = v;
+            edge_ids[cursor[n]] = e_id;
+            cursor[n] ++;
+            e_id ++;
+        }
+    }
+    thread_num = (thread_num < edge_count) ? thread_num : edge_count;
+    thread_num = (thread_num < 1) ? 1 : thread_num;
+    vector<common_neighbor_task> tasks(thread_num, {this, &offsets, &neighbors, &edge_ids, 0, 0});
+    for(int i=0;i<thread_num;++i){
+        tasks[i].begin = (uint64_t)edge_count*i/thread_num;
+        tasks[i].end = (uint64_t)edge_count*(i+1)/thread_num;
+    }
+    common_edge_neighbor_offsets.assign(edge_count+1, 0);
+    run_common_neighbor_tasks(tasks);
+    for(Vertex e=0; e<edge_count; ++e){
+        common_edge_neighbor_offsets[e+1] += common_edge_neighbor_offsets[e];
+    }
+
+    size_t total_size = common_edge_neighbor_offsets[edge_count];
+    common_edge_neighbor_data = new Vertex [total_size];
+    common_edge_neighbor = new Vertex* [edge_count];
+    for(Vertex e=0; e<edge_count; ++e){
+        common_edge_neighbor[e] = common_edge_neighbor_data+common_edge_neighbor_offsets[e];
+    }
+    Vertex e = 0;
+    for(int i=0;i<thread_num;++i){
+        tasks[i].begin = e;
+        while(e < edge_count && common_edge_neighbor_offsets[e] < total_size*(i+1)/thread_num){
+            e ++;
+        }
+        tasks[i].end = (i == thread_num-1) ? edge_count : e;
+    }
+    run_common_neighbor_tasks(tasks);
+}
+
+Graph* Graph::induced_ball(vector<Vertex>& sources, int radius, unordered_map<Vertex, Vertex>& local_id){
+    local_id.clear();
+    vector<Vertex> ball_vertices;
+    for(auto v : sources){
+        if(local_id.find(v) == local_id.end()){
+            local_id.insert({v, ball_vertices.size()});
+            ball_vertices.push_back(v);
+        }
+    }
+    // breadth first search, ball_vertices[frontier_begin, frontier_end) are at the current distance
+    size_t frontier_begin = 0;
+    for(int distance=0; distance<radius; ++distance){
+        size_t frontier_end = ball_vertices.size();
+        for(size_t i=frontier_begin; i<frontier_end; ++i){
+            for(auto n : adj[ball_vertices[i]]){
+                if(local_id.find(n) == local_id.end()){
+                    local_id.insert({n, ball_vertices.size()});
+                    ball_vertices.push_back(n);
                 }
-                vec[0] = count;
+            }
+        }
+        frontier_begin = frontier_end;
+    }
+    Graph* ball = new Graph();
+    ball->adj.resize(ball_vertices.size());
+    ball->label_map.resize(ball_vertices.size());
+    for(Vertex i=0; i<ball_vertices.size(); ++i){
+        ball->label_map[i] = label_map[ball_vertices[i]];
+        for(auto n : adj[ball_vertices[i]]){
+            auto iter = local_id.find(n);
+            if(iter != local_id.end()){
+                ball->adj[i].insert(iter->second);
             }
         }
     }
+    return ball;
+}
+
+// edge ids are assigned by the smaller end and then the larger one, so shifting the vertices of a
+// graph keeps its edges together and in the same order
+Graph* Graph::disjoint_union(vector<Graph>& graphs, vector<Vertex>& vertex_offsets, vector<Vertex>& edge_offsets){
+    vertex_offsets.assign(1, 0);
+    edge_offsets.assign(1, 0);
+    for(auto& graph : graphs){
+        vertex_offsets.push_back(vertex_offsets.back()+graph.label_map.size());
+        edge_offsets.push_back(edge_offsets.back()+graph.get_edge_count());
+    }
+    Graph* result = new Graph();
+    result->adj.resize(vertex_offsets.back());
+    result->label_map.resize(vertex_offsets.back());
+    for(int g=0; g<graphs.size(); ++g){
+        Graph& graph = graphs[g];
+        Vertex offset = vertex_offsets[g];
+        for(Vertex v=0; v<graph.label_map.size(); ++v){
+            result->label_map[offset+v] = graph.label_map[v];
+            unordered_set<Vertex>& neighbors = result->adj[offset+v];
+            neighbors.reserve(graph.adj[v].size());
+            for(auto n : graph.adj[v]){
+                neighbors.insert(offset+n);
+            }
+        }
+    }
+    return result;
 }
 
 void Graph::rebuild(vector<vector<Vertex> >& adj_, vector<Label>& label_map_){
@@ -231,9 +385,7 @@ void Graph::subiso_candidate_generate(Graph& query, vector<pair<Vertex, vector<V
 
 Graph::~Graph(){
     if(common_edge_neighbor!=NULL){
-        for(int i=0;i<get_edge_count();++i){
-            delete [] common_edge_neighbor[i];
-        }
+        delete [] common_edge_neighbor_data;
         delete [] common_edge_neighbor;
     }
 }
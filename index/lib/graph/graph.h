@@ -26,7 +26,11 @@ public:
     vector<Vertex> edge_set;
     Vertex edge_count = 0;
 
-    Vertex** common_edge_neighbor; // e_id -> list of neighbors
+    // e_id -> {count, (neighbor, e_id to the smaller end, e_id to the larger end)*}, pointing into
+    // common_edge_neighbor_data where the lists of all edges are stored back to back
+    Vertex** common_edge_neighbor;
+    Vertex* common_edge_neighbor_data;
+    vector<size_t> common_edge_neighbor_offsets;
 
     Graph(vector<vector<Vertex> >& adj_, vector<Label>& label_map_);
     Graph(vector<unordered_set<Vertex> >& adj_, vector<Label>& label_map_);
@@ -36,7 +40,14 @@ public:
     Vertex get_edge_count();
     void set_up_edge_id_map();
 
-    void construct_edge_common_neighbor();
+    void construct_edge_common_neighbor(int thread_num=1);
+
+    // the subgraph induced by the vertices within radius hops of sources; local_id maps the vertices
+    // of this graph to those of the subgraph
+    Graph* induced_ball(vector<Vertex>& sources, int radius, unordered_map<Vertex, Vertex>& local_id);
+    // the disjoint union of graphs: the vertices of graphs[g] are [vertex_offsets[g], vertex_offsets[g+1])
+    // and, once the edge ids are set up, its edges [edge_offsets[g], edge_offsets[g+1]) in their order
+    static Graph* disjoint_union(vector<Graph>& graphs, vector<Vertex>& vertex_offsets, vector<Vertex>& edge_offsets);
     void rebuild(vector<vector<Vertex> >& adj_, vector<Label>& label_map_);
 
     void print_graph();
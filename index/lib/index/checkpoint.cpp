@@ -0,0 +1,86 @@
+#include "checkpoint.h"
+
+Build_checkpoint::Build_checkpoint(string prefix_, bool resume){
+    prefix = prefix_;
+    manifest_file = prefix+string(".manifest");
+    if(!resume){
+        remove(manifest_file.c_str());
+        return;
+    }
+    ifstream fin(manifest_file);
+    string line;
+    while(getline(fin, line)){
+        stringstream ss(line);
+        string key, file;
+        uint64_t value;
+        // a line cut by a crash is ignored
+        if(ss>>key>>file>>hex>>value){
+            units[key] = {file, value};
+        }
+    }
+}
+
+string Build_checkpoint::unit_file(string key){
+    return prefix+string(".")+key;
+}
+
+bool Build_checkpoint::checksum(string file, uint64_t& result){
+    ifstream fin(file, ios::binary);
+    if(!fin.good()){
+        return false;
+    }
+    result = 14695981039346656037ULL;
+    vector<char> buffer(1<<20);
+    while(fin){
+        fin.read(&(buffer[0]), buffer.size());
+        streamsize size = fin.gcount();
+        for(streamsize i=0;i<size;++i){
+            result ^= (unsigned char)buffer[i];
+            result *= 1099511628211ULL;
+        }
+    }
+    return true;
+}
+
+bool Build_checkpoint::is_completed(string key, string file){
+    auto iter = units.find(scope+key);
+    if(iter == units.end() || iter->second.first != file){
+        return false;
+    }
+    uint64_t value;
+    if(!checksum(file, value) || value != iter->second.second){
+        cout<<"checkpoint of "<<scope+key<<" does not match "<<file<<", rebuilding it"<<endl;
+        return false;
+    }
+    return true;
+}
+
+void Build_checkpoint::complete(string key, string file){
+    int fd = open(file.c_str(), O_RDONLY);
+    if(fd < 0 || fsync(fd) != 0){
+        cout<<"cannot sync "<<file<<":"<<strerror(errno)<<endl;
+        exit(-1);
+    }
+    close(fd);
+    uint64_t value;
+    checksum(file, value);
+    units[scope+key] = {file, value};
+
+    stringstream line;
+    line<<scope+key<<" "<<file<<" "<<hex<<value<<"\n";
+    string content = line.str();
+    fd = open(manifest_file.c_str(), O_WRONLY|O_CREAT|O_APPEND, S_IRUSR|S_IWUSR);
+    if(fd < 0 || write(fd, content.c_str(), content.size()) != (ssize_t)content.size() || fsync(fd) != 0){
+        cout<<"cannot write the manifest "<<manifest_file<<":"<<strerror(errno)<<endl;
+        exit(-1);
+    }
+    close(fd);
+}
+
+void Build_checkpoint::finish(){
+    for(auto& unit : units){
+        remove(unit.second.first.c_str());
+    }
+    units.clear();
+    remove(manifest_file.c_str());
+}
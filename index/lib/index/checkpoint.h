@@ -0,0 +1,35 @@
+#pragma once
+#include <sys/stat.h>
+
+#include "../utility/utils.h"
+#include "../utility/embedding.h"
+
+/**
+ * Completed units of a build (feature selection rounds, batches of features) recorded in
+ * <prefix>.manifest, one "key file checksum" line per unit, appended and synced once the unit's file
+ * is synced. A resumed build skips a unit if it is recorded and its file still has the recorded
+ * checksum; a new build starts with an empty manifest.
+ */
+class Build_checkpoint{
+public:
+    string prefix;
+    string scope; // prepended to the keys, e.g., the graph being built
+
+    Build_checkpoint(string prefix_, bool resume);
+
+    // <prefix>.<key>, for units without a file of their own
+    string unit_file(string key);
+
+    bool is_completed(string key, string file);
+    void complete(string key, string file);
+
+    // removes the manifest and the files of the units
+    void finish();
+
+private:
+    string manifest_file;
+    unordered_map<string, pair<string, uint64_t>> units; // key -> file, checksum
+
+    // FNV-1a of the content, false if the file cannot be read
+    bool checksum(string file, uint64_t& result);
+};
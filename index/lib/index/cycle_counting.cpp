@@ -73,6 +73,7 @@ void Cycle_counter::feature_initialization(){
         }
         slot_labels.push_back(inner);
     }
+    trie = Suffix_trie(slot_labels);
 }
 
 void Cycle_counter::construct_mask_map(){
@@ -145,6 +146,64 @@ Tensor* Cycle_counter::merge_cycle_tensor_for_vertices(Graph& graph, Tensor* cyc
     return result;
 }
 
+void Cycle_counter::propagate(Graph& graph, int iteration, Tensor* tensor_prev, Tensor* tensor_prev_reverse, Tensor* tensor_cur, Tensor* tensor_cur_reverse){
+    unordered_map<Label, pair<int, int>>& label_range = trie.label_ranges[iteration];
+    int* parents = &(trie.parents[iteration][0]);
+    uint32_t edge_count = graph.get_edge_count();
+    Value** embeddings_prev = tensor_prev->content;
+    Value** embeddings_prev_reverse = tensor_prev_reverse->content;
+    for(Vertex e_id=0; e_id<edge_count; ++e_id){
+        Value* embedding_cur = tensor_cur->content[e_id];
+        Value* embedding_cur_reverse = tensor_cur_reverse->content[e_id];
+        Vertex small_id = graph.edge_set[e_id*2];
+        Vertex large_id = graph.edge_set[e_id*2+1];
+        Vertex* n_neighbors = graph.common_edge_neighbor[e_id];
+        Vertex neighbor_size = n_neighbors[0];
+        for(Vertex itr=0; itr<neighbor_size; ++itr){
+            Vertex n = n_neighbors[itr*3+1];
+            Vertex small_e_id = n_neighbors[itr*3+2];
+            Vertex large_e_id = n_neighbors[itr*3+3];
+            auto itf = label_range.find(graph.label_map[n]);
+            if(itf == label_range.end()){
+                continue;
+            }
+            int begin = itf->second.first;
+            int size = itf->second.second-begin;
+            Value* small_prev = (n<small_id) ? embeddings_prev[small_e_id] : embeddings_prev_reverse[small_e_id];
+            Value* large_prev = (n<large_id) ? embeddings_prev[large_e_id] : embeddings_prev_reverse[large_e_id];
+            Value* cur_reverse = embedding_cur_reverse+begin;
+            Value* cur = embedding_cur+begin;
+            vector_add_gather(cur_reverse, small_prev, parents+begin, size);
+            vector_add_gather(cur, large_prev, parents+begin, size);
+        }
+    }
+}
+
+Tensor* Cycle_counter::merge_states_for_edges(int iteration, Tensor* states, Tensor* reversed_states){
+    Tensor* cycles = trie.expand(states, iteration);
+    Tensor* reversed_cycles = trie.expand(reversed_states, iteration);
+    Tensor* result = merge_cycle_tensor_for_edges(cycles, reversed_cycles);
+    delete cycles;
+    delete reversed_cycles;
+    return result;
+}
+
+Tensor* Cycle_counter::merge_states_for_vertices(Graph& graph, int iteration, Tensor* states, Tensor* reversed_states){
+    Tensor* cycles;
+    Tensor* reversed_cycles;
+    if(iteration < 0){
+        cycles = new Tensor(states->row_size, extended_features.size(), 1);
+        reversed_cycles = new Tensor(states->row_size, extended_features.size(), 1);
+    }else{
+        cycles = trie.expand(states, iteration);
+        reversed_cycles = trie.expand(reversed_states, iteration);
+    }
+    Tensor* result = merge_cycle_tensor_for_vertices(graph, cycles, reversed_cycles, mask_maps[iteration+1]);
+    delete cycles;
+    delete reversed_cycles;
+    return result;
+}
+
 void Cycle_counter::count_for_vertices(Graph& graph, Tensor**& result, int& result_size){
 #ifdef ENABLE_TIME_INFO
     struct timeval start_t, end_t;
@@ -157,60 +216,27 @@ void Cycle_counter::count_for_vertices(Graph& graph, Tensor**& result, int& resu
     }
     result = new Tensor* [result_size];
     uint32_t edge_count = graph.get_edge_count();
-    Tensor* tensor_prev= new Tensor(edge_count, extended_features.size(), 1); // v<-n
-    Tensor* tensor_prev_reverse = new Tensor(edge_count, extended_features.size(), 1); // v->n
-    Tensor* tensor_cur = new Tensor(edge_count, extended_features.size(), 0);
-    Tensor* tensor_cur_reverse = new Tensor(edge_count, extended_features.size(), 0);
+    // the states of an iteration fill the first columns, those of the root (the first one) are ones
+    Tensor* tensor_prev= new Tensor(edge_count, trie.max_state_num(), 1); // v<-n
+    Tensor* tensor_prev_reverse = new Tensor(edge_count, trie.max_state_num(), 1); // v->n
+    Tensor* tensor_cur = new Tensor(edge_count, trie.max_state_num(), 0);
+    Tensor* tensor_cur_reverse = new Tensor(edge_count, trie.max_state_num(), 0);
     int total_iterations = original_features[0].size();
     int offset = 0;
     if(enable_residual || total_iterations == 1){
-        result[offset++] = merge_cycle_tensor_for_vertices(graph, tensor_prev, tensor_prev_reverse, mask_maps[0]);
+        result[offset++] = merge_states_for_vertices(graph, -1, tensor_prev, tensor_prev_reverse);
     }
     for(int iteration=0; iteration<total_iterations-1; ++iteration){
 #ifdef ENABLE_TIME_INFO
         cout<<"iteration:"<<iteration<<endl;
         gettimeofday(&start_t, NULL);
 #endif
-        // initialize the mask
-        unordered_map<Label, vector<Value> >& mask_map = mask_maps[iteration];
-        // iterate the edges in order
-        Value** embeddings_prev = tensor_prev->content;
-        Value** embeddings_prev_reverse = tensor_prev_reverse->content;
-        for(Vertex e_id=0; e_id<edge_count; ++e_id){
-            Value* embedding_cur = tensor_cur->content[e_id];
-            Value* embedding_cur_reverse = tensor_cur_reverse->content[e_id];
-            Vertex small_id = graph.edge_set[e_id*2];
-            Vertex large_id = graph.edge_set[e_id*2+1];
-            Vertex* n_neighbors = graph.common_edge_neighbor[e_id];
-            Vertex neighbor_size = n_neighbors[0];
-            for(Vertex itr=0; itr<neighbor_size; ++itr){
-                Vertex n = n_neighbors[itr*3+1];
-                Vertex small_e_id = n_neighbors[itr*3+2];
-                Vertex large_e_id = n_neighbors[itr*3+3];
-                auto itf = mask_map.find(graph.label_map[n]);
-                if(itf == mask_map.end()){
-                    continue;
-                }
-                vector<Value>& mask = itf->second;
-                if(n<small_id){
-                    vector_add_mul(embedding_cur_reverse, embeddings_prev[small_e_id], &(mask[0]), mask.size());
-                }else{
-                    vector_add_mul(embedding_cur_reverse, embeddings_prev_reverse[small_e_id], &(mask[0]), mask.size());
-                }
-                
-                if(n<large_id){
-                    vector_add_mul(embedding_cur, embeddings_prev[large_e_id], &(mask[0]), mask.size());
-                }else{
-                    vector_add_mul(embedding_cur, embeddings_prev_reverse[large_e_id], &(mask[0]), mask.size());
-                }
-            }
-        }
+        propagate(graph, iteration, tensor_prev, tensor_prev_reverse, tensor_cur, tensor_cur_reverse);
         // swap the embedding
         tensor_prev->clear_content();
         tensor_prev_reverse->clear_content();
         if(enable_residual == true && iteration < total_iterations-2){
-            Tensor* inner_result;
-            result[offset++] = merge_cycle_tensor_for_vertices(graph, tensor_cur, tensor_cur_reverse, mask_maps[iteration+1]);
+            result[offset++] = merge_states_for_vertices(graph, iteration, tensor_cur, tensor_cur_reverse);
         }
         swap(tensor_prev, tensor_cur);
         swap(tensor_prev_reverse, tensor_cur_reverse);
@@ -220,7 +246,7 @@ void Cycle_counter::count_for_vertices(Graph& graph, Tensor**& result, int& resu
 #endif
     }
     if(total_iterations > 1){
-        result[offset++] = merge_cycle_tensor_for_vertices(graph, tensor_prev, tensor_prev_reverse, mask_maps[total_iterations-1]);
+        result[offset++] = merge_states_for_vertices(graph, total_iterations-2, tensor_prev, tensor_prev_reverse);
     }
     delete tensor_prev;
     delete tensor_prev_reverse;
@@ -239,60 +265,23 @@ void Cycle_counter::count_for_edges(Graph& graph, Tensor**& result, int& result_
     }
     result = new Tensor* [result_size];
     uint32_t edge_count = graph.get_edge_count();
-    Tensor* tensor_prev= new Tensor(edge_count, extended_features.size(), 1); // v<-n
-    Tensor* tensor_prev_reverse = new Tensor(edge_count, extended_features.size(), 1); // v->n
-    Tensor* tensor_cur = new Tensor(edge_count, extended_features.size(), 0);
-    Tensor* tensor_cur_reverse = new Tensor(edge_count, extended_features.size(), 0);
+    Tensor* tensor_prev= new Tensor(edge_count, trie.max_state_num(), 1); // v<-n
+    Tensor* tensor_prev_reverse = new Tensor(edge_count, trie.max_state_num(), 1); // v->n
+    Tensor* tensor_cur = new Tensor(edge_count, trie.max_state_num(), 0);
+    Tensor* tensor_cur_reverse = new Tensor(edge_count, trie.max_state_num(), 0);
     int total_iterations = extended_features[0].size();
-    // int edge_count = graph.get_edge_count();
     int offset = 0;
     for(int iteration=0; iteration<total_iterations; ++iteration){
 #ifdef ENABLE_TIME_INFO
         cout<<"iteration:"<<iteration<<endl;
         gettimeofday(&start_t, NULL);
 #endif
-        // initialize the mask
-        unordered_map<Label, vector<Value> >& mask_map = mask_maps[iteration];
-        // iterate the edges in order
-        Value** embeddings_prev = tensor_prev->content;
-        Value** embeddings_prev_reverse = tensor_prev_reverse->content;
-        for(Vertex e_id=0; e_id<edge_count; ++e_id){
-            Value* embedding_cur = tensor_cur->content[e_id];
-            Value* embedding_cur_reverse = tensor_cur_reverse->content[e_id];
-            Vertex small_id = graph.edge_set[e_id*2];
-            Vertex large_id = graph.edge_set[e_id*2+1];
-            Vertex* n_neighbors = graph.common_edge_neighbor[e_id];
-            Vertex neighbor_size = n_neighbors[0];
-            for(Vertex itr=0; itr<neighbor_size; ++itr){
-                Vertex n = n_neighbors[itr*3+1];
-                Vertex small_e_id = n_neighbors[itr*3+2];
-                Vertex large_e_id = n_neighbors[itr*3+3];
-                auto itf = mask_map.find(graph.label_map[n]);
-                if(itf == mask_map.end()){
-                    continue;
-                }
-                vector<Value>& mask = itf->second;
-                if(n<small_id){
-                    vector_add_mul(embedding_cur_reverse, embeddings_prev[small_e_id], &(mask[0]), mask.size());
-                }else{
-                    vector_add_mul(embedding_cur_reverse, embeddings_prev_reverse[small_e_id], &(mask[0]), mask.size());
-                }
-                
-                if(n<large_id){
-                    vector_add_mul(embedding_cur, embeddings_prev[large_e_id], &(mask[0]), mask.size());
-                }else{
-                    vector_add_mul(embedding_cur, embeddings_prev_reverse[large_e_id], &(mask[0]), mask.size());
-                }
-            }
-        }
+        propagate(graph, iteration, tensor_prev, tensor_prev_reverse, tensor_cur, tensor_cur_reverse);
         // swap the embedding
         tensor_prev->clear_content();
         tensor_prev_reverse->clear_content();
         if(enable_residual == true && iteration < total_iterations-1){
-            Tensor* inner_result;
-            inner_result = merge_cycle_tensor_for_edges(tensor_cur, tensor_cur_reverse);
-            result[offset++] = inner_result;
-            // merge_cycle_tensor_for_edges(tensor_cur, tensor_cur_reverse, iteration);
+            result[offset++] = merge_states_for_edges(iteration, tensor_cur, tensor_cur_reverse);
         }
         swap(tensor_prev, tensor_cur);
         swap(tensor_prev_reverse, tensor_cur_reverse);
@@ -301,11 +290,9 @@ void Cycle_counter::count_for_edges(Graph& graph, Tensor**& result, int& result_
         cout<<"iteration:"<<iteration<<":"<<get_time(start_t, end_t)<<endl;
 #endif
     }
-    // merge_cycle_tensor_for_edges(tensor_prev, tensor_prev_reverse, total_iterations-1);
-    result[offset++] = merge_cycle_tensor_for_edges(tensor_prev, tensor_prev_reverse);
+    result[offset++] = merge_states_for_edges(total_iterations-1, tensor_prev, tensor_prev_reverse);
     delete tensor_prev;
     delete tensor_prev_reverse;
     delete tensor_cur;
     delete tensor_cur_reverse;
 }
-
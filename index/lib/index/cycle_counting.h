@@ -17,6 +17,7 @@
 #include "../graph/graph.h"
 #include "../utility/embedding.h"
 #include "feature_counter.h"
+#include "suffix_trie.h"
 
 using namespace std;
 
@@ -81,6 +82,7 @@ public:
     vector<vector<Label>> extended_features;
 
     vector<unordered_map<Label, vector<Value>>> mask_maps;
+    Suffix_trie trie; // the counting states of the extended features
 
     // utilized for edge
     vector<uint32_t> extended_slot_map; // if the j-th feature is a mirror feature, the value is the position of the original feature
@@ -102,6 +104,13 @@ public:
     Tensor* merge_cycle_tensor_for_edges(Tensor* cycle_tensor, Tensor* reversed_cycle_tensor);
     Tensor* merge_cycle_tensor_for_vertices(Graph& graph, Tensor* cycle_tensor, Tensor* reversed_cycle_tensor, unordered_map<Label, vector<Value>>& mask_map);
 
+    // one step of the counts of the trie states along the common neighbors of every edge
+    void propagate(Graph& graph, int iteration, Tensor* tensor_prev, Tensor* tensor_prev_reverse, Tensor* tensor_cur, Tensor* tensor_cur_reverse);
+    // the merge_cycle_tensor_for_* of the extended features expanded from the states of the
+    // iteration, iteration -1 being the root
+    Tensor* merge_states_for_edges(int iteration, Tensor* states, Tensor* reversed_states);
+    Tensor* merge_states_for_vertices(Graph& graph, int iteration, Tensor* states, Tensor* reversed_states);
+
     void count_for_vertices(Graph& graph, Tensor**& result, int& result_size);
     void count_for_edges(Graph& graph, Tensor**& result, int& result_size);
 };
@@ -20,7 +20,10 @@ void dump_features(vector<vector<Label>> features, string filename){
 }
 
 ///////////////////////////
-Feature_selector::Feature_selector(){}
+Feature_selector::Feature_selector(){
+    checkpoint = NULL;
+    anchor_local = false;
+}
 
 Feature_selector::Feature_selector(int num_labels_, int feature_num_, int feature_length_, bool enable_cycle_, string tmp_path_){
     num_labels = num_labels_;
@@ -28,6 +31,91 @@ Feature_selector::Feature_selector(int num_labels_, int feature_num_, int featur
     feature_length = feature_length_;
     enable_cycle = enable_cycle_;
     tmp_path = tmp_path_;
+    checkpoint = NULL;
+    anchor_local = false;
+}
+
+int Feature_selector::ball_radius(int level, int length){
+    // the count at a vertex after an iteration of the propagation only depends on its neighbors, so the
+    // counts at the anchors only see the vertices as far as the number of iterations: length for paths
+    // and vertex anchored cycles, one more for the edge anchored cycles, whose rows are edges
+    if(enable_cycle && level == 1){
+        return length+1;
+    }
+    return length;
+}
+
+void Feature_selector::count_at_anchors(vector<vector<Label>>& candidate_features, Graph& data_graph, vector<vector<Vertex>>& sample_data_anchors, vector<int>& sample_ids, int level, int length, int max_batch_size, int thread_num, vector<vector<Value>>& anchor_embs){
+    int radius = ball_radius(level, length);
+    vector<Vertex> sources;
+    for(auto j : sample_ids){
+        sources.push_back(sample_data_anchors[j][0]);
+        if(level == 1){
+            sources.push_back(sample_data_anchors[j][1]);
+        }
+    }
+    unordered_map<Vertex, Vertex> local_id;
+    Graph* ball = data_graph.induced_ball(sources, radius, local_id);
+    ball->set_up_edge_id_map();
+    vector<Vertex> rows;
+    for(auto j : sample_ids){
+        Vertex v = local_id[sample_data_anchors[j][0]];
+        if(level == 1){
+            Vertex u = local_id[sample_data_anchors[j][1]];
+            rows.push_back((v<u) ? ball->edge_id_map[v][u] : ball->edge_id_map[u][v]);
+        }else{
+            rows.push_back(v);
+        }
+    }
+    if(anchor_embs.size() < sample_data_anchors.size()){
+        anchor_embs.resize(sample_data_anchors.size());
+    }
+    for(auto j : sample_ids){
+        anchor_embs[j].assign(candidate_features.size(), 0);
+    }
+    // the features are counted in batches as for the full index
+    for(int feature_offset=0; feature_offset<candidate_features.size(); feature_offset+=max_batch_size){
+        int feature_end = min(feature_offset+max_batch_size, (int)candidate_features.size());
+        vector<vector<Label>> batch_features(candidate_features.begin()+feature_offset, candidate_features.begin()+feature_end);
+        feature_counter* counter;
+        if(enable_cycle){
+            counter = new Cycle_counter(false, batch_features);
+        }else{
+            counter = new Path_counter(false, batch_features);
+        }
+        Index_constructer constructor(counter);
+        Tensor* result = constructor.count_features(*ball, thread_num, level);
+        for(int k=0; k<sample_ids.size(); ++k){
+            memcpy(&(anchor_embs[sample_ids[k]][feature_offset]), result->content[rows[k]], sizeof(Value)*(feature_end-feature_offset));
+        }
+        delete result;
+        delete counter;
+    }
+    delete ball;
+}
+
+int Feature_selector::resume_rounds(vector<vector<Label>>& candidate_features){
+    if(checkpoint == NULL){
+        return 1;
+    }
+    for(int length=feature_length;length>=1;--length){
+        string key = string("round_")+to_string(length);
+        if(checkpoint->is_completed(key, checkpoint->unit_file(key))){
+            candidate_features = load_label_path(checkpoint->unit_file(key));
+            cout<<"resuming the feature extraction after round "<<length<<endl;
+            return length+1;
+        }
+    }
+    return 1;
+}
+
+void Feature_selector::complete_round(int length, vector<vector<Label>>& candidate_features_next){
+    if(checkpoint == NULL){
+        return;
+    }
+    string key = string("round_")+to_string(length);
+    dump_features(candidate_features_next, checkpoint->unit_file(key));
+    checkpoint->complete(key, checkpoint->unit_file(key));
 }
 
 string Feature_selector::generate_tmp_files(){
@@ -40,7 +128,7 @@ string Feature_selector::generate_tmp_files(){
     }
 }
 
-vector<int> Feature_selector::select_by_complementariness(vector<bitset<MAX_SAMPLE_NUM>>& result_bit, int sample_num){
+vector<int> Feature_selector::select_by_complementariness(vector<Sample_bitmap>& result_bit, int sample_num){
     // select the first candiate feature with highest precision
     float max_precision = 0.0;
     int max_feature_id = 0;
@@ -52,33 +140,67 @@ vector<int> Feature_selector::select_by_complementariness(vector<bitset<MAX_SAMP
         }
     }
     vector<int> candidate_feature_ids = {max_feature_id};
+    // the candidates used to be scanned in the order of an unordered_set of their ids, keeping the
+    // first one of the largest gain; the positions in that order break ties the same way
     unordered_set<int> remaining_ids;
     for(int i=0;i<result_bit.size();++i){
         remaining_ids.insert(i);
     }
     remaining_ids.erase(max_feature_id);
-    // iteratively select the candidate ids
-    while(candidate_feature_ids.size() < feature_num && remaining_ids.size()>0){
-        bitset<MAX_SAMPLE_NUM> ensembled_result;
-        for(auto id : candidate_feature_ids){
-            ensembled_result |= result_bit[id];
+    vector<int> scan_position(result_bit.size(), 0);
+    int position = 0;
+    for(auto c : remaining_ids){
+        scan_position[c] = position++;
+    }
+    // iteratively select the candidate ids. The gain of a candidate, i.e., the samples it adds to the
+    // ensemble, only shrinks as the ensemble grows, so a gain of an earlier round bounds the current
+    // one (lazy greedy). The candidates are bucketed by their last computed gain and only those of
+    // the top bucket are recomputed, until it holds up-to-date gains only
+    Sample_bitmap ensembled_result(sample_num);
+    ensembled_result |= result_bit[max_feature_id];
+    int round = 1;
+    vector<int> computed_round(result_bit.size(), round);
+    vector<vector<int>> buckets(sample_num+1);
+    for(auto c : remaining_ids){
+        buckets[ensembled_result.count_uncovered(result_bit[c])].push_back(c);
+    }
+    int top = sample_num;
+    while(candidate_feature_ids.size() < feature_num){
+        while(top > 0 && buckets[top].empty()){
+            --top;
         }
-        int max_value = -1;
-        int max_candidate = -1;
-        for(auto c : remaining_ids){
-            bitset<MAX_SAMPLE_NUM> tmp = (~ensembled_result) & result_bit[c];
-            int value = tmp.count();
-            if(value > max_value){
-                max_value = value;
-                max_candidate = c;
+        if(top == 0){
+            break;
+        }
+        vector<int>& bucket = buckets[top];
+        for(size_t i=0; i<bucket.size();){
+            int c = bucket[i];
+            if(computed_round[c] != round){
+                computed_round[c] = round;
+                int gain = ensembled_result.count_uncovered(result_bit[c]);
+                if(gain < top){
+                    buckets[gain].push_back(c);
+                    bucket[i] = bucket.back();
+                    bucket.pop_back();
+                    continue;
+                }
             }
+            ++i;
         }
-        if(max_value>0){
-            candidate_feature_ids.push_back(max_candidate);
-            remaining_ids.erase(max_candidate);
-        }else{
-            break;
+        if(bucket.empty()){
+            continue;
         }
+        size_t best = 0;
+        for(size_t i=1; i<bucket.size(); ++i){
+            if(scan_position[bucket[i]] < scan_position[bucket[best]]){
+                best = i;
+            }
+        }
+        candidate_feature_ids.push_back(bucket[best]);
+        ensembled_result |= result_bit[bucket[best]];
+        bucket[best] = bucket.back();
+        bucket.pop_back();
+        ++round;
     }
     while(candidate_feature_ids.size() < feature_num){
         candidate_feature_ids.push_back(rand()%result_bit.size());
@@ -86,88 +208,172 @@ vector<int> Feature_selector::select_by_complementariness(vector<bitset<MAX_SAMP
     return candidate_feature_ids;
 }
 
-vector<vector<Label>> Feature_selector::extract_for_singe_graph(vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Vertex>>& sample_data_anchors, Graph& data_graph, int level, int max_batch_size, int thread_num){
-    vector<vector<Label>> candidate_features;
-    for(Label i=0;i<num_labels;++i){
-        candidate_features.push_back({i});
+struct scoring_task{
+    Feature_selector* selector;
+    vector<vector<Label>>* candidate_features;
+    vector<Graph>* sample_queries;
+    vector<vector<Vertex>>* sample_query_anchors;
+    vector<vector<Value>>* data_anchor_embs;
+    int level;
+    int length;
+    int thread_id;
+    int thread_num;
+    vector<Sample_bitmap> result_bit;
+};
+
+static void* scoring_func(void* args){
+    scoring_task* task = (scoring_task*)args;
+    vector<Graph>& sample_queries = *(task->sample_queries);
+    feature_counter* counter;
+    if(task->selector->enable_cycle){
+        counter = new Cycle_counter(false, *(task->candidate_features));
+    }else{
+        counter = new Path_counter(false, *(task->candidate_features));
     }
-    data_graph.set_up_edge_id_map();
-    for(int length=1;length<=feature_length;++length){
-        // build the index for the data graph
-        feature_counter* counter;
-        if(enable_cycle){
-            counter = new Cycle_counter(false, candidate_features);
-        }else{
-            counter = new Path_counter(false, candidate_features);
+    Index_constructer constructor(counter);
+    constructor.build_time = 0;
+    int radius = task->selector->ball_radius(task->level, task->length);
+    task->result_bit.assign(task->candidate_features->size(), Sample_bitmap(sample_queries.size()));
+    for(int j=task->thread_id; j<sample_queries.size(); j+=task->thread_num){
+        vector<Vertex>& query_anchors = (*(task->sample_query_anchors))[j];
+        vector<Vertex> sources = {query_anchors[0]};
+        if(task->level == 1){
+            sources.push_back(query_anchors[1]);
         }
-        Index_constructer constructor(counter);
-        string data_graph_index = generate_tmp_files();
-        constructor.construct_index_in_batch(data_graph, data_graph_index, max_batch_size, thread_num, level);
-        Index_manager data_manager(data_graph_index);
-        if(sample_queries.size() > MAX_SAMPLE_NUM){
-            cout<<"sample num overflow, reset MAX_SAMPLE_NUM as "<<sample_queries.size()<<endl;
-            exit(0);
+        // only the row of the anchor is needed, so the sample is counted around it
+        unordered_map<Vertex, Vertex> local_id;
+        Graph* ball = sample_queries[j].induced_ball(sources, radius, local_id);
+        Tensor* query_emb = constructor.count_features(*ball, 1, task->level);
+        Vertex row = local_id[query_anchors[0]];
+        if(task->level == 1){
+            Vertex u = local_id[query_anchors[1]];
+            row = (row<u) ? ball->edge_id_map[row][u] : ball->edge_id_map[u][row];
         }
-        vector<bitset<MAX_SAMPLE_NUM>> result_bit;
-        result_bit.resize(candidate_features.size());
-        int sample_id = 0;
-        for(int j=0;j<sample_queries.size();++j){
-            Graph& query_graph = sample_queries[j];
-            vector<Vertex>& query_anchors = sample_query_anchors[j];
-            vector<Vertex>& data_anchors = sample_data_anchors[j];
-            Vertex query_anchor = query_anchors[0];
-            Vertex data_anchor = data_anchors[0];
-            Vertex query_anchor_u, data_anchor_v;
-            if(level == 1){
-                query_anchor_u = query_anchors[1];
-                data_anchor_v = data_anchors[1];
-            }
-            Tensor* query_emb = constructor.count_features(query_graph, thread_num, level);
-            vector<Value> query_anchor_emb, data_anchor_emb;
-            Vertex query_e_id, data_e_id;
-            if(level == 1){
-                query_e_id = (query_anchor<query_anchor_u) ? query_graph.edge_id_map[query_anchor][query_anchor_u] : query_graph.edge_id_map[query_anchor_u][query_anchor];
-                data_e_id = (data_anchor<data_anchor_v) ? data_graph.edge_id_map[data_anchor][data_anchor_v] : data_graph.edge_id_map[data_anchor_v][data_anchor];
-                query_emb->extract_row(query_e_id, query_anchor_emb);
-                data_manager.load_vertex_embedding(0, data_e_id, data_anchor_emb);
-            }else{
-                query_emb->extract_row(query_anchor, query_anchor_emb);
-                data_manager.load_vertex_embedding(0, data_anchor, data_anchor_emb);
+        Value* query_anchor_emb = query_emb->content[row];
+        vector<Value>& data_anchor_emb = (*(task->data_anchor_embs))[j];
+        // calculate the result bits
+        for(int z=0;z<data_anchor_emb.size();++z){
+            if(query_anchor_emb[z] > data_anchor_emb[z]){
+                task->result_bit[z].set(j);
             }
-            // calculate the result bits
-            for(int z=0;z<query_anchor_emb.size();++z){
-                if(query_anchor_emb[z] > data_anchor_emb[z]){
-                    result_bit[z].set(sample_id);
-                }
+        }
+        delete query_emb;
+        delete ball;
+    }
+    delete counter;
+    return NULL;
+}
+
+void Feature_selector::score_samples(vector<vector<Label>>& candidate_features, vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Value>>& data_anchor_embs, int level, int length, int thread_num, vector<Sample_bitmap>& result_bit){
+    if(thread_num < 1){
+        thread_num = 1;
+    }
+    vector<scoring_task> tasks(thread_num);
+    for(int t=0; t<thread_num; ++t){
+        tasks[t].selector = this;
+        tasks[t].candidate_features = &candidate_features;
+        tasks[t].sample_queries = &sample_queries;
+        tasks[t].sample_query_anchors = &sample_query_anchors;
+        tasks[t].data_anchor_embs = &data_anchor_embs;
+        tasks[t].level = level;
+        tasks[t].length = length;
+        tasks[t].thread_id = t;
+        tasks[t].thread_num = thread_num;
+    }
+    if(thread_num == 1){
+        scoring_func((void*)&(tasks[0]));
+    }else{
+        pthread_t* threads = new pthread_t [thread_num];
+        for(int i=0; i<thread_num; ++i){
+            int res = pthread_create(&(threads[i]), NULL, scoring_func, (void*)&(tasks[i]));
+            if(res != 0){
+                cout<<"Created thread:"<<i<<" failed"<<endl;
+                exit(res);
             }
-            delete query_emb;
-            sample_id ++;
         }
-        delete counter;
-        // select the top-k features
-        vector<int> result_ids = select_by_complementariness(result_bit, sample_queries.size());
-        // keep the internal features
-        vector<vector<Label>> features;
-        for(auto id:result_ids){
-            features.push_back(candidate_features[id]);
+        for(int i=0; i<thread_num; ++i){
+            void* ret;
+            pthread_join(threads[i], &ret);
+        }
+        delete [] threads;
+    }
+    // every thread holds the bits of its own samples
+    result_bit.swap(tasks[0].result_bit);
+    for(int t=1; t<thread_num; ++t){
+        for(int z=0; z<result_bit.size(); ++z){
+            result_bit[z] |= tasks[t].result_bit[z];
         }
-        dump_features(features, data_graph_index+string(".features"));
-        // expand the features
-        vector<vector<Label>> candidate_features_next;
-        for(auto id : result_ids){
-            if(candidate_features[id].size() == feature_length){
-                candidate_features_next.push_back(candidate_features[id]);
+    }
+}
+
+vector<vector<Label>> Feature_selector::select_round(vector<vector<Label>>& candidate_features, vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Value>>& data_anchor_embs, int level, int length, int thread_num){
+    vector<Sample_bitmap> result_bit;
+    score_samples(candidate_features, sample_queries, sample_query_anchors, data_anchor_embs, level, length, thread_num, result_bit);
+    // select the top-k features
+    vector<int> result_ids = select_by_complementariness(result_bit, sample_queries.size());
+    // expand the features
+    vector<vector<Label>> candidate_features_next;
+    for(auto id : result_ids){
+        if(candidate_features[id].size() == feature_length){
+            candidate_features_next.push_back(candidate_features[id]);
+        }else{
+            for(Vertex j=0;j<num_labels;++j){
+                vector<Label> tmp_f = candidate_features[id];
+                tmp_f.insert(tmp_f.begin(), j);
+                candidate_features_next.push_back(tmp_f);
+            }
+        }
+    }
+    cout<<"progress:"<<length<<":"<<candidate_features.size()<<":"<<candidate_features_next.size()<<":"<<result_ids.size()<<endl;
+    return candidate_features_next;
+}
+
+vector<vector<Label>> Feature_selector::extract_for_singe_graph(vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Vertex>>& sample_data_anchors, Graph& data_graph, int level, int max_batch_size, int thread_num){
+    vector<vector<Label>> candidate_features;
+    for(Label i=0;i<num_labels;++i){
+        candidate_features.push_back({i});
+    }
+    if(!anchor_local){
+        data_graph.set_up_edge_id_map();
+    }
+    for(int length=resume_rounds(candidate_features);length<=feature_length;++length){
+        // the counts of the candidates at the data anchors
+        vector<vector<Value>> data_anchor_embs;
+        if(anchor_local){
+            vector<int> sample_ids;
+            for(int j=0;j<sample_queries.size();++j){
+                sample_ids.push_back(j);
+            }
+            count_at_anchors(candidate_features, data_graph, sample_data_anchors, sample_ids, level, length, max_batch_size, thread_num, data_anchor_embs);
+        }else{
+            // build the index for the data graph
+            feature_counter* counter;
+            if(enable_cycle){
+                counter = new Cycle_counter(false, candidate_features);
             }else{
-                for(Vertex j=0;j<num_labels;++j){
-                    vector<Label> tmp_f = candidate_features[id];
-                    tmp_f.insert(tmp_f.begin(), j);
-                    candidate_features_next.push_back(tmp_f);
+                counter = new Path_counter(false, candidate_features);
+            }
+            Index_constructer constructor(counter);
+            string data_graph_index = generate_tmp_files();
+            constructor.construct_index_in_batch(data_graph, data_graph_index, max_batch_size, thread_num, level);
+            vector<Vertex> rows;
+            for(auto& data_anchors : sample_data_anchors){
+                if(level == 1){
+                    Vertex data_anchor = data_anchors[0];
+                    Vertex data_anchor_v = data_anchors[1];
+                    rows.push_back((data_anchor<data_anchor_v) ? data_graph.edge_id_map[data_anchor][data_anchor_v] : data_graph.edge_id_map[data_anchor_v][data_anchor]);
+                }else{
+                    rows.push_back(data_anchors[0]);
                 }
             }
+            Index_manager data_manager(data_graph_index);
+            data_manager.load_rows(0, rows, data_anchor_embs);
+            remove(data_graph_index.c_str());
+            delete counter;
         }
-        cout<<"progress:"<<length<<":"<<candidate_features.size()<<":"<<candidate_features_next.size()<<":"<<result_ids.size()<<endl;
+        vector<vector<Label>> candidate_features_next = select_round(candidate_features, sample_queries, sample_query_anchors, data_anchor_embs, level, length, thread_num);
+        complete_round(length, candidate_features_next);
         swap(candidate_features, candidate_features_next);
-        remove(data_graph_index.c_str());
     }
     return candidate_features;
 }
@@ -177,89 +383,77 @@ vector<vector<Label>> Feature_selector::extract_for_multi_graph(vector<Graph>& s
     for(Label i=0;i<num_labels;++i){
         candidate_features.push_back({i});
     }
-    for(int i=0;i<data_graphs.size();++i){
-        data_graphs[i].set_up_edge_id_map();
-    }
-    for(int length=1;length<=feature_length;++length){
-        // build the index for the data graph
-        feature_counter* counter;
-        if(enable_cycle){
-            counter = new Cycle_counter(false, candidate_features);
-        }else{
-            counter = new Path_counter(false, candidate_features);
-        }
-        Index_constructer constructor(counter);
-        string data_graph_index = generate_tmp_files();
-        for(auto data_graph : data_graphs){
-            constructor.construct_index_in_batch(data_graph, data_graph_index, max_batch_size, thread_num, level);
-        }
-        Index_manager data_manager(data_graph_index);
-        if(sample_queries.size() > MAX_SAMPLE_NUM){
-            cout<<"sample num overflow, reset MAX_SAMPLE_NUM as "<<sample_queries.size()<<endl;
-            exit(0);
+    // without the anchor balls, every round counts the disjoint union of the data graphs, built
+    // once together with its edge common neighbors
+    Graph* data_union = NULL;
+    vector<Vertex> vertex_offsets, edge_offsets;
+    if(!anchor_local){
+        for(int i=0;i<data_graphs.size();++i){
+            data_graphs[i].set_up_edge_id_map();
         }
-        vector<bitset<MAX_SAMPLE_NUM>> result_bit;
-        result_bit.resize(candidate_features.size());
-        int sample_id = 0;
-        for(int j=0;j<sample_queries.size();++j){
-            Graph& query_graph = sample_queries[j];
-            vector<Vertex>& query_anchors = sample_query_anchors[j];
-            vector<Vertex>& data_anchors = sample_data_anchors[j];
-            Vertex data_graph_id = data_graph_ids[j];
-
-            Vertex query_anchor = query_anchors[0];
-            Vertex data_anchor = data_anchors[0];
-            Vertex query_anchor_u, data_anchor_v;
-            if(level == 1){
-                query_anchor_u = query_anchors[1];
-                data_anchor_v = data_anchors[1];
+        data_union = Graph::disjoint_union(data_graphs, vertex_offsets, edge_offsets);
+    }
+    for(int length=resume_rounds(candidate_features);length<=feature_length;++length){
+        // the counts of the candidates at the data anchors
+        vector<vector<Value>> data_anchor_embs;
+        if(anchor_local){
+            // the samples of every data graph are counted on the balls around their anchors
+            vector<vector<int>> sample_ids(data_graphs.size());
+            for(int j=0;j<sample_queries.size();++j){
+                sample_ids[data_graph_ids[j]].push_back(j);
+            }
+            for(int i=0;i<data_graphs.size();++i){
+                if(!sample_ids[i].empty()){
+                    count_at_anchors(candidate_features, data_graphs[i], sample_data_anchors, sample_ids[i], level, length, max_batch_size, thread_num, data_anchor_embs);
+                }
             }
-            Tensor* query_emb = constructor.count_features(query_graph, thread_num, level);
-            vector<Value> query_anchor_emb, data_anchor_emb;
-            Vertex query_e_id, data_e_id;
-            if(level == 1){
-                query_e_id = (query_anchor<query_anchor_u) ? query_graph.edge_id_map[query_anchor][query_anchor_u] : query_graph.edge_id_map[query_anchor_u][query_anchor];
-                data_e_id = (data_anchor<data_anchor_v) ? data_graphs[data_graph_id].edge_id_map[data_anchor][data_anchor_v] : data_graphs[data_graph_id].edge_id_map[data_anchor_v][data_anchor];
-                query_emb->extract_row(query_e_id, query_anchor_emb);
-                data_manager.load_vertex_embedding(0, data_e_id, data_anchor_emb);
+        }else{
+            // build the index for the data graphs, one tensor per graph
+            feature_counter* counter;
+            if(enable_cycle){
+                counter = new Cycle_counter(false, candidate_features);
             }else{
-                query_emb->extract_row(query_anchor, query_anchor_emb);
-                data_manager.load_vertex_embedding(0, data_anchor, data_anchor_emb);
+                counter = new Path_counter(false, candidate_features);
             }
-            // calculate the result bits
-            for(int z=0;z<query_anchor_emb.size();++z){
-                if(query_anchor_emb[z] > data_anchor_emb[z]){
-                    result_bit[z].set(sample_id);
+            Index_constructer constructor(counter);
+            string data_graph_index = generate_tmp_files();
+            constructor.construct_index_for_graphs(*data_union, (level == 1) ? edge_offsets : vertex_offsets, data_graph_index, max_batch_size, thread_num, level);
+            // the rows of the anchors, grouped by their data graph
+            vector<vector<Vertex>> rows(data_graphs.size());
+            vector<vector<int>> sample_ids(data_graphs.size());
+            for(int j=0;j<sample_queries.size();++j){
+                vector<Vertex>& data_anchors = sample_data_anchors[j];
+                Graph& data_graph = data_graphs[data_graph_ids[j]];
+                if(level == 1){
+                    Vertex data_anchor = data_anchors[0];
+                    Vertex data_anchor_v = data_anchors[1];
+                    rows[data_graph_ids[j]].push_back((data_anchor<data_anchor_v) ? data_graph.edge_id_map[data_anchor][data_anchor_v] : data_graph.edge_id_map[data_anchor_v][data_anchor]);
+                }else{
+                    rows[data_graph_ids[j]].push_back(data_anchors[0]);
                 }
+                sample_ids[data_graph_ids[j]].push_back(j);
             }
-            delete query_emb;
-            sample_id ++;
-        }
-        delete counter;
-        // select the top-k features
-        vector<int> result_ids = select_by_complementariness(result_bit, sample_queries.size());
-        // keep the internal features
-        vector<vector<Label>> features;
-        for(auto id:result_ids){
-            features.push_back(candidate_features[id]);
-        }
-        dump_features(features, data_graph_index+string(".features"));
-        // expand the features
-        vector<vector<Label>> candidate_features_next;
-        for(auto id : result_ids){
-            if(candidate_features[id].size() == feature_length){
-                candidate_features_next.push_back(candidate_features[id]);
-            }else{
-                for(Vertex j=0;j<num_labels;++j){
-                    vector<Label> tmp_f = candidate_features[id];
-                    tmp_f.insert(tmp_f.begin(), j);
-                    candidate_features_next.push_back(tmp_f);
+            Index_manager data_manager(data_graph_index);
+            data_anchor_embs.resize(sample_queries.size());
+            for(int i=0;i<data_graphs.size();++i){
+                if(rows[i].empty()){
+                    continue;
+                }
+                vector<vector<Value>> graph_embs;
+                data_manager.load_rows(i, rows[i], graph_embs);
+                for(int k=0;k<sample_ids[i].size();++k){
+                    swap(data_anchor_embs[sample_ids[i][k]], graph_embs[k]);
                 }
             }
+            remove(data_graph_index.c_str());
+            delete counter;
         }
-        cout<<"progress:"<<length<<":"<<candidate_features.size()<<":"<<candidate_features_next.size()<<":"<<result_ids.size()<<endl;
+        vector<vector<Label>> candidate_features_next = select_round(candidate_features, sample_queries, sample_query_anchors, data_anchor_embs, level, length, thread_num);
+        complete_round(length, candidate_features_next);
         swap(candidate_features, candidate_features_next);
-        remove(data_graph_index.c_str());
+    }
+    if(data_union != NULL){
+        delete data_union;
     }
     return candidate_features;
-}
\ No newline at end of file
+}
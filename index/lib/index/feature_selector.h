@@ -1,5 +1,4 @@
 #pragma once
-#include <bitset>
 #include <cstdlib>
 
 #include "../utility/embedding.h"
@@ -11,6 +10,58 @@
 
 void dump_features(vector<vector<Label>> features, string filename);
 
+// one bit per sample, sized at run time
+class Sample_bitmap{
+public:
+    vector<uint64_t> words;
+
+    Sample_bitmap(){}
+    Sample_bitmap(size_t size){
+        words.assign((size+63)/64, 0);
+    }
+
+    void set(size_t i){
+        words[i>>6] |= (uint64_t)1<<(i&63);
+    }
+    int count(){
+        int result = 0;
+        for(auto w : words){
+            result += __builtin_popcountll(w);
+        }
+        return result;
+    }
+    // number of bits of other not set here
+    int count_uncovered(Sample_bitmap& other){
+        int result = 0;
+        size_t i = 0;
+#if defined(__AVX512F__) && defined(__AVX512VPOPCNTDQ__)
+        // the zero-masked andnot and the reduction through memory avoid the undefined vectors of
+        // _mm512_andnot_si512 and _mm512_reduce_add_epi64, which -Wmaybe-uninitialized reports
+        __m512i sum = _mm512_setzero_si512();
+        for(; i+8<=words.size(); i+=8){
+            __m512i covered = _mm512_loadu_si512((void*)&(words[i]));
+            __m512i bits = _mm512_loadu_si512((void*)&(other.words[i]));
+            sum = _mm512_add_epi64(sum, _mm512_popcnt_epi64(_mm512_maskz_andnot_epi64((__mmask8)0xff, covered, bits)));
+        }
+        uint64_t lanes[8] = {0};
+        _mm512_storeu_si512((void*)lanes, sum);
+        for(int j=0;j<8;++j){
+            result += lanes[j];
+        }
+#endif
+        for(; i<words.size(); ++i){
+            result += __builtin_popcountll(~words[i] & other.words[i]);
+        }
+        return result;
+    }
+    Sample_bitmap& operator|=(const Sample_bitmap& other){
+        for(size_t i=0; i<words.size(); ++i){
+            words[i] |= other.words[i];
+        }
+        return *this;
+    }
+};
+
 class Feature_selector{
 public:
     int num_labels;
@@ -18,13 +69,35 @@ public:
     int feature_length;
     bool enable_cycle;
     string tmp_path;
+    Build_checkpoint* checkpoint; // records the candidates after every round of the extraction, NULL for none
+    bool anchor_local; // count the candidates around the sampled data anchors instead of indexing the data graph
 
     Feature_selector();
     Feature_selector(int num_labels_, int feature_num_, int feature_length_, bool enable_cycle_, string tmp_path_);
 
     string generate_tmp_files();
 
-    vector<int> select_by_complementariness(vector<bitset<MAX_SAMPLE_NUM>>& result_bit, int sample_num);
+    // the first round to run; the candidates of the last recorded round are loaded into candidate_features
+    int resume_rounds(vector<vector<Label>>& candidate_features);
+    void complete_round(int length, vector<vector<Label>>& candidate_features_next);
+
+    // the counts of the candidates at the data anchors of the samples sample_ids, which lie in
+    // data_graph, computed on the subgraph induced by the vertices near the anchors. With the
+    // candidates of the given length, the counts are those of the index of the whole data graph
+    void count_at_anchors(vector<vector<Label>>& candidate_features, Graph& data_graph, vector<vector<Vertex>>& sample_data_anchors, vector<int>& sample_ids, int level, int length, int max_batch_size, int thread_num, vector<vector<Value>>& anchor_embs);
+
+    // hops around an anchor that its counts depend on, for candidates of the given length
+    int ball_radius(int level, int length);
+
+    // result_bit[z] holds the samples whose query anchor has a larger count of the z-th candidate than
+    // their data anchor. The samples are split among thread_num threads, each counting a sample only
+    // around its anchor
+    void score_samples(vector<vector<Label>>& candidate_features, vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Value>>& data_anchor_embs, int level, int length, int thread_num, vector<Sample_bitmap>& result_bit);
+
+    // scores the candidates and returns the candidates of the next round
+    vector<vector<Label>> select_round(vector<vector<Label>>& candidate_features, vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Value>>& data_anchor_embs, int level, int length, int thread_num);
+
+    vector<int> select_by_complementariness(vector<Sample_bitmap>& result_bit, int sample_num);
 
     vector<vector<Label>> extract_for_singe_graph(vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Vertex>>& sample_data_anchors, Graph& data_graph, int level, int max_batch_size, int thread_num=1);
     vector<vector<Label>> extract_for_multi_graph(vector<Graph>& sample_queries, vector<vector<Vertex>>& sample_query_anchors, vector<vector<Vertex>>& sample_data_anchors, vector<Vertex>& data_graph_ids, vector<Graph>& data_graphs, int level, int max_batch_size, int thread_num=1);
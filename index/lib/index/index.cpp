@@ -41,119 +41,9 @@ Tensor* get_frequency_from_multi_counters(Graph& graph, vector<feature_counter*>
 }
 
 //////////////////////////////////
-void* compute_common_neighbor_func(void* args){
-    input_para& input = *(input_para*)args;
-    Graph* graph = std::get<0>(input);
-    pair<Vertex, Vertex>* task = std::get<1>(input);
-    Vertex** common_neighbors = std::get<2>(input);
-    int id = std::get<3>(input);
-    
-    vector<Vertex>& edge_set = graph->edge_set;
-    vector<unordered_set<Vertex>>& adj = graph->adj;
-    vector<unordered_map<Vertex, Vertex>>& edge_id_map = graph->edge_id_map;
-
-    int test_id = 0;
-    for(Vertex e_id=task->first; e_id<task->second; ++e_id){
-        test_id++;
-        Vertex v = graph->edge_set[e_id*2];
-        Vertex n = graph->edge_set[e_id*2+1];
-        int common_size = 0;
-        int offset = 1;
-        Vertex* vec = common_neighbors[e_id];
-        for(auto v_n : graph->adj[n]){ // auto v_n : adj[n]
-            if(v_n!=v && graph->adj[v].find(v_n)!=graph->adj[v].end()){
-                vec[offset++] = v_n;
-                common_size ++;
-                if(v_n<v){
-                    // if(graph->edge_id_map[v_n].find(v)==graph->edge_id_map[v_n].end()){
-                    //     cout<<"t:"<<id<<"Error1:"<<v_n<<" is not connected to "<<v<<":"<<graph<<":"<<&(graph->edge_id_map)<<":"<<&(graph->adj)<<endl;
-                    //     continue;
-                    // }
-                    vec[offset++] = graph->edge_id_map[v_n][v];
-                }else{
-                    // if(graph->edge_id_map[v].find(v_n)==graph->edge_id_map[v].end()){
-                    //     cout<<"t:"<<id<<"Error2:"<<v<<" is not connected to "<<v_n<<":"<<graph<<":"<<&(graph->edge_id_map)<<":"<<&(graph->adj)<<endl;
-                    //     continue;
-                    // }
-                    vec[offset++] = graph->edge_id_map[v][v_n];
-                }
-                if(v_n<n){
-                    // if(graph->edge_id_map[v_n].find(n)==graph->edge_id_map[v_n].end()){
-                    //     cout<<"t:"<<id<<"Error3:"<<v_n<<" is not connected to "<<n<<":"<<graph<<":"<<&(graph->edge_id_map)<<":"<<&(graph->adj)<<endl;
-                    //     continue;
-                    // }
-                    vec[offset++] = graph->edge_id_map[v_n][n];
-                }else{
-                    // if(graph->edge_id_map[n].find(v_n)==graph->edge_id_map[n].end()){
-                    //     cout<<"t:"<<id<<"Error4:"<<n<<" is not connected to "<<v_n<<":"<<graph<<":"<<&(graph->edge_id_map)<<":"<<&(graph->adj)<<endl;
-                    //     continue;
-                    // }
-                    vec[offset++] = graph->edge_id_map[n][v_n];
-                }
-            }
-            // if(common_size != graph->estimated_common_neighbor_count[e_id]){
-            //     exit(0);
-            //     cout<<"e_id:"<<e_id<<":"<<common_size<<":"<<graph->estimated_common_neighbor_count[e_id]<<endl;
-            // }
-            vec[0] = common_size;
-        }
-    }
-    return NULL;
-}
-
 // compute the common edge neighbors for graph
 void common_edge_neighbor_multi_threads(Graph* graph, int thread_num){
-    graph->set_up_edge_id_map();
-    if(graph->common_edge_neighbor != NULL){
-        return;
-    }
-    // initialize common_edge_neighbor
-    int edge_count = graph->get_edge_count();
-    graph->common_edge_neighbor = new Vertex* [edge_count];
-    for(Vertex e_id=0; e_id<edge_count; ++e_id){
-        graph->common_edge_neighbor[e_id] = new Vertex [3*graph->estimated_common_neighbor_count[e_id]+1];
-    }
-    
-    thread_num = (thread_num<edge_count) ? thread_num : edge_count;
-    int average_edges_per_thread = edge_count/thread_num;
-    int remain_edges = edge_count%thread_num;
-    // initialise the task
-    vector<pair<Vertex, Vertex>> tasks;
-    int offset = 0;
-    int acc_edges = 0;
-    for(int i=0; i<thread_num; ++i){
-        if(i<remain_edges){
-            tasks.push_back({offset, offset+average_edges_per_thread+1});
-            offset += average_edges_per_thread+1;
-        }else{
-            tasks.push_back({offset, offset+average_edges_per_thread});
-            offset += average_edges_per_thread;
-        }
-    }
-    assert(offset == edge_count);
-
-    // initialize the parameters
-    vector<input_para> input_parameters;
-    vector<int> fd_list;
-    for(int i=0;i<thread_num;++i){
-        input_parameters.push_back(input_para(graph, &(tasks[i]), graph->common_edge_neighbor, i));
-    }
-    // start computation
-    pthread_t* threads = new pthread_t [thread_num];
-
-    for(int i=0;i<thread_num;++i){
-        int res = pthread_create(&(threads[i]), NULL, compute_common_neighbor_func, (void*)&input_parameters[i]);
-        if(res != 0){
-            cout<<"Create thread:"<<i<<" failed for common neighbor computation"<<endl;
-            exit(res);
-        }
-    }
-
-    for(int i=0; i<thread_num; ++i){
-        void* ret;
-        pthread_join(threads[i], &ret);
-    }
-    delete [] threads;
+    graph->construct_edge_common_neighbor(thread_num);
 }
 
 //////////////////////////////////////
@@ -179,11 +69,15 @@ void Index_constructer::construct_index_single_batch(Graph& graph, string index_
 }
 
 // note that residual mechanism is not supported
-void Index_constructer::construct_index_in_batch(Graph& graph, string index_file_name, int max_feature_size_per_batch, int thread_num, int level){
+void Index_constructer::construct_index_in_batch(Graph& graph, string index_file_name, int max_feature_size_per_batch, int thread_num, int level, Build_checkpoint* checkpoint){
+    vector<Vertex> row_offsets = {0, (level == 1) ? graph.get_edge_count() : (Vertex)graph.label_map.size()};
+    construct_index_for_graphs(graph, row_offsets, index_file_name, max_feature_size_per_batch, thread_num, level, checkpoint);
+}
+
+void Index_constructer::construct_index_for_graphs(Graph& graph, vector<Vertex>& row_offsets, string index_file_name, int max_feature_size_per_batch, int thread_num, int level, Build_checkpoint* checkpoint){
     build_time = 0;
     bool enable_residual = counter->get_residual();
     int split_num = 0;
-    int feature_offset = 0;
     vector<vector<Label>> label_path_origin = counter->get_features();
     vector<vector<string>> index_splits;
     if(enable_residual){
@@ -203,11 +97,32 @@ void Index_constructer::construct_index_in_batch(Graph& graph, string index_file
         type_name = string("path");
     }
     
-    while(feature_offset+max_feature_size_per_batch <= label_path_origin.size()){
+    for(int feature_offset=0; feature_offset<label_path_origin.size(); feature_offset+=max_feature_size_per_batch, ++split_num){
+        int feature_end = min(feature_offset+max_feature_size_per_batch, (int)label_path_origin.size());
+        vector<string> split_files;
+        bool finished = (checkpoint != NULL);
+        for(int i=0;i<index_splits.size();++i){
+            string index_file_name_split = index_file_name+string("_")+to_string(split_num)+string("_")+to_string(i)+string("_")+type_name;
+            index_splits[i].push_back(index_file_name_split);
+            split_files.push_back(index_file_name_split);
+            if(finished && !checkpoint->is_completed(index_file_name_split, index_file_name_split)){
+                finished = false;
+            }
+        }
+        if(finished){
+            cout<<"building progress:split_num:"<<split_num<<" already built"<<endl;
+            continue;
+        }
         // split the features
-        cout<<"building progress inner:split_num:"<<split_num<<":("<<label_path_origin.size()/max_feature_size_per_batch+1<<")"<<endl;
+        if(feature_end-feature_offset == max_feature_size_per_batch){
+            cout<<"building progress inner:split_num:"<<split_num<<":("<<label_path_origin.size()/max_feature_size_per_batch+1<<")"<<endl;
+        }else{
+#ifdef PRINT_BUILD_PROGRESS
+            cout<<"building progress final:split_num:"<<split_num<<":("<<label_path_origin.size()/max_feature_size_per_batch+1<<")"<<endl;
+#endif
+        }
         vector<vector<Label>> label_paths_tmp;
-        label_paths_tmp.assign(label_path_origin.begin()+feature_offset, label_path_origin.begin()+feature_offset+max_feature_size_per_batch);
+        label_paths_tmp.assign(label_path_origin.begin()+feature_offset, label_path_origin.begin()+feature_end);
         feature_counter* split_counter;
         if(counter->get_feature_type() == 0){
             split_counter = new Path_counter(counter->get_residual(), label_paths_tmp);
@@ -218,74 +133,165 @@ void Index_constructer::construct_index_in_batch(Graph& graph, string index_file
         vector<Tensor*> result = constructor.count_with_multi_thread(graph, thread_num, level);
         if(enable_residual){
             for(int i=0;i<result.size();++i){
-                string index_file_name_split = index_file_name+string("_")+to_string(split_num)+string("_")+to_string(i)+string("_")+type_name;
-                index_splits[i].push_back(index_file_name_split);
                 vector<bool> mask;
-                mask.assign(redundant_mask[i].begin()+feature_offset, redundant_mask[i].begin()+feature_offset+max_feature_size_per_batch);
-                remove(index_file_name_split.c_str());
-                dump_index_with_mask(result[i], index_file_name_split, mask);
+                mask.assign(redundant_mask[i].begin()+feature_offset, redundant_mask[i].begin()+feature_end);
+                vector<Tensor*> level_result = {result[i]};
+                vector<vector<bool>> level_mask = {mask};
+                Tensor* masked = merge_multi_Tensors_with_mask(level_result, level_mask);
+                Index_manager manager(split_files[i]);
+                remove(split_files[i].c_str());
+                manager.dump_tensor(masked, row_offsets);
+                delete masked;
             }
         }else{
-            string index_file_name_split = index_file_name+string("_")+to_string(split_num)+string("_")+to_string(0)+string("_")+type_name;
-            index_splits[0].push_back(index_file_name_split);
-            Index_manager manager(index_file_name_split);
-            remove(index_file_name_split.c_str());
-            manager.dump_tensor(result[0]);
+            Index_manager manager(split_files[0]);
+            remove(split_files[0].c_str());
+            manager.dump_tensor(result[0], row_offsets);
         }
         for(auto r : result){
             delete r;
         }
+        build_time += constructor.build_time;
         delete split_counter;
-        ++ split_num;
-        feature_offset += max_feature_size_per_batch;
+        if(checkpoint != NULL){
+            for(auto& file : split_files){
+                checkpoint->complete(file, file);
+            }
+        }
     }
-    if(feature_offset < label_path_origin.size()){
-#ifdef PRINT_BUILD_PROGRESS
-        cout<<"building progress final:split_num:"<<split_num<<":("<<label_path_origin.size()/max_feature_size_per_batch+1<<")"<<endl;
-#endif
+    vector<string> filelist;
+    for(auto vec : index_splits){
+        filelist.insert(filelist.end(), vec.begin(), vec.end());
+    }
+    if(filelist.size() == 1){
+        if(rename(filelist[0].c_str(), index_file_name.c_str()) != 0){
+            cout<<"renaming index file error:"<<index_file_name<<endl;
+            exit(-1);
+        }
+        return;
+    }
+    merge_multi_index_files_in_parallel(filelist, index_file_name, row_offsets.size()-1, thread_num);
+    for(auto file : filelist){
+        int flag = remove(file.c_str());
+        if(flag != 0){
+            cout<<"removing temporary index file error:"<<file<<endl;
+        }
+    }
+}
+
+vector<string> Index_constructer::get_batch_files(string index_file_name, int batch_id){
+    string type_name;
+    if(counter->get_feature_type() == 1){
+        type_name = string("cycle");
+    }else{
+        type_name = string("path");
+    }
+    int level_num = counter->get_residual() ? counter->get_features()[0].size() : 1;
+    vector<string> files;
+    for(int i=0;i<level_num;++i){
+        files.push_back(index_file_name+string("_batch_")+to_string(batch_id)+string("_")+to_string(i)+string("_")+type_name);
+    }
+    return files;
+}
+
+void Index_constructer::construct_index_shard(vector<Graph>& graphs, string index_file_name, int max_feature_size_per_batch, int shard_id, int shard_num, int thread_num, int level){
+    build_time = 0;
+    bool enable_residual = counter->get_residual();
+    vector<vector<Label>> label_path_origin = counter->get_features();
+    int batch_num = (label_path_origin.size()+max_feature_size_per_batch-1)/max_feature_size_per_batch;
+    vector<vector<bool>> redundant_mask;
+    if(enable_residual == true){
+        analyse_redundant_features(label_path_origin, redundant_mask);
+    }
+    for(int b=shard_id; b<batch_num; b+=shard_num){
+        vector<string> files = get_batch_files(index_file_name, b);
+        bool finished = true;
+        for(auto& file : files){
+            if(access(file.c_str(), F_OK) != 0){
+                finished = false;
+            }
+        }
+        if(finished){
+            cout<<"batch "<<b<<" of "<<index_file_name<<" already built"<<endl;
+            continue;
+        }
+        cout<<"building progress shard "<<shard_id<<"/"<<shard_num<<":batch:"<<b<<":("<<batch_num<<")"<<endl;
+        int feature_offset = b*max_feature_size_per_batch;
+        int feature_end = min(feature_offset+max_feature_size_per_batch, (int)label_path_origin.size());
         vector<vector<Label>> label_paths_tmp;
-        label_paths_tmp.assign(label_path_origin.begin()+feature_offset, label_path_origin.end());
+        label_paths_tmp.assign(label_path_origin.begin()+feature_offset, label_path_origin.begin()+feature_end);
         feature_counter* split_counter;
         if(counter->get_feature_type() == 0){
-            split_counter = new Path_counter(counter->get_residual(), label_paths_tmp);
+            split_counter = new Path_counter(enable_residual, label_paths_tmp);
         }else{
-            split_counter = new Cycle_counter(counter->get_residual(), label_paths_tmp);
+            split_counter = new Cycle_counter(enable_residual, label_paths_tmp);
+        }
+        // the partial files of an unfinished batch are rewritten from the first graph
+        for(auto& file : files){
+            remove((file+string(".tmp")).c_str());
         }
         Index_constructer constructor(split_counter);
-        vector<Tensor*> result = constructor.count_with_multi_thread(graph, thread_num, level);
-        
-        if(enable_residual){
-            for(int i=0;i<result.size();++i){
-                string index_file_name_split = index_file_name+string("_")+to_string(split_num)+string("_")+to_string(i)+string("_")+type_name;
-                index_splits[i].push_back(index_file_name_split);
-                vector<bool> mask;
-                mask.assign(redundant_mask[i].begin()+feature_offset, redundant_mask[i].end());
-                remove(index_file_name_split.c_str());
-                dump_index_with_mask(result[i], index_file_name_split, mask);
+        constructor.build_time = 0;
+        for(auto& graph : graphs){
+            vector<Tensor*> result = constructor.count_with_multi_thread(graph, thread_num, level);
+            if(enable_residual){
+                for(int i=0;i<result.size();++i){
+                    vector<bool> mask;
+                    mask.assign(redundant_mask[i].begin()+feature_offset, redundant_mask[i].begin()+feature_end);
+                    dump_index_with_mask(result[i], files[i]+string(".tmp"), mask);
+                }
+            }else{
+                Index_manager manager(files[0]+string(".tmp"));
+                manager.dump_tensor(result[0]);
+            }
+            for(auto r : result){
+                delete r;
             }
-        }else{
-            string index_file_name_split = index_file_name+string("_")+to_string(split_num)+string("_")+to_string(0)+string("_")+type_name;
-            index_splits[0].push_back(index_file_name_split);
-            Index_manager manager(index_file_name_split);
-            remove(index_file_name_split.c_str());
-            manager.dump_tensor(result[0]);
-        }
-        for(auto r : result){
-            delete r;
         }
+        build_time += constructor.build_time;
         delete split_counter;
+        for(auto& file : files){
+            if(rename((file+string(".tmp")).c_str(), file.c_str()) != 0){
+                cout<<"renaming partial index file error:"<<file<<endl;
+                exit(-1);
+            }
+        }
+    }
+}
+
+bool Index_constructer::merge_shards(int graph_count, string index_file_name, int max_feature_size_per_batch, int thread_num){
+    int batch_num = (counter->get_features().size()+max_feature_size_per_batch-1)/max_feature_size_per_batch;
+    // the columns of the index are ordered by level, then by batch
+    vector<vector<string>> batch_files;
+    for(int b=0; b<batch_num; ++b){
+        batch_files.push_back(get_batch_files(index_file_name, b));
+        for(auto& file : batch_files.back()){
+            if(access(file.c_str(), F_OK) != 0){
+                cout<<"batch "<<b<<" of "<<index_file_name<<" is not built yet"<<endl;
+                return false;
+            }
+        }
     }
     vector<string> filelist;
-    for(auto vec : index_splits){
-        filelist.insert(filelist.end(), vec.begin(), vec.end());
+    for(int i=0;i<batch_files[0].size();++i){
+        for(int b=0; b<batch_num; ++b){
+            filelist.push_back(batch_files[b][i]);
+        }
+    }
+    // the index file only appears once it is complete
+    string index_file_name_tmp = index_file_name+string(".tmp");
+    merge_multi_index_files_in_parallel(filelist, index_file_name_tmp, graph_count, thread_num);
+    if(rename(index_file_name_tmp.c_str(), index_file_name.c_str()) != 0){
+        cout<<"renaming index file error:"<<index_file_name<<endl;
+        exit(-1);
     }
-    merge_multi_index_files_with_bounded_memory(filelist, index_file_name);
     for(auto file : filelist){
         int flag = remove(file.c_str());
         if(flag != 0){
             cout<<"removing temporary index file error:"<<file<<endl;
         }
     }
+    return true;
 }
 
 void Index_constructer::analyse_redundant_features(vector<vector<Label>>& features, vector<vector<bool>>& redundant_mask){
@@ -452,4 +458,155 @@ vector<Tensor*> Index_constructer::count_with_multi_thread(Graph& graph, int thr
         }
     }
     return final_results;
-}
\ No newline at end of file
+}
+
+// the graphs of a database build, handed out from the window [written, written+window) and
+// collected in results until the writer takes them
+struct database_queue{
+    vector<Graph>* graphs;
+    vector<size_t> graph_size;
+    vector<bool> taken;
+    size_t remaining; // graphs not taken yet
+    size_t written; // the graphs before it are written
+    size_t window;
+    vector<Tensor*> results;
+    pthread_mutex_t lock;
+    pthread_cond_t ready; // a result is counted
+    pthread_cond_t advanced; // the window moved
+};
+
+struct database_task{
+    database_queue* queue;
+    feature_counter* counter;
+    vector<vector<bool>>* redundant_mask; // NULL without the residual mechanism
+    int level;
+    double build_time;
+};
+
+static void* database_count_func(void* arg){
+    database_task& task = *((database_task*)arg);
+    database_queue& queue = *(task.queue);
+    Index_constructer constructor(task.counter);
+    constructor.build_time = 0;
+    while(true){
+        // the largest graph left in the window, waiting for the writer if all of them are taken
+        int g = -1;
+        pthread_mutex_lock(&queue.lock);
+        while(queue.remaining > 0){
+            size_t end = min(queue.written+queue.window, queue.taken.size());
+            for(size_t i=queue.written; i<end; ++i){
+                if(!queue.taken[i] && (g < 0 || queue.graph_size[i] > queue.graph_size[g])){
+                    g = i;
+                }
+            }
+            if(g >= 0){
+                break;
+            }
+            pthread_cond_wait(&queue.advanced, &queue.lock);
+        }
+        if(g < 0){
+            pthread_mutex_unlock(&queue.lock);
+            break;
+        }
+        queue.taken[g] = true;
+        queue.remaining --;
+        pthread_mutex_unlock(&queue.lock);
+
+        vector<Tensor*> results = constructor.count_with_multi_thread((*queue.graphs)[g], 1, task.level);
+        Tensor* result;
+        if(task.redundant_mask != NULL){
+            result = merge_multi_Tensors_with_mask(results, *(task.redundant_mask));
+            for(auto t : results){
+                delete t;
+            }
+        }else{
+            result = results[0];
+        }
+
+        pthread_mutex_lock(&queue.lock);
+        queue.results[g] = result;
+        pthread_cond_signal(&queue.ready);
+        pthread_mutex_unlock(&queue.lock);
+    }
+    task.build_time = constructor.build_time;
+    return NULL;
+}
+
+Graph_database_index_constructer::Graph_database_index_constructer(feature_counter* counter_){
+    counter = counter_;
+    build_time = 0;
+}
+
+void Graph_database_index_constructer::construct_index(vector<Graph>& graphs, string index_file_name, int thread_num, int level){
+    build_time = 0;
+    vector<vector<bool>> redundant_mask;
+    if(counter->get_residual()){
+        vector<vector<Label>> features = counter->get_features();
+        Index_constructer analyser(counter);
+        analyser.analyse_redundant_features(features, redundant_mask);
+    }
+    thread_num = ((size_t)thread_num > graphs.size()) ? graphs.size() : thread_num;
+    thread_num = (thread_num < 1) ? 1 : thread_num;
+
+    database_queue queue;
+    queue.graphs = &graphs;
+    // largest first within the window, by the adjacency entries to scan
+    queue.graph_size.resize(graphs.size());
+    for(size_t g=0; g<graphs.size(); ++g){
+        queue.graph_size[g] = graphs[g].label_map.size()+2*(size_t)graphs[g].get_edge_count();
+    }
+    queue.taken.assign(graphs.size(), false);
+    queue.remaining = graphs.size();
+    queue.written = 0;
+    queue.window = (size_t)DATABASE_WINDOW_PER_THREAD*thread_num;
+    queue.results.assign(graphs.size(), NULL);
+    pthread_mutex_init(&queue.lock, NULL);
+    pthread_cond_init(&queue.ready, NULL);
+    pthread_cond_init(&queue.advanced, NULL);
+    vector<database_task> tasks(thread_num);
+    pthread_t* threads = new pthread_t [thread_num];
+    for(int i=0;i<thread_num;++i){
+        tasks[i].queue = &queue;
+        if(counter->get_feature_type() == 1){
+            tasks[i].counter = new Cycle_counter(counter);
+        }else{
+            tasks[i].counter = new Path_counter(counter);
+        }
+        tasks[i].redundant_mask = counter->get_residual() ? &redundant_mask : NULL;
+        tasks[i].level = level;
+        tasks[i].build_time = 0;
+        int res = pthread_create(&(threads[i]), NULL, database_count_func, (void*)&tasks[i]);
+        if(res != 0){
+            cout<<"Create thread:"<<i<<" failed for graph database construction"<<endl;
+            exit(res);
+        }
+    }
+
+    // the tensors are written by graph id, each one as soon as it and all before it are counted
+    ofstream fout(index_file_name, ios::binary|ios::app);
+    for(size_t g=0; g<graphs.size(); ++g){
+        pthread_mutex_lock(&queue.lock);
+        while(queue.results[g] == NULL){
+            pthread_cond_wait(&queue.ready, &queue.lock);
+        }
+        Tensor* result = queue.results[g];
+        queue.results[g] = NULL;
+        queue.written = g+1;
+        pthread_cond_broadcast(&queue.advanced);
+        pthread_mutex_unlock(&queue.lock);
+        result->dump_tensor(fout);
+        delete result;
+    }
+    fout.close();
+
+    for(int i=0;i<thread_num;++i){
+        void* ret;
+        pthread_join(threads[i], &ret);
+        build_time += tasks[i].build_time;
+        delete tasks[i].counter;
+    }
+    delete [] threads;
+    pthread_mutex_destroy(&queue.lock);
+    pthread_cond_destroy(&queue.ready);
+    pthread_cond_destroy(&queue.advanced);
+}
@@ -5,6 +5,7 @@
 #include "feature_counter.h"
 #include "cycle_counting.h"
 #include "path_counting.h"
+#include "checkpoint.h"
 
 void print_features(vector<vector<Label>> features);
 
@@ -12,10 +13,6 @@ void* thread_count(void* arg);
 
 Tensor* get_frequency_from_multi_counters(Graph& graph, vector<feature_counter*>& counter_list, int level, int thread_num=1);
 
-typedef tuple<Graph*, pair<Vertex, Vertex>*, Vertex**, int> input_para;
-
-void* compute_common_neighbor_func(void* args);
-
 // compute the common edge neighbors for graph
 void common_edge_neighbor_multi_threads(Graph* graph, int thread_num);
 
@@ -29,12 +26,54 @@ public:
 
     void construct_index_single_batch(Graph& graph, string index_file_name, int thread_num, int level);
 
-    // note that residual mechanism is not supported
-    void construct_index_in_batch(Graph& graph, string index_file_name, int max_feature_size_per_batch, int thread_num, int level);
+    // note that residual mechanism is not supported. With a checkpoint, every batch is recorded once
+    // its split files are written and the recorded batches are not counted again
+    void construct_index_in_batch(Graph& graph, string index_file_name, int max_feature_size_per_batch, int thread_num, int level, Build_checkpoint* checkpoint=NULL);
+
+    // construct_index_in_batch for the disjoint union of several graphs (see Graph::disjoint_union):
+    // all of them are counted in one pass per batch and the index file holds one tensor per graph,
+    // the g-th one made of the rows [row_offsets[g], row_offsets[g+1]) of the union
+    void construct_index_for_graphs(Graph& graph, vector<Vertex>& row_offsets, string index_file_name, int max_feature_size_per_batch, int thread_num, int level, Build_checkpoint* checkpoint=NULL);
+
+    /**
+     * One shard of a build split over processes. The features are cut into batches of
+     * max_feature_size_per_batch and shard shard_id of shard_num counts the batches b with
+     * b%shard_num == shard_id for all graphs. Every batch goes to its own partial files (one per
+     * level with the residual mechanism), written under a temporary name and renamed when the batch
+     * is complete, so a restarted shard skips the batches it already finished.
+     */
+    void construct_index_shard(vector<Graph>& graphs, string index_file_name, int max_feature_size_per_batch, int shard_id, int shard_num, int thread_num, int level);
+
+    // concatenates the partial files of all batches into the index file and removes them; false if
+    // a batch is not finished yet
+    bool merge_shards(int graph_count, string index_file_name, int max_feature_size_per_batch, int thread_num);
 
     void analyse_redundant_features(vector<vector<Label>>& features, vector<vector<bool>>& redundant_mask);
 
     Tensor* count_features(Graph& graph, int thread_num, int level);
 
     vector<Tensor*> count_with_multi_thread(Graph& graph, int thread_num, int level);
+
+private:
+    // the partial files of a batch, one per level
+    vector<string> get_batch_files(string index_file_name, int batch_id);
+};
+
+/**
+ * Builds the index of a graph database, i.e., many small graphs, with a pool of threads that take
+ * whole graphs from a window of DATABASE_WINDOW_PER_THREAD graphs per thread past the last written
+ * one, the largest ones of the window first so that no big graph is left for its end. Every thread
+ * counts with its own copy of the counter and all features of a graph at once. The calling thread
+ * writes the tensors in the order of the graph ids as they become available and moves the window,
+ * so at most a window of tensors waits in memory and the file is the same as that of counting the
+ * graphs one after another.
+ */
+class Graph_database_index_constructer{
+public:
+    feature_counter* counter;
+    double build_time; // summed over the threads
+
+    Graph_database_index_constructer(feature_counter* counter_);
+
+    void construct_index(vector<Graph>& graphs, string index_file_name, int thread_num, int level);
 };
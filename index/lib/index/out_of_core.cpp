@@ -0,0 +1,460 @@
+#include "out_of_core.h"
+#include "index.h"
+
+Tensor_file::Tensor_file(string path_, size_t row_size_, int column_size_){
+    path = path_;
+    row_size = row_size_;
+    column_size = column_size_;
+    data = NULL;
+    byte_size = row_size*column_size*sizeof(Value);
+    fd = open(path.c_str(), O_RDWR|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR);
+    if(fd < 0 || ftruncate(fd, byte_size) != 0){
+        cout<<"cannot create the temporary file "<<path<<":"<<strerror(errno)<<endl;
+        exit(-1);
+    }
+}
+
+void Tensor_file::write_rows(size_t row_begin, size_t row_count, Value* rows){
+    char* buffer = (char*)rows;
+    size_t remaining = row_count*column_size*sizeof(Value);
+    off_t offset = row_begin*column_size*sizeof(Value);
+    while(remaining > 0){
+        ssize_t written = pwrite(fd, buffer, remaining, offset);
+        if(written < 0){
+            cout<<"cannot write the temporary file "<<path<<":"<<strerror(errno)<<endl;
+            exit(-1);
+        }
+        buffer += written;
+        offset += written;
+        remaining -= written;
+    }
+}
+
+void Tensor_file::fill(Value value, size_t rows_per_write){
+    vector<Value> rows(rows_per_write*column_size, value);
+    for(size_t begin=0; begin<row_size; begin+=rows_per_write){
+        size_t row_count = (row_size-begin < rows_per_write) ? row_size-begin : rows_per_write;
+        write_rows(begin, row_count, &(rows[0]));
+    }
+}
+
+Value* Tensor_file::map(){
+    if(data == NULL && byte_size > 0){
+        void* mapped = mmap(NULL, byte_size, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapped == MAP_FAILED){
+            cout<<"cannot map the temporary file "<<path<<":"<<strerror(errno)<<endl;
+            exit(-1);
+        }
+        data = (Value*)mapped;
+    }
+    return data;
+}
+
+void Tensor_file::release(){
+    if(data != NULL){
+        madvise(data, byte_size, MADV_DONTNEED);
+    }
+}
+
+void Tensor_file::unmap(){
+    if(data != NULL){
+        munmap(data, byte_size);
+        data = NULL;
+    }
+}
+
+Tensor_file::~Tensor_file(){
+    unmap();
+    close(fd);
+    remove(path.c_str());
+}
+
+//////////////////////////////////////
+// a range of the rows of a shard computed by one thread
+struct propagation_task{
+    Graph* graph;
+    unordered_map<Label, vector<Value>>* mask_map;
+    Value* prev; // the mapped previous state
+    Value* prev_reverse; // cycles only
+    Value* buffer; // the rows of the shard, starting at shard_begin
+    Value* buffer_reverse; // cycles only
+    size_t shard_begin;
+    size_t begin; // rows [begin, end)
+    size_t end;
+    int column_size;
+};
+
+static void* propagate_path_rows_func(void* arg){
+    propagation_task& task = *((propagation_task*)arg);
+    Graph& graph = *task.graph;
+    unordered_map<Label, vector<Value>>& mask_map = *task.mask_map;
+    int feature_num = task.column_size;
+    for(Vertex v=task.begin; v<task.end; ++v){
+        Value* embedding_cur = task.buffer+(v-task.shard_begin)*feature_num;
+        for(auto n : graph.adj[v]){
+            auto itf = mask_map.find(graph.label_map[n]);
+            if(itf == mask_map.end()){
+                continue;
+            }
+            vector<Value>& mask = itf->second;
+            vector_add_mul(embedding_cur, task.prev+(size_t)n*feature_num, &(mask[0]), feature_num);
+        }
+    }
+    return NULL;
+}
+
+static void* propagate_cycle_rows_func(void* arg){
+    propagation_task& task = *((propagation_task*)arg);
+    Graph& graph = *task.graph;
+    unordered_map<Label, vector<Value>>& mask_map = *task.mask_map;
+    int extended_num = task.column_size;
+    for(Vertex e_id=task.begin; e_id<task.end; ++e_id){
+        Value* embedding_cur = task.buffer+(e_id-task.shard_begin)*extended_num;
+        Value* embedding_cur_reverse = task.buffer_reverse+(e_id-task.shard_begin)*extended_num;
+        Vertex small_id = graph.edge_set[e_id*2];
+        Vertex large_id = graph.edge_set[e_id*2+1];
+        Vertex* n_neighbors = graph.common_edge_neighbor[e_id];
+        Vertex neighbor_size = n_neighbors[0];
+        for(Vertex itr=0; itr<neighbor_size; ++itr){
+            Vertex n = n_neighbors[itr*3+1];
+            size_t small_e_id = n_neighbors[itr*3+2];
+            size_t large_e_id = n_neighbors[itr*3+3];
+            auto itf = mask_map.find(graph.label_map[n]);
+            if(itf == mask_map.end()){
+                continue;
+            }
+            Value* mask = &(itf->second[0]);
+            Value* small_prev = ((n<small_id) ? task.prev : task.prev_reverse)+small_e_id*extended_num;
+            Value* large_prev = ((n<large_id) ? task.prev : task.prev_reverse)+large_e_id*extended_num;
+            vector_add_mul(embedding_cur_reverse, small_prev, mask, extended_num);
+            vector_add_mul(embedding_cur, large_prev, mask, extended_num);
+        }
+    }
+    return NULL;
+}
+
+// splits the rows [begin, end) of the shard of task evenly over the threads; every row only
+// depends on the previous state, so the rows come out as with one thread
+static void run_propagation_tasks(void* (*func)(void*), propagation_task& task, int thread_num){
+    size_t row_count = task.end-task.begin;
+    thread_num = ((size_t)thread_num < row_count) ? thread_num : row_count;
+    thread_num = (thread_num < 1) ? 1 : thread_num;
+    if(thread_num == 1){
+        func((void*)&task);
+        return;
+    }
+    vector<propagation_task> tasks(thread_num, task);
+    for(int i=0;i<thread_num;++i){
+        tasks[i].begin = task.begin+row_count*i/thread_num;
+        tasks[i].end = task.begin+row_count*(i+1)/thread_num;
+    }
+    pthread_t* threads = new pthread_t [thread_num];
+    for(int i=0;i<thread_num;++i){
+        int res = pthread_create(&(threads[i]), NULL, func, (void*)&tasks[i]);
+        if(res != 0){
+            cout<<"Create thread:"<<i<<" failed for out-of-core propagation"<<endl;
+            exit(res);
+        }
+    }
+    for(int i=0;i<thread_num;++i){
+        void* ret;
+        pthread_join(threads[i], &ret);
+    }
+    delete [] threads;
+}
+
+//////////////////////////////////////
+Out_of_core_index_constructer::Out_of_core_index_constructer(feature_counter* counter_, size_t memory_budget_, string tmp_dir_, int thread_num_){
+    counter = counter_;
+    memory_budget = memory_budget_;
+    tmp_dir = tmp_dir_;
+    thread_num = thread_num_;
+    build_time = 0;
+}
+
+size_t Out_of_core_index_constructer::rows_per_shard(size_t row_bytes, size_t row_size){
+    size_t rows = memory_budget/row_bytes;
+    rows = (rows < row_size) ? rows : row_size;
+    return (rows > 0) ? rows : 1;
+}
+
+void Out_of_core_index_constructer::construct_index(Graph& graph, string index_file_name, int level){
+    struct timeval start_t, end_t;
+    gettimeofday(&start_t, NULL);
+    build_time = 0;
+
+    vector<vector<Label>> features = counter->get_features();
+    vector<vector<bool>> redundant_mask;
+    if(counter->get_residual()){
+        Index_constructer analyser;
+        analyser.analyse_redundant_features(features, redundant_mask);
+    }else{
+        redundant_mask.push_back(vector<bool>(features.size(), true));
+    }
+    size_t row_size = (level == 1) ? graph.get_edge_count() : graph.adj.size();
+    level_spans.clear();
+    for(size_t i=0;i<redundant_mask.size();++i){
+        vector<pair<int, int>> spans;
+        int column_size = 0;
+        for(int j=0;j<(int)redundant_mask[i].size();++j){
+            if(!redundant_mask[i][j]){
+                continue;
+            }
+            if(spans.empty() || spans.back().second != j){
+                spans.push_back({j, j});
+            }
+            spans.back().second = j+1;
+            column_size ++;
+        }
+        level_spans.push_back(spans);
+        level_files.push_back(new Tensor_file(tmp_dir+string("/level_")+to_string(i), row_size, column_size));
+    }
+
+    graph.set_up_edge_id_map();
+    if(counter->get_feature_type() == 1){
+        count_cycles(graph, level);
+    }else{
+        count_paths(graph, level);
+    }
+    dump_index(index_file_name);
+
+    for(auto file : level_files){
+        delete file;
+    }
+    level_files.clear();
+    gettimeofday(&end_t, NULL);
+    build_time = get_time(start_t, end_t);
+}
+
+void Out_of_core_index_constructer::write_level(int level_id, size_t row_begin, size_t row_count, Value* rows, int column_size){
+    Tensor_file* file = level_files[level_id];
+    vector<pair<int, int>>& spans = level_spans[level_id];
+    vector<Value> buffer(row_count*file->column_size);
+    for(size_t i=0;i<row_count;++i){
+        Value* target = &(buffer[i*file->column_size]);
+        Value* source = rows+i*column_size;
+        for(auto& span : spans){
+            memcpy(target, source+span.first, (span.second-span.first)*sizeof(Value));
+            target += span.second-span.first;
+        }
+    }
+    file->write_rows(row_begin, row_count, buffer.data());
+}
+
+void Out_of_core_index_constructer::count_paths(Graph& graph, int level){
+    Path_counter path_counter(counter);
+    bool enable_residual = path_counter.enable_residual;
+    int feature_num = path_counter.original_features.size();
+    int total_iterations = path_counter.original_features[0].size();
+    size_t vertex_count = graph.adj.size();
+    size_t shard_size = rows_per_shard(feature_num*sizeof(Value), vertex_count);
+
+    Tensor_file* state_prev = new Tensor_file(tmp_dir+string("/state_0"), vertex_count, feature_num);
+    Tensor_file* state_cur = new Tensor_file(tmp_dir+string("/state_1"), vertex_count, feature_num);
+    state_prev->fill(1, shard_size);
+    vector<Value> buffer(shard_size*feature_num);
+    int level_id = 0;
+    for(int iteration=0; iteration<total_iterations; ++iteration){
+        propagation_task task = {&graph, &(path_counter.mask_maps[iteration]), state_prev->map(), NULL, &(buffer[0]), NULL, 0, 0, 0, feature_num};
+        for(size_t begin=0; begin<vertex_count; begin+=shard_size){
+            size_t end = (vertex_count-begin < shard_size) ? vertex_count : begin+shard_size;
+            memset(&(buffer[0]), 0, (end-begin)*feature_num*sizeof(Value));
+            task.shard_begin = task.begin = begin;
+            task.end = end;
+            run_propagation_tasks(propagate_path_rows_func, task, thread_num);
+            state_cur->write_rows(begin, end-begin, &(buffer[0]));
+            state_prev->release();
+        }
+        state_prev->unmap();
+        if((enable_residual == true && iteration < total_iterations-1) || iteration == total_iterations-1){
+            write_path_level(graph, state_cur, level, level_id++);
+        }
+        swap(state_prev, state_cur);
+    }
+    delete state_prev;
+    delete state_cur;
+}
+
+void Out_of_core_index_constructer::write_path_level(Graph& graph, Tensor_file* state, int level, int level_id){
+    int feature_num = state->column_size;
+    size_t shard_size = rows_per_shard(feature_num*sizeof(Value), (level == 1) ? graph.get_edge_count() : state->row_size);
+    Value* embeddings = state->map();
+    if(level == 0){
+        for(size_t begin=0; begin<state->row_size; begin+=shard_size){
+            size_t end = (state->row_size-begin < shard_size) ? state->row_size : begin+shard_size;
+            write_level(level_id, begin, end-begin, embeddings+begin*feature_num, feature_num);
+            state->release();
+        }
+    }else{
+        size_t edge_count = graph.get_edge_count();
+        vector<Value> buffer(shard_size*feature_num);
+        for(size_t begin=0; begin<edge_count; begin+=shard_size){
+            size_t end = (edge_count-begin < shard_size) ? edge_count : begin+shard_size;
+            memset(&(buffer[0]), 0, (end-begin)*feature_num*sizeof(Value));
+            for(Vertex e_id=begin; e_id<end; ++e_id){
+                Value* row = &(buffer[(e_id-begin)*feature_num]);
+                vector_add(row, embeddings+(size_t)graph.edge_set[e_id*2]*feature_num, feature_num);
+                vector_add(row, embeddings+(size_t)graph.edge_set[e_id*2+1]*feature_num, feature_num);
+            }
+            write_level(level_id, begin, end-begin, &(buffer[0]), feature_num);
+            state->release();
+        }
+    }
+    state->unmap();
+}
+
+void Out_of_core_index_constructer::count_cycles(Graph& graph, int level){
+    Cycle_counter cycle_counter(counter);
+    bool enable_residual = cycle_counter.enable_residual;
+    int extended_num = cycle_counter.extended_features.size();
+    int total_iterations = cycle_counter.original_features[0].size();
+    size_t edge_count = graph.get_edge_count();
+    size_t shard_size = rows_per_shard(2*extended_num*sizeof(Value), edge_count);
+    graph.construct_edge_common_neighbor(thread_num);
+
+    Tensor_file* state_prev = new Tensor_file(tmp_dir+string("/state_0"), edge_count, extended_num); // v<-n
+    Tensor_file* state_prev_reverse = new Tensor_file(tmp_dir+string("/state_0_reverse"), edge_count, extended_num); // v->n
+    Tensor_file* state_cur = new Tensor_file(tmp_dir+string("/state_1"), edge_count, extended_num);
+    Tensor_file* state_cur_reverse = new Tensor_file(tmp_dir+string("/state_1_reverse"), edge_count, extended_num);
+    state_prev->fill(1, 2*shard_size);
+    state_prev_reverse->fill(1, 2*shard_size);
+    int level_id = 0;
+    if(level == 0 && (enable_residual || total_iterations == 1)){
+        write_cycle_vertex_level(graph, state_prev, state_prev_reverse, cycle_counter.mask_maps[0], level_id++);
+    }
+    // the vertex counts close the cycles one step earlier than the edge counts
+    int iterations = (level == 1) ? total_iterations : total_iterations-1;
+    vector<Value> buffer(shard_size*extended_num);
+    vector<Value> buffer_reverse(shard_size*extended_num);
+    for(int iteration=0; iteration<iterations; ++iteration){
+        propagation_task task = {&graph, &(cycle_counter.mask_maps[iteration]), state_prev->map(), state_prev_reverse->map(), &(buffer[0]), &(buffer_reverse[0]), 0, 0, 0, extended_num};
+        for(size_t begin=0; begin<edge_count; begin+=shard_size){
+            size_t end = (edge_count-begin < shard_size) ? edge_count : begin+shard_size;
+            memset(&(buffer[0]), 0, (end-begin)*extended_num*sizeof(Value));
+            memset(&(buffer_reverse[0]), 0, (end-begin)*extended_num*sizeof(Value));
+            task.shard_begin = task.begin = begin;
+            task.end = end;
+            run_propagation_tasks(propagate_cycle_rows_func, task, thread_num);
+            state_cur->write_rows(begin, end-begin, &(buffer[0]));
+            state_cur_reverse->write_rows(begin, end-begin, &(buffer_reverse[0]));
+            state_prev->release();
+            state_prev_reverse->release();
+        }
+        state_prev->unmap();
+        state_prev_reverse->unmap();
+        if(level == 1){
+            if((enable_residual == true && iteration < total_iterations-1) || iteration == total_iterations-1){
+                write_cycle_edge_level(state_cur, state_cur_reverse, level_id++);
+            }
+        }else{
+            if((enable_residual == true && iteration < total_iterations-2) || iteration == total_iterations-2){
+                write_cycle_vertex_level(graph, state_cur, state_cur_reverse, cycle_counter.mask_maps[iteration+1], level_id++);
+            }
+        }
+        swap(state_prev, state_cur);
+        swap(state_prev_reverse, state_cur_reverse);
+    }
+    delete state_prev;
+    delete state_prev_reverse;
+    delete state_cur;
+    delete state_cur_reverse;
+}
+
+void Out_of_core_index_constructer::write_cycle_edge_level(Tensor_file* state, Tensor_file* state_reverse, int level_id){
+    int extended_num = state->column_size;
+    int feature_num = extended_num/2;
+    size_t edge_count = state->row_size;
+    size_t shard_size = rows_per_shard(feature_num*sizeof(Value), edge_count);
+    Value* cycle_content = state->map();
+    Value* cycle_reverse_content = state_reverse->map();
+    vector<Value> buffer(shard_size*feature_num);
+    for(size_t begin=0; begin<edge_count; begin+=shard_size){
+        size_t end = (edge_count-begin < shard_size) ? edge_count : begin+shard_size;
+        memset(&(buffer[0]), 0, (end-begin)*feature_num*sizeof(Value));
+        for(size_t e_id=begin; e_id<end; ++e_id){
+            Value* r = &(buffer[(e_id-begin)*feature_num]);
+            vector_add(r, cycle_content+e_id*extended_num, feature_num);
+            vector_add(r, cycle_content+e_id*extended_num+feature_num, feature_num);
+            vector_add(r, cycle_reverse_content+e_id*extended_num, feature_num);
+            vector_add(r, cycle_reverse_content+e_id*extended_num+feature_num, feature_num);
+        }
+        write_level(level_id, begin, end-begin, &(buffer[0]), feature_num);
+        state->release();
+        state_reverse->release();
+    }
+    state->unmap();
+    state_reverse->unmap();
+}
+
+void Out_of_core_index_constructer::write_cycle_vertex_level(Graph& graph, Tensor_file* state, Tensor_file* state_reverse, unordered_map<Label, vector<Value>>& mask_map, int level_id){
+    int extended_num = state->column_size;
+    int feature_num = extended_num/2;
+    size_t vertex_count = graph.adj.size();
+    size_t shard_size = rows_per_shard(feature_num*sizeof(Value), vertex_count);
+    Value* cycle_content = state->map();
+    Value* reversed_cycle_content = state_reverse->map();
+    vector<Value> buffer(shard_size*feature_num);
+    for(size_t begin=0; begin<vertex_count; begin+=shard_size){
+        size_t end = (vertex_count-begin < shard_size) ? vertex_count : begin+shard_size;
+        memset(&(buffer[0]), 0, (end-begin)*feature_num*sizeof(Value));
+        for(Vertex v=begin; v<end; ++v){
+            Value* result_vec = &(buffer[(v-begin)*feature_num]);
+            for(auto n : graph.adj[v]){
+                auto itf = mask_map.find(graph.label_map[n]);
+                if(itf == mask_map.end()){
+                    continue;
+                }
+                vector<Value>& mask = itf->second;
+                if(v<n){
+                    size_t e_id = graph.edge_id_map[v][n];
+                    vector_add_mul(result_vec, reversed_cycle_content+e_id*extended_num, &(mask[0]), feature_num);
+                    vector_add_mul(result_vec, cycle_content+e_id*extended_num+feature_num, &(mask[feature_num]), feature_num);
+                }else{
+                    size_t e_id = graph.edge_id_map[n][v];
+                    vector_add_mul(result_vec, cycle_content+e_id*extended_num, &(mask[0]), feature_num);
+                    vector_add_mul(result_vec, reversed_cycle_content+e_id*extended_num+feature_num, &(mask[feature_num]), feature_num);
+                }
+            }
+        }
+        write_level(level_id, begin, end-begin, &(buffer[0]), feature_num);
+        state->release();
+        state_reverse->release();
+    }
+    state->unmap();
+    state_reverse->unmap();
+}
+
+// the same layout as Index_manager::dump_tensor of the merged levels
+void Out_of_core_index_constructer::dump_index(string index_file_name){
+    size_t row_size = level_files[0]->row_size;
+    int column_size = 0;
+    vector<Value*> levels;
+    for(auto file : level_files){
+        column_size += file->column_size;
+        levels.push_back(file->map());
+    }
+    ofstream fout(index_file_name, ios::binary|ios::app);
+    int rows = row_size;
+    fout.write((char*)&rows, sizeof(int));
+    fout.write((char*)&column_size, sizeof(int));
+    size_t shard_size = rows_per_shard(column_size*sizeof(Value), row_size);
+    vector<Value> row(column_size);
+    for(size_t i=0; i<row_size; ++i){
+        Value* target = &(row[0]);
+        for(size_t j=0;j<level_files.size();++j){
+            int level_column_size = level_files[j]->column_size;
+            memcpy(target, levels[j]+i*level_column_size, level_column_size*sizeof(Value));
+            target += level_column_size;
+        }
+        dump_vector(fout, &(row[0]), column_size);
+        if((i+1)%shard_size == 0){
+            for(auto file : level_files){
+                file->release();
+            }
+        }
+    }
+    fout.close();
+    for(auto file : level_files){
+        file->unmap();
+    }
+}
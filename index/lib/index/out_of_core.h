@@ -0,0 +1,77 @@
+#pragma once
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../graph/graph.h"
+#include "../utility/embedding.h"
+#include "../utility/utils.h"
+#include "feature_counter.h"
+#include "cycle_counting.h"
+#include "path_counting.h"
+
+// A row-major matrix of Values kept in a file. Rows are written by ranges and read through a
+// read-only mapping, so only the pages in use occupy memory. The file is removed on destruction.
+class Tensor_file{
+public:
+    string path;
+    size_t row_size;
+    int column_size;
+
+    Tensor_file(string path_, size_t row_size_, int column_size_);
+
+    void write_rows(size_t row_begin, size_t row_count, Value* rows);
+    void fill(Value value, size_t rows_per_write);
+
+    Value* map();
+    // drops the mapped pages, they are read from the file again when accessed
+    void release();
+    void unmap();
+
+    ~Tensor_file();
+
+private:
+    int fd;
+    Value* data;
+    size_t byte_size;
+};
+
+/**
+ * Index construction for graphs whose counting state does not fit in memory. The propagation state
+ * of every iteration is a Tensor_file; the next one is computed shard by shard (ranges of vertices,
+ * or edges for cycles) into buffers of at most memory_budget bytes, reading the rows of the
+ * previous state, including the ghost rows of neighbors outside the shard, through its mapping.
+ * The index rows of every level go to a Tensor_file as well and are concatenated row by row into
+ * the index file at the end.
+ *
+ * The counts and their summation order are those of Path_counter and Cycle_counter, so the index
+ * file is identical to the in-memory one. The graph and the edge common neighbors stay in memory.
+ */
+class Out_of_core_index_constructer{
+public:
+    feature_counter* counter;
+    size_t memory_budget; // bytes
+    string tmp_dir;
+    int thread_num; // the rows of a shard are split over the threads
+    double build_time;
+
+    Out_of_core_index_constructer(feature_counter* counter_, size_t memory_budget_, string tmp_dir_, int thread_num_);
+
+    void construct_index(Graph& graph, string index_file_name, int level);
+
+private:
+    vector<Tensor_file*> level_files;
+    vector<vector<pair<int, int>>> level_spans; // non-redundant columns of every level
+
+    // shard size for rows of row_bytes bytes, at most row_size
+    size_t rows_per_shard(size_t row_bytes, size_t row_size);
+
+    void count_paths(Graph& graph, int level);
+    void count_cycles(Graph& graph, int level);
+
+    // rows of the features of the level_id-th level, the redundant ones are dropped
+    void write_level(int level_id, size_t row_begin, size_t row_count, Value* rows, int column_size);
+    void write_path_level(Graph& graph, Tensor_file* state, int level, int level_id);
+    void write_cycle_edge_level(Tensor_file* state, Tensor_file* state_reverse, int level_id);
+    void write_cycle_vertex_level(Graph& graph, Tensor_file* state, Tensor_file* state_reverse, unordered_map<Label, vector<Value>>& mask_map, int level_id);
+    void dump_index(string index_file_name);
+};
@@ -31,6 +31,7 @@ void Path_counter::feature_initialization(){
         }
         slot_labels.push_back(inner);
     }
+    trie = Suffix_trie(slot_labels);
 }
 
 int Path_counter::get_feature_type(){
@@ -86,6 +87,24 @@ Tensor* Path_counter::merge_paths_for_edges(Graph& graph, Tensor* path_tensor){
     return result;
 }
 
+void Path_counter::propagate(Graph& graph, int iteration, Tensor* tensor_prev, Tensor* tensor_cur){
+    unordered_map<Label, pair<int, int>>& label_range = trie.label_ranges[iteration];
+    int* parents = &(trie.parents[iteration][0]);
+    uint32_t vertex_count = graph.adj.size();
+    Value** embeddings_prev = tensor_prev->content;
+    for(Vertex v=0; v<vertex_count; ++v){
+        Value* embedding_cur = tensor_cur->content[v];
+        for(auto n : graph.adj[v]){
+            auto itf = label_range.find(graph.label_map[n]);
+            if(itf == label_range.end()){
+                continue;
+            }
+            Value* cur = embedding_cur+itf->second.first;
+            vector_add_gather(cur, embeddings_prev[n], parents+itf->second.first, itf->second.second-itf->second.first);
+        }
+    }
+}
+
 void Path_counter::count_for_edges(Graph& graph, Tensor**& result, int& result_size){
 #ifdef ENABLE_TIME_INFO
     struct timeval start_t, end_t;
@@ -98,33 +117,22 @@ void Path_counter::count_for_edges(Graph& graph, Tensor**& result, int& result_s
     result = new Tensor* [result_size];
     int offset = 0;
     uint32_t vertex_count = graph.adj.size();
-    Tensor* tensor_prev= new Tensor(vertex_count, original_features.size(), 1); // v<-n
-    Tensor* tensor_cur = new Tensor(vertex_count, original_features.size(), 0);
+    // the states of an iteration fill the first columns, those of the root (the first one) are ones
+    Tensor* tensor_prev= new Tensor(vertex_count, trie.max_state_num(), 1); // v<-n
+    Tensor* tensor_cur = new Tensor(vertex_count, trie.max_state_num(), 0);
     int total_iterations = original_features[0].size();
     for(int iteration=0; iteration<total_iterations; ++iteration){
 #ifdef ENABLE_TIME_INFO
         cout<<"iteration:"<<iteration<<endl;
         gettimeofday(&start_t, NULL);
 #endif
-        // initialize the mask
-        unordered_map<Label, vector<Value>>& mask_map = mask_maps[iteration];
-        // iterate the vertices in order
-        Value** embeddings_prev = tensor_prev->content;
-        for(Vertex v=0; v<vertex_count; ++v){
-            Value* embedding_cur = tensor_cur->content[v];
-            for(auto n : graph.adj[v]){
-                auto itf = mask_map.find(graph.label_map[n]);
-                if(itf == mask_map.end()){
-                    continue;
-                }
-                vector<Value>& mask = itf->second;
-                vector_add_mul(embedding_cur, embeddings_prev[n], &(mask[0]), mask.size());
-            }
-        }
+        propagate(graph, iteration, tensor_prev, tensor_cur);
         // swap the embedding
         tensor_prev->clear_content();
         if(enable_residual == true && iteration < total_iterations-1){
-            result[offset++] = merge_paths_for_edges(graph, tensor_cur);
+            Tensor* features = trie.expand(tensor_cur, iteration);
+            result[offset++] = merge_paths_for_edges(graph, features);
+            delete features;
         }
         swap(tensor_prev, tensor_cur);
 #ifdef ENABLE_TIME_INFO
@@ -132,12 +140,11 @@ void Path_counter::count_for_edges(Graph& graph, Tensor**& result, int& result_s
         cout<<"iteration:"<<iteration<<":"<<get_time(start_t, end_t)<<endl;
 #endif
     }
-    result[offset++] = merge_paths_for_edges(graph, tensor_prev);
-    // Tensor* result = new Tensor(tensor_prev);
-    // history_result->push_back(result);
+    Tensor* features = trie.expand(tensor_prev, total_iterations-1);
+    result[offset++] = merge_paths_for_edges(graph, features);
+    delete features;
     delete tensor_prev;
     delete tensor_cur;
-    // return history_result;
 }
 
 void Path_counter::count_for_vertices(Graph& graph, Tensor**& result, int& result_size){
@@ -152,33 +159,19 @@ void Path_counter::count_for_vertices(Graph& graph, Tensor**& result, int& resul
     result = new Tensor* [result_size];
     int offset = 0;
     uint32_t vertex_count = graph.adj.size();
-    Tensor* tensor_prev= new Tensor(vertex_count, original_features.size(), 1); // v<-n
-    Tensor* tensor_cur = new Tensor(vertex_count, original_features.size(), 0);
+    Tensor* tensor_prev= new Tensor(vertex_count, trie.max_state_num(), 1); // v<-n
+    Tensor* tensor_cur = new Tensor(vertex_count, trie.max_state_num(), 0);
     int total_iterations = original_features[0].size();
     for(int iteration=0; iteration<total_iterations; ++iteration){
 #ifdef ENABLE_TIME_INFO
         cout<<"iteration:"<<iteration<<endl;
         gettimeofday(&start_t, NULL);
 #endif
-        // initialize the mask
-        unordered_map<Label, vector<Value>>& mask_map = mask_maps[iteration];
-        // iterate the vertices in order
-        Value** embeddings_prev = tensor_prev->content;
-        for(Vertex v=0; v<vertex_count; ++v){
-            Value* embedding_cur = tensor_cur->content[v];
-            for(auto n : graph.adj[v]){
-                auto itf = mask_map.find(graph.label_map[n]);
-                if(itf == mask_map.end()){
-                    continue;
-                }
-                vector<Value>& mask = itf->second;
-                vector_add_mul(embedding_cur, embeddings_prev[n], &(mask[0]), mask.size());
-            }
-        }
+        propagate(graph, iteration, tensor_prev, tensor_cur);
         // swap the embedding
         tensor_prev->clear_content();
         if(enable_residual == true && iteration < total_iterations-1){
-            result[offset++] = new Tensor(tensor_cur);
+            result[offset++] = trie.expand(tensor_cur, iteration);
         }
         swap(tensor_prev, tensor_cur);
 #ifdef ENABLE_TIME_INFO
@@ -186,7 +179,7 @@ void Path_counter::count_for_vertices(Graph& graph, Tensor**& result, int& resul
         cout<<"iteration:"<<iteration<<":"<<get_time(start_t, end_t)<<endl;
 #endif
     }
-    result[offset++] = new Tensor(tensor_prev);
+    result[offset++] = trie.expand(tensor_prev, total_iterations-1);
     delete tensor_prev;
     delete tensor_cur;
-}
\ No newline at end of file
+}
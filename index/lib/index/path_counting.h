@@ -17,6 +17,7 @@
 #include "../graph/graph.h"
 #include "../utility/embedding.h"
 #include "feature_counter.h"
+#include "suffix_trie.h"
 
 using namespace std;
 
@@ -30,6 +31,7 @@ public:
     vector<vector<Label>> original_features;
 
     vector<unordered_map<Label, vector<Value>>> mask_maps;
+    Suffix_trie trie; // the counting states of the features
     
     Path_counter(bool enable_residual_, vector<vector<Label> >& original_features_);
     Path_counter(const Path_counter& other);
@@ -44,6 +46,9 @@ public:
     void construct_mask_map();
 
     Tensor* merge_paths_for_edges(Graph& graph, Tensor* path_tensor);
+    // one step of the counts of the trie states, tensor_prev holds the states of the previous iteration
+    // (a single column of ones before the first one)
+    void propagate(Graph& graph, int iteration, Tensor* tensor_prev, Tensor* tensor_cur);
     void count_for_edges(Graph& graph, Tensor**& result, int& result_size);
     void count_for_vertices(Graph& graph, Tensor**& result, int& result_size);
 };
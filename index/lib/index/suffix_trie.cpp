@@ -0,0 +1,59 @@
+#include "suffix_trie.h"
+
+Suffix_trie::Suffix_trie(){}
+
+Suffix_trie::Suffix_trie(vector<vector<Label>>& slot_labels){
+    int feature_num = slot_labels[0].size();
+    vector<int> parent_state(feature_num, 0);
+    for(int t=0; t<slot_labels.size(); ++t){
+        // the states by label, then by parent
+        map<pair<Label, int>, int> states;
+        for(int j=0; j<feature_num; ++j){
+            states.insert({{slot_labels[t][j], parent_state[j]}, 0});
+        }
+        parents.push_back({});
+        label_ranges.push_back({});
+        int s = 0;
+        for(auto& state : states){
+            state.second = s;
+            parents[t].push_back(state.first.second);
+            auto itf = label_ranges[t].find(state.first.first);
+            if(itf == label_ranges[t].end()){
+                label_ranges[t].insert({state.first.first, {s, s+1}});
+            }else{
+                itf->second.second = s+1;
+            }
+            s ++;
+        }
+        feature_states.push_back(vector<int>(feature_num));
+        for(int j=0; j<feature_num; ++j){
+            feature_states[t][j] = states[{slot_labels[t][j], parent_state[j]}];
+        }
+        parent_state = feature_states[t];
+    }
+}
+
+int Suffix_trie::state_num(int iteration){
+    return parents[iteration].size();
+}
+
+int Suffix_trie::max_state_num(){
+    int result = 0;
+    for(auto& p : parents){
+        result = (p.size() > result) ? p.size() : result;
+    }
+    return result;
+}
+
+Tensor* Suffix_trie::expand(Tensor* states, int iteration){
+    vector<int>& columns = feature_states[iteration];
+    Tensor* result = new Tensor(states->row_size, columns.size(), 0);
+    for(int i=0; i<states->row_size; ++i){
+        Value* row = result->content[i];
+        Value* state_row = states->content[i];
+        for(int j=0; j<columns.size(); ++j){
+            row[j] = state_row[columns[j]];
+        }
+    }
+    return result;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <map>
+
+#include "../graph/graph.h"
+#include "../utility/embedding.h"
+
+/**
+ * The counts of a feature after the iteration t only depend on its slot labels 0..t (its last t+1
+ * labels), so the features sharing those are one state of a trie on the slot labels, the one used by
+ * Index_constructer::analyse_redundant_features. The counters propagate one column per state instead
+ * of one per feature and fork a state only where the labels of its features diverge. The states of
+ * an iteration are ordered by label: a neighbor of label l adds to the contiguous columns of the
+ * states of l, each one the column of its parent state of the previous iteration.
+ */
+class Suffix_trie{
+public:
+    vector<vector<int>> parents; // parents[t][s], the parent state of s at iteration t-1 (0, the root, at iteration 0)
+    vector<unordered_map<Label, pair<int, int>>> label_ranges; // label_ranges[t][l], the states [first, second) of label l
+    vector<vector<int>> feature_states; // feature_states[t][j], the state of the j-th feature
+
+    Suffix_trie();
+    Suffix_trie(vector<vector<Label>>& slot_labels);
+
+    int state_num(int iteration);
+    int max_state_num();
+
+    // the columns of the features from those of the states of the iteration
+    Tensor* expand(Tensor* states, int iteration);
+};
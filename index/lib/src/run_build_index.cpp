@@ -7,6 +7,7 @@
 #include "../utility/utils.h"
 #include "../utility/core_decomposition.h"
 #include "../index/feature_selector.h"
+#include "../index/out_of_core.h"
 
 void load_sample_list(string filename, vector<Graph>& result, vector<vector<Vertex>>& query_anchors, vector<vector<Vertex>>& data_anchors, vector<Vertex>& data_graph_ids){
     ifstream in(filename);
@@ -132,6 +133,14 @@ struct Param{
     int batch_size; // number of features computed at a time. If memory is not enough, set a smaller value
     Vertex max_label;
     bool enable_residual;
+    size_t memory_budget; // MB for the counting state of the out-of-core builder, 0 keeps it in memory
+    int shard_id; // the batches of features counted by this process, see Index_constructer::construct_index_shard
+    int shard_num;
+    bool merge; // merge the partial files of the shards into the index files
+    bool resume; // continue from the feature selection rounds and batches recorded by an interrupted build
+    bool anchor_local; // evaluate the candidate features around the sampled anchors only
+    bool compress; // rewrite the finished index files in the compressed layout, see compress_index_file
+    bool merged; // also write the cycle and path indices merged as the matching program uses them, see dump_merged_indices
 };
 
 static struct Param parsed_input_para;
@@ -150,6 +159,13 @@ static const struct option long_options[] = {
     {"thread", required_argument, NULL, 't'},
     {"output", required_argument, NULL, 'o'},
     {"batch_size", required_argument, NULL, 'b'},
+    {"memory_budget", required_argument, NULL, 'g'},
+    {"shard", required_argument, NULL, 's'},
+    {"merge", no_argument, NULL, 'j'},
+    {"resume", no_argument, NULL, 'w'},
+    {"anchor_local", required_argument, NULL, 'a'},
+    {"compress", required_argument, NULL, 'z'},
+    {"merged", required_argument, NULL, 'k'},
     {"help", no_argument, NULL, '?'},
 };
 
@@ -163,6 +179,13 @@ void print_args(){
     cout<<"residual:\t"<<parsed_input_para.enable_residual<<endl;
     cout<<"output:\t"<<parsed_input_para.output<<endl;
     cout<<"batch_size:\t"<<parsed_input_para.batch_size<<endl;
+    cout<<"memory_budget:\t"<<parsed_input_para.memory_budget<<endl;
+    cout<<"shard:\t"<<parsed_input_para.shard_id<<"/"<<parsed_input_para.shard_num<<endl;
+    cout<<"merge:\t"<<parsed_input_para.merge<<endl;
+    cout<<"resume:\t"<<parsed_input_para.resume<<endl;
+    cout<<"anchor_local:\t"<<parsed_input_para.anchor_local<<endl;
+    cout<<"compress:\t"<<parsed_input_para.compress<<endl;
+    cout<<"merged:\t"<<parsed_input_para.merged<<endl;
     cout<<"PV(output path):\t"<<parsed_input_para.PV_data_index<<"\t"<<parsed_input_para.PV_feature<<endl;
     cout<<"PE(output path):\t"<<parsed_input_para.PE_data_index<<"\t"<<parsed_input_para.PE_feature<<endl;
     cout<<"CV(output path):\t"<<parsed_input_para.CV_data_index<<"\t"<<parsed_input_para.CV_feature<<endl;
@@ -222,6 +245,14 @@ void parse_args(int argc, char** argv){
     parsed_input_para.thread_count = 1;
     parsed_input_para.tmp_dir = ".tmp";
     parsed_input_para.batch_size = 128; 
+    parsed_input_para.memory_budget = 0;
+    parsed_input_para.shard_id = 0;
+    parsed_input_para.shard_num = 1;
+    parsed_input_para.merge = false;
+    parsed_input_para.resume = false;
+    parsed_input_para.anchor_local = 1;
+    parsed_input_para.compress = false;
+    parsed_input_para.merged = false;
     bitset<4> index_type;
     index_type.reset();
     while((opt=getopt_long_only(argc, argv, "q:d:x:y:m:n:?", long_options, &options_index)) != -1){
@@ -256,6 +287,30 @@ void parse_args(int argc, char** argv){
         case 'b':
             parsed_input_para.batch_size = atoi(optarg);
             break;
+        case 'g':
+            parsed_input_para.memory_budget = atol(optarg);
+            break;
+        case 's':
+            if(sscanf(optarg, "%d/%d", &parsed_input_para.shard_id, &parsed_input_para.shard_num) != 2 || parsed_input_para.shard_num < 1 || parsed_input_para.shard_id < 0 || parsed_input_para.shard_id >= parsed_input_para.shard_num){
+                cout<<"[ERROR] --shard expects i/N with 0<=i<N, got "<<optarg<<endl;
+                exit(-1);
+            }
+            break;
+        case 'j':
+            parsed_input_para.merge = true;
+            break;
+        case 'w':
+            parsed_input_para.resume = true;
+            break;
+        case 'a':
+            parsed_input_para.anchor_local = atoi(optarg);
+            break;
+        case 'z':
+            parsed_input_para.compress = atoi(optarg);
+            break;
+        case 'k':
+            parsed_input_para.merged = atoi(optarg);
+            break;
         case 'x':
             index_type.set(0);
             break;
@@ -277,8 +332,15 @@ void parse_args(int argc, char** argv){
             cout<<"--fl\tlength of the counted path/cycle features"<<endl;
             cout<<"--fc\tsize of the path/cycle feature size"<<endl;
             cout<<"--residual\t0/1 whether enable the residual mechanism during counting(default 1)"<<endl;
-            cout<<"--thread\tnumber of threads utilized to build the index(default 1)"<<endl;
+            cout<<"--thread\tnumber of threads utilized to build the index, a data file of several graphs is split among them by graph(default 1)"<<endl;
             cout<<"--batch_size\tnumber of features computed at one time(default 128)"<<endl;
+            cout<<"--memory_budget\tMB of memory for the counting state; if set, the state is kept in files under the output directory, --thread splits the rows of every shard and --batch_size is ignored(default 0, in memory)"<<endl;
+            cout<<"--shard\ti/N, count only the i-th of N parts of the feature batches (of --batch_size features) into partial files under the output directory; shard 0 generates missing features, the others wait for them. A restarted shard skips its finished batches"<<endl;
+            cout<<"--merge\tmerge the partial files of all shards into the index files, with the --batch_size of the shards"<<endl;
+            cout<<"--resume\tcontinue an interrupted build from its last completed feature selection round or batch of features, as recorded in the .manifest files next to the features and indices"<<endl;
+            cout<<"--anchor_local\t0/1 whether the candidate features are counted on the neighborhoods of the sampled data anchors instead of an index of the whole data graph during feature selection(default 1)"<<endl;
+            cout<<"--compress\t0/1 whether the index files are written with delta coded columns and counts bit-packed per row, which the matching program reads as well; subgraph retrieval needs uncompressed indices(default 0)"<<endl;
+            cout<<"--merged\t0/1 whether vertex.index and edge.index are written as well, the cycle and path indices of vertices and edges merged into the rows the matching program loads, listed in merged.manifest; subgraph retrieval reads the four indices only(default 0)"<<endl;
             cout<<"--PV\t choose whether or not build the PPC-PV index(optional)"<<endl;
             cout<<"--PE\t choose whether or not build the PPC-PE index(optional)"<<endl;
             cout<<"--CV\t choose whether or not build the PPC-CV index(optional)"<<endl;
@@ -326,6 +388,9 @@ void generate_features(vector<Graph>& data_graphs, string feature_file, vector<s
     }
 
     Feature_selector fs(parsed_input_para.max_label+1, parsed_input_para.feature_count, parsed_input_para.feature_length, enable_cycle, parsed_input_para.tmp_dir);
+    Build_checkpoint checkpoint(feature_file, parsed_input_para.resume);
+    fs.checkpoint = &checkpoint;
+    fs.anchor_local = parsed_input_para.anchor_local;
     vector<vector<Label>> features;
     if(data_graphs.size() == 1){
         features = fs.extract_for_singe_graph(query_graphs, query_anchors, data_anchors, data_graphs[0], level, parsed_input_para.batch_size, parsed_input_para.thread_count);
@@ -333,7 +398,10 @@ void generate_features(vector<Graph>& data_graphs, string feature_file, vector<s
         features = fs.extract_for_multi_graph(query_graphs, query_anchors, data_anchors, data_graph_ids, data_graphs, level, parsed_input_para.batch_size, parsed_input_para.thread_count);
     }
     
-    dump_features(features, feature_file);
+    // shards waiting for the features only see the complete file
+    dump_features(features, feature_file+string(".tmp"));
+    rename((feature_file+string(".tmp")).c_str(), feature_file.c_str());
+    checkpoint.finish();
     my_delete_directory(parsed_input_para.tmp_dir);
 }
 
@@ -342,19 +410,194 @@ bool file_exists(string file){
     return fin.good();
 }
 
-void* thread_multi_graph(void* args){
-    tuple<Graph**, Tensor**, int, Index_constructer*, int> input = *((tuple<Graph**, Tensor**, int, Index_constructer*, int>*)args);
-    Graph** data_graphs = std::get<0>(input);
-    Tensor** result = std::get<1>(input);
-    int data_count = std::get<2>(input);
-    Index_constructer* index = std::get<3>(input);
-    int level = std::get<4>(input);
-    for(int i=0;i<data_count;++i){
-        result[i] = index->count_features(*(data_graphs[i]), 1, level);
-    }
-    return NULL;
+
+// generates the features of an index unless they exist; false if the index is already built
+bool prepare_index(string name, string index_file, string feature_file, vector<Graph>& data_graphs, vector<string>& samples, bool enable_cycle, int level){
+    cout<<"start generating features for "<<name<<endl;
+    if(file_exists(index_file)){
+        cout<<name<<" already built"<<endl;
+        return false;
+    }
+    if(file_exists(feature_file)){
+        cout<<name<<" features are already generated"<<endl;
+    }else if(parsed_input_para.shard_id > 0 || (parsed_input_para.merge && parsed_input_para.shard_num == 1)){
+        cout<<"waiting for the features of "<<name<<" from shard 0"<<endl;
+        while(!file_exists(feature_file)){
+            sleep(1);
+        }
+    }else{
+        cout<<"start generating features for "<<name<<endl;
+        generate_features(data_graphs, feature_file, samples, enable_cycle, level);
+        cout<<"finished generating features for "<<name<<endl;
+    }
+    return true;
 }
 
+double build_index(vector<Graph>& data_graphs, string name, int feature_type, string index_file, string feature_file, int level){
+    cout<<"start building "<<name<<endl;
+    vector<vector<Label>> features = load_label_path(feature_file);
+    feature_counter* counter;
+    if(feature_type == 1){
+        counter = new Cycle_counter(parsed_input_para.enable_residual, features);
+    }else{
+        counter = new Path_counter(parsed_input_para.enable_residual, features);
+    }
+    // the index file only appears once it is complete, an interrupted build leaves the .tmp one
+    string index_file_tmp = index_file+string(".tmp");
+    remove(index_file_tmp.c_str());
+    double building_time = 0;
+    if(parsed_input_para.memory_budget > 0){
+        string tmp_dir = parsed_input_para.output+string("/.out_of_core");
+        my_create_directory(tmp_dir, true);
+        Out_of_core_index_constructer index(counter, parsed_input_para.memory_budget<<20, tmp_dir, parsed_input_para.thread_count);
+        for(auto& data_graph : data_graphs){
+            index.construct_index(data_graph, index_file_tmp, level);
+            building_time += index.build_time;
+        }
+        my_delete_directory(tmp_dir);
+    }else{
+        Build_checkpoint checkpoint(index_file, parsed_input_para.resume);
+        Index_constructer index(counter);
+        if(data_graphs.size() > 1 && parsed_input_para.thread_count > 1){
+            Graph_database_index_constructer database_index(counter);
+            database_index.construct_index(data_graphs, index_file_tmp, parsed_input_para.thread_count, level);
+            building_time += database_index.build_time;
+        }else if(data_graphs.size() > 1){
+            // a graph database is counted as the disjoint union of its graphs, one tensor per graph
+            vector<Vertex> vertex_offsets, edge_offsets;
+            Graph* data_union = Graph::disjoint_union(data_graphs, vertex_offsets, edge_offsets);
+            checkpoint.scope = string("graphs.");
+            index.construct_index_for_graphs(*data_union, (level == 1) ? edge_offsets : vertex_offsets, index_file_tmp, parsed_input_para.batch_size, parsed_input_para.thread_count, level, &checkpoint);
+            building_time += index.build_time;
+            delete data_union;
+        }else if(features.size() <= parsed_input_para.batch_size){
+            index.construct_index_single_batch(data_graphs[0], index_file_tmp, parsed_input_para.thread_count, level);
+            building_time += index.build_time;
+        }else{
+            checkpoint.scope = string("graph_0.");
+            index.construct_index_in_batch(data_graphs[0], index_file_tmp, parsed_input_para.batch_size, parsed_input_para.thread_count, level, &checkpoint);
+            building_time += index.build_time;
+        }
+        checkpoint.finish();
+    }
+    rename(index_file_tmp.c_str(), index_file.c_str());
+    delete counter;
+    cout<<"finish building "<<name<<":"<<building_time<<endl;
+    return building_time;
+}
+
+// removes vertex.index, edge.index and merged.manifest, which are stale once any of the indices they
+// are merged from is rebuilt
+void remove_merged_indices(){
+    string prefix = parsed_input_para.output+string("/");
+    remove((prefix+string("merged.manifest")).c_str());
+    remove((prefix+string("vertex.index")).c_str());
+    remove((prefix+string("edge.index")).c_str());
+}
+
+// "<name in the output directory> <size> <modification time>" of an index, which the matching program
+// compares with the index on disk before it loads a file merged from it; false if the index cannot
+// be read
+bool index_stamp(string index_file, string& stamp){
+    struct stat st;
+    if(stat(index_file.c_str(), &st) != 0){
+        return false;
+    }
+    stamp = index_file.substr(parsed_input_para.output.size()+1)+" "+to_string((long long)st.st_size)+" "+to_string((long long)st.st_mtime);
+    return true;
+}
+
+// writes vertex.index (PPC-CV and PPC-PV) and edge.index (PPC-CE and PPC-PE) for the pairs whose indices
+// exist; merged gets 0 (vertex) or 1 (edge) and column_sizes the numbers of cycle and path columns of
+// each merged file, for dump_merged_manifest
+void dump_merged_indices(vector<int>& merged, vector<pair<int, int>>& column_sizes){
+    vector<string> names = {"vertex", "edge"};
+    vector<string> cycle_indices = {parsed_input_para.CV_data_index, parsed_input_para.CE_data_index};
+    vector<string> path_indices = {parsed_input_para.PV_data_index, parsed_input_para.PE_data_index};
+    string prefix = parsed_input_para.output+string("/");
+    remove_merged_indices();
+    for(int k=0;k<2;++k){
+        if(cycle_indices[k].empty() || path_indices[k].empty() || !file_exists(cycle_indices[k]) || !file_exists(path_indices[k])){
+            continue;
+        }
+        string merged_file = prefix+names[k]+string(".index");
+        pair<int, int> sizes;
+        if(!dump_merged_index(cycle_indices[k], path_indices[k], merged_file, sizes)){
+            cout<<"cannot write "<<merged_file<<" from compressed indices, rebuild them without --compress"<<endl;
+            remove(merged_file.c_str());
+            continue;
+        }
+        cout<<"merged "<<merged_file<<endl;
+        merged.push_back(k);
+        column_sizes.push_back(sizes);
+    }
+}
+
+// writes merged.manifest with a line per merged file: its name, the feature files of the cycle and the
+// path index, their numbers of columns and the index_stamp of both indices. Called once the indices are
+// final, i.e., after their compression.
+void dump_merged_manifest(vector<int>& merged, vector<pair<int, int>>& column_sizes){
+    vector<string> names = {"vertex", "edge"};
+    vector<string> cycle_indices = {parsed_input_para.CV_data_index, parsed_input_para.CE_data_index};
+    vector<string> cycle_features = {parsed_input_para.CV_feature, parsed_input_para.CE_feature};
+    vector<string> path_indices = {parsed_input_para.PV_data_index, parsed_input_para.PE_data_index};
+    vector<string> path_features = {parsed_input_para.PV_feature, parsed_input_para.PE_feature};
+    string prefix = parsed_input_para.output+string("/");
+    if(merged.empty()){
+        return;
+    }
+    string manifest;
+    for(size_t i=0;i<merged.size();++i){
+        int k = merged[i];
+        string merged_file = prefix+names[k]+string(".index");
+        string cycle_stamp, path_stamp;
+        // without the stamps the merged file cannot be checked against its indices, so it is dropped
+        if(!index_stamp(cycle_indices[k], cycle_stamp) || !index_stamp(path_indices[k], path_stamp)){
+            cout<<"cannot stat the indices of "<<merged_file<<", it is not listed in merged.manifest"<<endl;
+            remove(merged_file.c_str());
+            continue;
+        }
+        manifest += names[k]+string(".index")+" "+cycle_features[k].substr(prefix.size())+" "+path_features[k].substr(prefix.size())+" "
+            +to_string(column_sizes[i].first)+" "+to_string(column_sizes[i].second)+" "+cycle_stamp+" "+path_stamp+"\n";
+    }
+    if(manifest.empty()){
+        return;
+    }
+    string manifest_file = prefix+string("merged.manifest");
+    ofstream fout(manifest_file+string(".tmp"));
+    fout<<manifest;
+    fout.close();
+    rename((manifest_file+string(".tmp")).c_str(), manifest_file.c_str());
+}
+
+// counts the batches of this shard and, with --merge, merges those of all shards into the index
+double build_index_shard(vector<Graph>& data_graphs, string name, int feature_type, string index_file, string feature_file, int level){
+    vector<vector<Label>> features = load_label_path(feature_file);
+    feature_counter* counter;
+    if(feature_type == 1){
+        counter = new Cycle_counter(parsed_input_para.enable_residual, features);
+    }else{
+        counter = new Path_counter(parsed_input_para.enable_residual, features);
+    }
+    Index_constructer index(counter);
+    double building_time = 0;
+    if(!parsed_input_para.merge || parsed_input_para.shard_num > 1){
+        cout<<"start building shard "<<parsed_input_para.shard_id<<"/"<<parsed_input_para.shard_num<<" of "<<name<<endl;
+        index.construct_index_shard(data_graphs, index_file, parsed_input_para.batch_size, parsed_input_para.shard_id, parsed_input_para.shard_num, parsed_input_para.thread_count, level);
+        building_time = index.build_time;
+        cout<<"finish building shard "<<parsed_input_para.shard_id<<"/"<<parsed_input_para.shard_num<<" of "<<name<<":"<<building_time<<endl;
+    }
+    if(parsed_input_para.merge){
+        struct timeval start_t, end_t;
+        gettimeofday(&start_t, NULL);
+        if(index.merge_shards(data_graphs.size(), index_file, parsed_input_para.batch_size, parsed_input_para.thread_count)){
+            gettimeofday(&end_t, NULL);
+            cout<<"finish merging "<<name<<":"<<get_time(start_t, end_t)<<endl;
+        }
+    }
+    delete counter;
+    return building_time;
+}
 
 int main(int argc, char** argv){
     parse_args(argc, argv);
@@ -382,157 +625,77 @@ int main(int argc, char** argv){
     // generate features
     vector<string> vertex_anchored_samples = GetFiles(parsed_input_para.sample_file_v, string(".gr"));
     vector<string> edge_anchored_samples = GetFiles(parsed_input_para.sample_file_e, string(".gr"));
-    struct timeval start_t, end_t;
 
     // int upper_limit = 128;
     
-    if(!parsed_input_para.PV_data_index.empty()){
-        cout<<"start generating features for PPC-PV"<<endl;
-        if(file_exists(parsed_input_para.PV_data_index)){
-            cout<<"PPC-PV already built"<<endl;
-        }else{
-            if(file_exists(parsed_input_para.PV_feature)){
-                cout<<"PPC-PV features are already generated"<<endl;
-            }else{
-                cout<<"start generating features for PPC-PV"<<endl;
-                generate_features(data_graphs, parsed_input_para.PV_feature, vertex_anchored_samples, false, 0);
-                cout<<"finished generating features for PPC-PV"<<endl;
-            }
-            cout<<"start building PPC-PV"<<endl;
-            // load features
-            gettimeofday(&start_t, NULL);
-            vector<vector<Label>> features_tmp = load_label_path(parsed_input_para.PV_feature);
-            vector<vector<Label>> features(&(features_tmp[0]), &(features_tmp[0]));
-            Path_counter counter(parsed_input_para.enable_residual, features);
-            Index_constructer index(&counter);
-            for(auto& data_graph : data_graphs){
-                if(features.size() <= parsed_input_para.batch_size){
-                    index.construct_index_single_batch(data_graph, parsed_input_para.PV_data_index, parsed_input_para.thread_count, 0);
-                }else{
-                    index.construct_index_in_batch(data_graph, parsed_input_para.PV_data_index, parsed_input_para.batch_size, parsed_input_para.thread_count, 0);
-                }
-                building_time[0] += index.build_time;
-            }
-            cout<<"finish building PPC-PV:"<<building_time[0]<<endl;
-        }
+    bool build_pv = !parsed_input_para.PV_data_index.empty() && prepare_index("PPC-PV", parsed_input_para.PV_data_index, parsed_input_para.PV_feature, data_graphs, vertex_anchored_samples, false, 0);
+    bool build_pe = !parsed_input_para.PE_data_index.empty() && prepare_index("PPC-PE", parsed_input_para.PE_data_index, parsed_input_para.PE_feature, data_graphs, edge_anchored_samples, false, 1);
+    bool build_cv = !parsed_input_para.CV_data_index.empty() && prepare_index("PPC-CV", parsed_input_para.CV_data_index, parsed_input_para.CV_feature, data_graphs, vertex_anchored_samples, true, 0);
+    bool build_ce = !parsed_input_para.CE_data_index.empty() && prepare_index("PPC-CE", parsed_input_para.CE_data_index, parsed_input_para.CE_feature, data_graphs, edge_anchored_samples, true, 1);
+
+    if(build_pv || build_pe || build_cv || build_ce){
+        remove_merged_indices();
     }
 
-    if(!parsed_input_para.PE_data_index.empty()){
-        cout<<"start generating features for PPC-PE"<<endl;
-        if(file_exists(parsed_input_para.PE_data_index)){
-            cout<<"PPC-PE already built"<<endl;
-        }else{
-            if(file_exists(parsed_input_para.PE_feature)){
-                cout<<"PPC-PE features are already generated"<<endl;
-            }else{
-                cout<<"start generating features for PPC-PE"<<endl;
-                generate_features(data_graphs, parsed_input_para.PE_feature, edge_anchored_samples, false, 1);
-                cout<<"finished generating features for PPC-PE"<<endl;
-            }
-            cout<<"start building PPC-PE"<<endl;
-            // load features
-            gettimeofday(&start_t, NULL);
-            vector<vector<Label>> features_tmp = load_label_path(parsed_input_para.PE_feature);
-            vector<vector<Label>> features(&(features_tmp[0]), &(features_tmp[0]));
-            Path_counter counter(parsed_input_para.enable_residual, features);
-            Index_constructer index(&counter);
-            for(auto& data_graph : data_graphs){
-                if(features.size() <= parsed_input_para.batch_size){
-                    index.construct_index_single_batch(data_graph, parsed_input_para.PE_data_index, parsed_input_para.thread_count, 1);
-                }else{
-                    index.construct_index_in_batch(data_graph, parsed_input_para.PE_data_index, parsed_input_para.batch_size, parsed_input_para.thread_count, 1);
-                }
-                building_time[1] += index.build_time;
-            }
-            gettimeofday(&end_t, NULL);
-            cout<<"finish building PPC-PE:"<<building_time[1]<<endl;
+    if(parsed_input_para.shard_num > 1 || parsed_input_para.merge){
+        if(build_pv){
+            building_time[0] = build_index_shard(data_graphs, "PPC-PV", 0, parsed_input_para.PV_data_index, parsed_input_para.PV_feature, 0);
+        }
+        if(build_pe){
+            building_time[1] = build_index_shard(data_graphs, "PPC-PE", 0, parsed_input_para.PE_data_index, parsed_input_para.PE_feature, 1);
+        }
+        if(build_cv){
+            building_time[2] = build_index_shard(data_graphs, "PPC-CV", 1, parsed_input_para.CV_data_index, parsed_input_para.CV_feature, 0);
+        }
+        if(build_ce){
+            building_time[3] = build_index_shard(data_graphs, "PPC-CE", 1, parsed_input_para.CE_data_index, parsed_input_para.CE_feature, 1);
+        }
+    }else{
+        if(build_pv){
+            building_time[0] = build_index(data_graphs, "PPC-PV", 0, parsed_input_para.PV_data_index, parsed_input_para.PV_feature, 0);
         }
+        if(build_pe){
+            building_time[1] = build_index(data_graphs, "PPC-PE", 0, parsed_input_para.PE_data_index, parsed_input_para.PE_feature, 1);
+        }
+        if(build_cv){
+            building_time[2] = build_index(data_graphs, "PPC-CV", 1, parsed_input_para.CV_data_index, parsed_input_para.CV_feature, 0);
+        }
+        if(build_ce){
+            building_time[3] = build_index(data_graphs, "PPC-CE", 1, parsed_input_para.CE_data_index, parsed_input_para.CE_feature, 1);
+        }
+    }
+    
+    // the merged files are written from the uncompressed indices, shards leave them to the merge
+    bool dump_merged = parsed_input_para.merged && (parsed_input_para.shard_num == 1 || parsed_input_para.merge);
+    vector<int> merged;
+    vector<pair<int, int>> merged_column_sizes;
+    if(dump_merged){
+        dump_merged_indices(merged, merged_column_sizes);
     }
 
-    if(!parsed_input_para.CV_data_index.empty()){
-        cout<<"start generating features for PPC-CV"<<endl;
-        if(file_exists(parsed_input_para.CV_data_index)){
-            cout<<"PPC-CV already built"<<endl;
-        }else{
-            if(file_exists(parsed_input_para.CV_feature)){
-                cout<<"PPC-CV features are already generated"<<endl;
-            }else{
-                cout<<"start generating features for PPC-CV"<<endl;
-                generate_features(data_graphs, parsed_input_para.CV_feature, vertex_anchored_samples, true, 0);
-                cout<<"finished generating features for PPC-CV"<<endl;
-            }
-            cout<<"start building PPC-CV"<<endl;
-            // load features
-            gettimeofday(&start_t, NULL);
-            vector<vector<Label>> features_tmp = load_label_path(parsed_input_para.CV_feature);
-            vector<vector<Label>> features(&(features_tmp[0]), &(features_tmp[0]));
-            Cycle_counter counter(parsed_input_para.enable_residual, features);
-            Index_constructer index(&counter);
-            for(auto& data_graph : data_graphs){
-                if(features.size() <= parsed_input_para.batch_size){
-                    index.construct_index_single_batch(data_graph, parsed_input_para.CV_data_index, parsed_input_para.thread_count, 0);
-                }else{
-                    index.construct_index_in_batch(data_graph, parsed_input_para.CV_data_index, parsed_input_para.batch_size, parsed_input_para.thread_count, 0);
-                }
-                building_time[2] += index.build_time;
+    // shards leave the compression to the merge
+    if(parsed_input_para.compress && (parsed_input_para.shard_num == 1 || parsed_input_para.merge)){
+        vector<bool> built = {build_pv, build_pe, build_cv, build_ce};
+        vector<string> index_files = {parsed_input_para.PV_data_index, parsed_input_para.PE_data_index, parsed_input_para.CV_data_index, parsed_input_para.CE_data_index};
+        for(int i=0;i<4;++i){
+            if(built[i] && file_exists(index_files[i])){
+                compress_index_file(index_files[i]);
+                cout<<"compressed "<<index_files[i]<<endl;
             }
-            gettimeofday(&end_t, NULL);
-            cout<<"finish building PPC-CV:"<<building_time[2]<<endl;
         }
     }
 
-    if(!parsed_input_para.CE_data_index.empty()){
-        cout<<"start generating features for PPC-CE"<<endl;
-        if(file_exists(parsed_input_para.CE_data_index)){
-            cout<<"PPC-CE already built"<<endl;
-        }else{
-            if(file_exists(parsed_input_para.CE_feature)){
-                cout<<"PPC-CE features are already generated"<<endl;
-            }else{
-                cout<<"start generating features for PPC-CE"<<endl;
-                generate_features(data_graphs, parsed_input_para.CE_feature, vertex_anchored_samples, true, 1);
-                cout<<"finished generating features for PPC-CE"<<endl;
-            }
-            cout<<"start building PPC-CE"<<endl;
-            // load features
-            gettimeofday(&start_t, NULL);
-            vector<vector<Label>> features_tmp = load_label_path(parsed_input_para.CE_feature);
-            vector<vector<Label>> features(&(features_tmp[0]), &(features_tmp[0]));
-            Cycle_counter counter(parsed_input_para.enable_residual, features);
-            Index_constructer index(&counter);
-            for(auto& data_graph : data_graphs){
-                if(features.size() <= parsed_input_para.batch_size){
-                    index.construct_index_single_batch(data_graph, parsed_input_para.CE_data_index, parsed_input_para.thread_count, 1);
-                }else{
-                    index.construct_index_in_batch(data_graph, parsed_input_para.CE_data_index, parsed_input_para.batch_size, parsed_input_para.thread_count, 1);
-                }
-                building_time[3] += index.build_time;
-            }
-            gettimeofday(&end_t, NULL);
-            cout<<"finish building PPC-CE:"<<building_time[3]<<endl;
-            
-        }
+    if(dump_merged){
+        dump_merged_manifest(merged, merged_column_sizes);
     }
-    
+
     cout<<"================= build info ==========="<<endl;
-    if(building_time[0] == 0){
-        cout<<"construction time for PPC-PV:"<<building_time[0]<<"(already generated)"<<endl;
-    }else{
-        cout<<"construction time for PPC-PV:"<<building_time[0]<<endl;
-    }
-    if(building_time[1] == 0){
-        cout<<"construction time for PPC-PE:"<<building_time[1]<<"(already generated)"<<endl;
-    }else{
-        cout<<"construction time for PPC-PE:"<<building_time[1]<<endl;
-    }
-    if(building_time[2] == 0){
-        cout<<"construction time for PPC-CV:"<<building_time[2]<<"(already generated)"<<endl;
-    }else{
-        cout<<"construction time for PPC-CV:"<<building_time[2]<<endl;
-    }
-    if(building_time[3] == 0){
-        cout<<"construction time for PPC-CE:"<<building_time[3]<<"(already generated)"<<endl;
-    }else{
-        cout<<"construction time for PPC-CE:"<<building_time[3]<<endl;
+    vector<string> index_names = {"PPC-PV", "PPC-PE", "PPC-CV", "PPC-CE"};
+    for(int i=0;i<4;++i){
+        cout<<"construction time for "<<index_names[i]<<":"<<building_time[i];
+        if(building_time[i] == 0){
+            cout<<"(already generated)";
+        }
+        cout<<endl;
     }
 }
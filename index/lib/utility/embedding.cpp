@@ -1,20 +1,58 @@
 #include "embedding.h"
 #include "utils.h"
 
-inline void sum_safe_without_overflow(Value& a, Value& b){
+// a+b saturated at the largest Value, written so that it compiles to a conditional move
+inline void sum_safe_without_overflow(Value& a, Value b){
     Value tmp = a+b;
-    if(tmp<a || tmp<b){
-        a = 0xffffffff;
-    }else{
-        a = tmp;
+    a = (tmp < a) ? (Value)~0 : tmp;
+}
+
+// a*b saturated at the largest Value
+inline Value mul_safe_without_overflow(Value a, Value b){
+    uint64_t tmp = (uint64_t)a*b;
+    return (tmp > (Value)~0) ? (Value)~0 : (Value)tmp;
+}
+
+// t1[i] = t1[i]+t2[i]*t3[i] (t3 == NULL: t1[i]+t2[i]) on the elements handled with AVX-512BW or
+// AVX2 for 16-bit Values, where both the product (a non-zero high half of the 32-bit product sets
+// the low half to the largest Value) and the add saturate; returns the number of those elements,
+// the rest is left to the caller
+static inline int saturated_add_simd(Value* t1, Value* t2, Value* t3, int size){
+    int i = 0;
+    if(sizeof(Value) != 2){
+        return i;
     }
+#if defined(__AVX512BW__)
+    for(; i+32<=size; i+=32){
+        __m512i a = _mm512_loadu_si512((void*)(t1+i));
+        __m512i b = _mm512_loadu_si512((void*)(t2+i));
+        if(t3 != NULL){
+            __m512i c = _mm512_loadu_si512((void*)(t3+i));
+            __m512i high = _mm512_mulhi_epu16(b, c);
+            b = _mm512_mask_mov_epi16(_mm512_mullo_epi16(b, c), _mm512_test_epi16_mask(high, high), _mm512_set1_epi16(-1));
+        }
+        _mm512_storeu_si512((void*)(t1+i), _mm512_adds_epu16(a, b));
+    }
+#elif defined(__AVX2__)
+    for(; i+16<=size; i+=16){
+        __m256i a = _mm256_loadu_si256((__m256i*)(t1+i));
+        __m256i b = _mm256_loadu_si256((__m256i*)(t2+i));
+        if(t3 != NULL){
+            __m256i c = _mm256_loadu_si256((__m256i*)(t3+i));
+            __m256i no_overflow = _mm256_cmpeq_epi16(_mm256_mulhi_epu16(b, c), _mm256_setzero_si256());
+            b = _mm256_or_si256(_mm256_mullo_epi16(b, c), _mm256_andnot_si256(no_overflow, _mm256_set1_epi16(-1)));
+        }
+        _mm256_storeu_si256((__m256i*)(t1+i), _mm256_adds_epu16(a, b));
+    }
+#endif
+    return i;
 }
 
 bool cmp(const pair<Value, Value>& a, const pair<Value, Value>& b){
     return a.first < b.first;
 }
 
-void dump_vector(ofstream& fout, Value* content, int dim){
+void dump_vector(ostream& fout, Value* content, int dim){
     uint32_t zero_count = 0;
     for(int i=0;i<dim;++i){
         if(content[i] == 0)
@@ -47,6 +85,63 @@ void dump_vector(ofstream& fout, Value* content, int dim){
     }
 }
 
+// the bits of a value that is at most max_value, at least 1
+static int bit_width(Value max_value){
+    int width = 1;
+    while(width < 16 && (max_value>>width) > 0){
+        ++ width;
+    }
+    return width;
+}
+
+static void encode_bit_packed(string& out, Value* values, int count, int width){
+    uint64_t buffer = 0;
+    int bits = 0;
+    for(int k=0;k<count;++k){
+        buffer |= (uint64_t)values[k] << bits;
+        bits += width;
+        while(bits >= 8){
+            out.push_back((char)(buffer&0xff));
+            buffer >>= 8;
+            bits -= 8;
+        }
+    }
+    if(bits > 0){
+        out.push_back((char)(buffer&0xff));
+    }
+}
+
+void encode_compressed_row(string& out, Value* content, int dim){
+    vector<Value> gaps;
+    vector<Value> counts;
+    Value max_gap = 0;
+    Value max_count = 0;
+    int last = 0;
+    for(int i=0;i<dim;++i){
+        if(content[i] != 0){
+            gaps.push_back(i-last);
+            counts.push_back(content[i]);
+            max_gap = max(max_gap, gaps.back());
+            max_count = max(max_count, content[i]);
+            last = i;
+        }
+    }
+    uint32_t varint = gaps.size();
+    while(varint >= 0x80){
+        out.push_back((char)(varint|0x80));
+        varint >>= 7;
+    }
+    out.push_back((char)varint);
+    if(gaps.empty()){
+        return;
+    }
+    int gap_width = bit_width(max_gap);
+    int count_width = bit_width(max_count);
+    out.push_back((char)(((gap_width-1)<<4)|(count_width-1)));
+    encode_bit_packed(out, &(gaps[0]), gaps.size(), gap_width);
+    encode_bit_packed(out, &(counts[0]), counts.size(), count_width);
+}
+
 void vector_concat(Value*& t1, Value* t2, int size_1, int size_2){
     Value* t1_tmp = t1;
     t1 = new Value [size_1+size_2];
@@ -56,10 +151,13 @@ void vector_concat(Value*& t1, Value* t2, int size_1, int size_2){
 }
 
 void vector_add_mul(Value*& t1, Value* t2, Value* t3, int size){
-    for(int i=0;i<size;++i){
+    int i = 0;
 #ifdef OVERFLOW_CHECK
-        Value tmp = t2[i]*t3[i];
-        sum_safe_without_overflow(t1[i], tmp);
+    i = saturated_add_simd(t1, t2, t3, size);
+#endif
+    for(;i<size;++i){
+#ifdef OVERFLOW_CHECK
+        sum_safe_without_overflow(t1[i], mul_safe_without_overflow(t2[i], t3[i]));
 #else
         t1[i] += t2[i]*t3[i];
 #endif
@@ -67,7 +165,11 @@ void vector_add_mul(Value*& t1, Value* t2, Value* t3, int size){
 }
 
 void vector_add(Value*& t1, Value* t2, int size){
-    for(int i=0;i<size;++i){
+    int i = 0;
+#ifdef OVERFLOW_CHECK
+    i = saturated_add_simd(t1, t2, NULL, size);
+#endif
+    for(;i<size;++i){
 #ifdef OVERFLOW_CHECK
         sum_safe_without_overflow(t1[i], t2[i]);
 #else
@@ -76,8 +178,37 @@ void vector_add(Value*& t1, Value* t2, int size){
     }
 }
 
+void vector_add_gather(Value*& t1, Value* t2, int* index, int size){
+    int i = 0;
+#if defined(OVERFLOW_CHECK) && (defined(__AVX512BW__) || defined(__AVX2__))
+    // the gathered values are staged by blocks, so that they are added with the saturating SIMD adds
+    Value gathered[256];
+    while(i+32<=size){
+        int block = ((size-i) < 256) ? (size-i)/32*32 : 256;
+        for(int j=0;j<block;++j){
+            gathered[j] = t2[index[i+j]];
+        }
+        for(int j=saturated_add_simd(t1+i, gathered, NULL, block);j<block;++j){
+            sum_safe_without_overflow(t1[i+j], gathered[j]);
+        }
+        i += block;
+    }
+#endif
+    for(;i<size;++i){
+#ifdef OVERFLOW_CHECK
+        sum_safe_without_overflow(t1[i], t2[index[i]]);
+#else
+        t1[i] += t2[index[i]];
+#endif
+    }
+}
+
 void vector_add_shift(Value*& t1, Value* t2, int size, int shift){
-    for(int i=0;i<size;++i){
+    int i = 0;
+#ifdef OVERFLOW_CHECK
+    i = saturated_add_simd(t1+shift, t2, NULL, size);
+#endif
+    for(;i<size;++i){
 #ifdef OVERFLOW_CHECK
         sum_safe_without_overflow(t1[i+shift], t2[i]);
 #else
@@ -284,9 +415,14 @@ string Tensor::to_string(){
 }
 
 void Tensor::dump_tensor(ofstream& fout){
-    fout.write((char*)&(row_size), sizeof(int));
+    dump_rows(fout, 0, row_size);
+}
+
+void Tensor::dump_rows(ofstream& fout, int row_begin, int row_end){
+    int rows = row_end-row_begin;
+    fout.write((char*)&(rows), sizeof(int));
     fout.write((char*)&(column_size), sizeof(int));
-    for(int i=0;i<row_size;++i){
+    for(int i=row_begin;i<row_end;++i){
         dump_vector(fout, content[i], column_size);
     }
 }
@@ -352,6 +488,15 @@ void Index_manager::dump_tensor(Tensor* tensor){
     fout.close();
 }
 
+void Index_manager::dump_tensor(Tensor* tensor, vector<Vertex>& row_offsets){
+    is_scaned = false;
+    ofstream fout(filename, ios::binary|ios::app);
+    for(int g=0; g+1<row_offsets.size(); ++g){
+        tensor->dump_rows(fout, row_offsets[g], row_offsets[g+1]);
+    }
+    fout.close();
+}
+
 Value* Index_manager::load_embedding(ifstream& fin, Value dim){
     Value* result = new Value [dim];
     memset(result, 0, sizeof(Value)*dim);
@@ -458,6 +603,33 @@ void Index_manager::load_vertex_embedding(int graph_offset, Vertex v, vector<Val
     fin.close();
 }
 
+void Index_manager::load_rows(int graph_offset, vector<Vertex>& rows, vector<vector<Value>>& result){
+    if(!is_scaned){
+        quick_scan();
+    }
+    int dim = offset_dim_map[graph_offset];
+    vector<vector<size_t>>& offsets = offset_vertex_map[graph_offset];
+    vector<pair<size_t, int>> order; // file offset, position in rows
+    order.reserve(rows.size());
+    for(int i=0;i<rows.size();++i){
+        if(rows[i] >= offsets.size()){
+            cout<<"vertex offset overflow"<<endl;
+            exit(-1);
+        }
+        order.push_back({offsets[rows[i]][1], i});
+    }
+    sort(order.begin(), order.end());
+    result.resize(rows.size());
+    ifstream fin(filename, ios::binary);
+    for(auto& record : order){
+        fin.seekg(record.first, ios::beg);
+        Value* r = load_embedding(fin, dim);
+        result[record.second].assign(r, r+dim);
+        delete [] r;
+    }
+    fin.close();
+}
+
 void Index_manager::quick_scan(){
     is_scaned = true;
     ifstream fin(filename, ios::binary);
@@ -799,3 +971,304 @@ void merge_multi_index_files_with_bounded_memory(vector<string>& filenames, stri
     delete [] reader_list;
     fout.close();
 }
+
+struct merge_task{
+    int thread_id;
+    int thread_num;
+    bool is_encoding; // read the files or encode the rows
+    int row_count;    // rows of the current chunk
+    vector<ifstream*>* fin_list;
+    vector<Tensor*>* chunks;
+    int column_size;
+    stringstream encoded;
+};
+
+static void* merge_chunk_func(void* args){
+    merge_task* task = (merge_task*)args;
+    vector<Tensor*>& chunks = *(task->chunks);
+    if(!task->is_encoding){
+        for(int j=task->thread_id; j<chunks.size(); j+=task->thread_num){
+            ifstream& fin = *((*(task->fin_list))[j]);
+            int read_column_size = chunks[j]->column_size;
+            for(int x=0; x<task->row_count; ++x){
+                Value* read_row = chunks[j]->content[x];
+                memset(read_row, 0, sizeof(Value)*read_column_size);
+                bool is_sparse;
+                fin.read((char*)&is_sparse, sizeof(bool));
+                if(is_sparse){
+                    int content_size;
+                    fin.read((char*)&content_size, sizeof(int));
+                    if(content_size == 0){
+                        continue;
+                    }
+                    vector<Value> idx(content_size, 0);
+                    vector<Value> val(content_size, 0);
+                    fin.read((char*)&(idx[0]), content_size*sizeof(Value));
+                    fin.read((char*)&(val[0]), content_size*sizeof(Value));
+                    for(int m=0;m<content_size;++m){
+                        read_row[idx[m]] = val[m];
+                    }
+                }else{
+                    fin.read((char*)&(read_row[0]), read_column_size*sizeof(Value));
+                }
+            }
+        }
+    }else{
+        task->encoded.str(string());
+        int begin = (long)task->row_count*task->thread_id/task->thread_num;
+        int end = (long)task->row_count*(task->thread_id+1)/task->thread_num;
+        Value* vector_tmp = new Value [task->column_size];
+        for(int x=begin; x<end; ++x){
+            int offset = 0;
+            for(auto chunk : chunks){
+                memcpy(vector_tmp+offset, chunk->content[x], sizeof(Value)*chunk->column_size);
+                offset += chunk->column_size;
+            }
+            dump_vector(task->encoded, vector_tmp, task->column_size);
+        }
+        delete [] vector_tmp;
+    }
+    return NULL;
+}
+
+static void run_merge_tasks(vector<merge_task>& tasks){
+    if(tasks.size() == 1){
+        merge_chunk_func((void*)&(tasks[0]));
+        return;
+    }
+    pthread_t* threads = new pthread_t [tasks.size()];
+    for(int i=0; i<tasks.size(); ++i){
+        int res = pthread_create(&(threads[i]), NULL, merge_chunk_func, (void*)&(tasks[i]));
+        if(res != 0){
+            cout<<"Created thread:"<<i<<" failed"<<endl;
+            exit(res);
+        }
+    }
+    for(int i=0; i<tasks.size(); ++i){
+        void* ret;
+        pthread_join(threads[i], &ret);
+    }
+    delete [] threads;
+}
+
+void merge_multi_index_files_in_parallel(vector<string>& filenames, string target_filename, int graph_count, int thread_num){
+    int chunk_size = 100000;
+    int num_indices = filenames.size();
+    if(thread_num < 1){
+        thread_num = 1;
+    }
+    vector<ifstream*> fin_list(num_indices);
+    for(int j=0; j<num_indices; ++j){
+        fin_list[j] = new ifstream(filenames[j], ios::binary);
+        if(!fin_list[j]->is_open()){
+            cout<<"Failed to open file:"<<filenames[j]<<endl;
+            exit(-1);
+        }
+    }
+    vector<merge_task> tasks(thread_num);
+    for(int t=0; t<thread_num; ++t){
+        tasks[t].thread_id = t;
+        tasks[t].thread_num = thread_num;
+        tasks[t].fin_list = &fin_list;
+    }
+
+    ofstream fout(target_filename, ios::binary);
+    for(int g=0; g<graph_count; ++g){
+        int row_size = 0;
+        int column_size = 0;
+        vector<Tensor*> chunks(num_indices);
+        for(int j=0; j<num_indices; ++j){
+            int row_size_local, column_size_local;
+            fin_list[j]->read((char*)&row_size_local, sizeof(int));
+            fin_list[j]->read((char*)&column_size_local, sizeof(int));
+            if(j > 0 && row_size_local != row_size){
+                cout<<"row count of "<<filenames[j]<<" does not match for graph "<<g<<endl;
+                exit(-1);
+            }
+            row_size = row_size_local;
+            column_size += column_size_local;
+            chunks[j] = new Tensor(min(chunk_size, max(row_size, 1)), column_size_local);
+        }
+        fout.write((char*)&row_size, sizeof(int));
+        fout.write((char*)&column_size, sizeof(int));
+        for(int t=0; t<thread_num; ++t){
+            tasks[t].chunks = &chunks;
+            tasks[t].column_size = column_size;
+        }
+        for(int i=0; i<row_size; i+=chunk_size){
+            int row_count = min(chunk_size, row_size-i);
+            for(auto& task : tasks){
+                task.is_encoding = false;
+                task.row_count = row_count;
+            }
+            run_merge_tasks(tasks);
+            for(auto& task : tasks){
+                task.is_encoding = true;
+            }
+            run_merge_tasks(tasks);
+            for(auto& task : tasks){
+                string encoded = task.encoded.str();
+                fout.write(encoded.c_str(), encoded.size());
+            }
+        }
+        for(auto t : chunks){
+            delete t;
+        }
+    }
+    for(auto fin : fin_list){
+        delete fin;
+    }
+    fout.close();
+}
+
+void compress_index_file(string index_file){
+    ifstream fin(index_file, ios::binary);
+    if(!fin.is_open()){
+        cout<<"Failed to open file:"<<index_file<<endl;
+        exit(-1);
+    }
+    uint32_t magic = 0;
+    fin.read((char*)&magic, sizeof(uint32_t));
+    if(magic == INDEX_CODEC_MAGIC){
+        return;
+    }
+    fin.seekg(0, ios::beg);
+
+    // the compressed file only replaces the index once it is complete
+    string compressed_file = index_file+string(".tmp");
+    ofstream fout(compressed_file, ios::binary);
+    uint32_t version = INDEX_CODEC_VERSION;
+    magic = INDEX_CODEC_MAGIC;
+    fout.write((char*)&magic, sizeof(uint32_t));
+    fout.write((char*)&version, sizeof(uint32_t));
+    Index_manager manager;
+    string encoded;
+    while(true){
+        int row_size, column_size;
+        fin.read((char*)&row_size, sizeof(int));
+        if(fin.eof()){
+            break;
+        }
+        fin.read((char*)&column_size, sizeof(int));
+        fout.write((char*)&row_size, sizeof(int));
+        fout.write((char*)&column_size, sizeof(int));
+        // the size of the rows is filled in once they are written
+        size_t size_offset = fout.tellp();
+        uint64_t byte_size = 0;
+        fout.write((char*)&byte_size, sizeof(uint64_t));
+        for(int i=0;i<row_size;++i){
+            Value* row = manager.load_embedding(fin, column_size);
+            encode_compressed_row(encoded, row, column_size);
+            delete [] row;
+            if(encoded.size() >= (1<<20) || i == row_size-1){
+                fout.write(encoded.c_str(), encoded.size());
+                byte_size += encoded.size();
+                encoded.clear();
+            }
+        }
+        size_t end_offset = fout.tellp();
+        fout.seekp(size_offset, ios::beg);
+        fout.write((char*)&byte_size, sizeof(uint64_t));
+        fout.seekp(end_offset, ios::beg);
+    }
+    fin.close();
+    fout.close();
+    // a failed write keeps the uncompressed index
+    if(!fout.good()){
+        cout<<"Failed to write file:"<<compressed_file<<endl;
+        remove(compressed_file.c_str());
+        exit(-1);
+    }
+    rename(compressed_file.c_str(), index_file.c_str());
+}
+
+bool dump_merged_index(string first_file, string second_file, string target_file, pair<int, int>& column_sizes){
+    ifstream fin_first(first_file, ios::binary);
+    ifstream fin_second(second_file, ios::binary);
+    if(!fin_first.is_open() || !fin_second.is_open()){
+        cout<<"Failed to open file:"<<(fin_first.is_open() ? second_file : first_file)<<endl;
+        exit(-1);
+    }
+    uint32_t magic_first = 0, magic_second = 0;
+    fin_first.read((char*)&magic_first, sizeof(uint32_t));
+    fin_second.read((char*)&magic_second, sizeof(uint32_t));
+    if(magic_first == INDEX_CODEC_MAGIC || magic_second == INDEX_CODEC_MAGIC){
+        return false;
+    }
+    fin_first.clear();
+    fin_first.seekg(0, ios::beg);
+    fin_second.clear();
+    fin_second.seekg(0, ios::beg);
+
+    string merged_file = target_file+string(".tmp");
+    ofstream fout(merged_file, ios::binary);
+    uint32_t magic = INDEX_MERGED_MAGIC;
+    uint32_t version = INDEX_MERGED_VERSION;
+    fout.write((char*)&magic, sizeof(uint32_t));
+    fout.write((char*)&version, sizeof(uint32_t));
+    Index_manager manager;
+    vector<Value> columns, counts;
+    string encoded;
+    for(int g=0; ; ++g){
+        int row_size, first_columns, second_row_size, second_columns;
+        fin_first.read((char*)&row_size, sizeof(int));
+        if(fin_first.eof()){
+            break;
+        }
+        fin_first.read((char*)&first_columns, sizeof(int));
+        fin_second.read((char*)&second_row_size, sizeof(int));
+        fin_second.read((char*)&second_columns, sizeof(int));
+        if(!fin_second.good() || second_row_size != row_size){
+            cout<<"row count of "<<second_file<<" does not match "<<first_file<<" for graph "<<g<<endl;
+            exit(-1);
+        }
+        if(g == 0){
+            column_sizes = {first_columns, second_columns};
+        }
+        int column_size = first_columns+second_columns;
+        fout.write((char*)&row_size, sizeof(int));
+        fout.write((char*)&column_size, sizeof(int));
+        // the number of values is filled in once the rows are written
+        size_t size_offset = fout.tellp();
+        uint64_t value_count = 0;
+        fout.write((char*)&value_count, sizeof(uint64_t));
+        for(int i=0;i<row_size;++i){
+            Value* first_row = manager.load_embedding(fin_first, first_columns);
+            Value* second_row = manager.load_embedding(fin_second, second_columns);
+            columns.clear();
+            counts.clear();
+            for(int j=0;j<first_columns;++j){
+                if(first_row[j] != 0){
+                    columns.push_back(j);
+                    counts.push_back(first_row[j]);
+                }
+            }
+            for(int j=0;j<second_columns;++j){
+                if(second_row[j] != 0){
+                    columns.push_back(first_columns+j);
+                    counts.push_back(second_row[j]);
+                }
+            }
+            delete [] first_row;
+            delete [] second_row;
+            Value size = columns.size();
+            encoded.append((char*)&size, sizeof(Value));
+            encoded.append((char*)columns.data(), sizeof(Value)*size);
+            encoded.append((char*)counts.data(), sizeof(Value)*size);
+            value_count += 1+2*size;
+            if(encoded.size() >= (1<<20) || i == row_size-1){
+                fout.write(encoded.c_str(), encoded.size());
+                encoded.clear();
+            }
+        }
+        size_t end_offset = fout.tellp();
+        fout.seekp(size_offset, ios::beg);
+        fout.write((char*)&value_count, sizeof(uint64_t));
+        fout.seekp(end_offset, ios::beg);
+    }
+    fin_first.close();
+    fin_second.close();
+    fout.close();
+    rename(merged_file.c_str(), target_file.c_str());
+    return true;
+}
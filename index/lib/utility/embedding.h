@@ -21,10 +21,34 @@ using namespace std;
 bool cmp(const pair<Value, Value>& a, const pair<Value, Value>& b);
 
 // utilities
-void dump_vector(ofstream& fout, Value* content, int dim);
+void dump_vector(ostream& fout, Value* content, int dim);
+
+// Compressed index files start with INDEX_CODEC_MAGIC and INDEX_CODEC_VERSION (uint32 each), then
+// hold per graph [num of row (int)] [size of the row (int)] [bytes of the rows (uint64)] and the
+// rows. A row is its number n of non-zero counts as a varint, then a byte of the bit widths of its
+// column gaps (the first column, then the differences to the previous one) and of its counts, minus
+// one, in the high and low 4 bits, then the n gaps and the n counts, each bit-packed at their width
+// of the row, low bits first.
+#define INDEX_CODEC_MAGIC 0x5a435050 // "PPCZ"
+#define INDEX_CODEC_VERSION 1
+void encode_compressed_row(string& out, Value* content, int dim);
+// rewrites a finished index file in the compressed layout, files that are already compressed are kept
+void compress_index_file(string index_file);
+
+// Merged index files (--merged 1) start with INDEX_MERGED_MAGIC and INDEX_MERGED_VERSION (uint32
+// each), then hold per graph [num of row (int)] [size of the row (int)] [num of values (uint64)] and
+// the rows of two indices side by side in the CompactTensor layout, [n] [n columns] [n counts], with
+// the columns of the second index after those of the first, as the matching program merges them.
+#define INDEX_MERGED_MAGIC 0x4d435050 // "PPCM"
+#define INDEX_MERGED_VERSION 1
+// merges two uncompressed index files of the same graphs, column_sizes gets their columns of the
+// first graph; false if one of them is compressed
+bool dump_merged_index(string first_file, string second_file, string target_file, pair<int, int>& column_sizes);
 void vector_concat(Value*& t1, Value* t2, int size_1, int size_2);
 void vector_add_mul(Value*& t1, Value* t2, Value* t3, int size);
 void vector_add(Value*& t1, Value* t2, int size);
+// t1[i] += t2[index[i]]
+void vector_add_gather(Value*& t1, Value* t2, int* index, int size);
 void vector_add_shift(Value*& t1, Value* t2, int size, int shift);
 bool vec_validation(Value* t1, Value* t2, int size);
 string vector_to_string(Value* vec, int size);
@@ -47,6 +71,8 @@ public:
     string to_string();
 
     void dump_tensor(ofstream& fout);
+    // the rows [row_begin, row_end) as a tensor of their own
+    void dump_rows(ofstream& fout, int row_begin, int row_end);
 
     void concat_with(Tensor* tensor);
     void add_mul_with(Tensor* t1, Tensor* t2);
@@ -71,6 +97,8 @@ public:
     
     // [sparse/dense (int)] [num of row (int)] [size of the row]
     void dump_tensor(Tensor* tensor);
+    // one graph per range of rows, the g-th one is [row_offsets[g], row_offsets[g+1])
+    void dump_tensor(Tensor* tensor, vector<Vertex>& row_offsets);
     Value* load_embedding(ifstream& fin, Value dim);
     vector<Tensor*> load_all_graphs();
     Tensor* load_graph_tensor(int graph_offset);
@@ -78,6 +106,8 @@ public:
 
     // can be used to load edges
     void load_vertex_embedding(int graph_offset, Vertex v, vector<Value>& result);
+    // result[i] is the rows[i]-th row, read in one pass over the file
+    void load_rows(int graph_offset, vector<Vertex>& rows, vector<vector<Value>>& result);
     void quick_scan();
 };
 
@@ -91,4 +121,9 @@ void dump_index_with_mask(Tensor* tensor, string target_filename, vector<bool>&
 
 void merge_multi_index_files(vector<string>& filenames, string target_filename);
 
-void merge_multi_index_files_with_bounded_memory(vector<string>& filenames, string target_filename);
\ No newline at end of file
+void merge_multi_index_files_with_bounded_memory(vector<string>& filenames, string target_filename);
+
+// merge_multi_index_files_with_bounded_memory for files holding graph_count graphs each. Every chunk
+// of rows is read from the files and encoded by thread_num threads, the files are split among them
+// for reading and the rows for encoding
+void merge_multi_index_files_in_parallel(vector<string>& filenames, string target_filename, int graph_count, int thread_num);
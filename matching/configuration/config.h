@@ -25,8 +25,15 @@ typedef uint8_t QUERY_SIZE_TYPE;
 
 #define COMPACT 1
 
+#define COLUMN_FILTER 1 // scan the feature-major copy of the vertex index instead of checking candidates one by one (requires COMPACT)
+
+#define FILTER_COST_MODEL 1 // decide per query which of NLF, PPC vertex and PPC edge filtering pay off; 0 runs all of them
+#define FILTER_DOWNSTREAM_TOUCHES 8 // estimated touches of a tuple after filtering (semi-join rounds and encoding)
+
 #define INDEX_ORDER 1
 
+#define RACE_SLICE_STATES 1000 // search states an order runs per turn when the orders are raced
+
 
 #define PRINT_RESULT 0
 
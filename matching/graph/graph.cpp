@@ -317,64 +317,134 @@ void Graph::set_up_edge_id_map(){
     }
 }
 
+// The lists are intersections of the sorted adjacency lists: a first pass counts the common
+// neighbors of every edge, so that all lists are stored back to back in one exactly sized array
 void Graph::construct_edge_common_neighbor(){
     set_up_edge_id_map();
     if(common_edge_neighbor != NULL){
         return;
     }
-    common_edge_neighbor = new Vertex* [getEdgesCount()];
-    for(Vertex v=0; v<getVerticesCount(); ++v){
-        uint32_t nbrs_count;
-        const Vertex* nbrs = getVertexNeighbors(v, nbrs_count);
-        for(int i=0;i<nbrs_count; ++i){
-            Vertex n = nbrs[i];
-            if(v < n){
-                Vertex e_id = edge_id_map[v][n];
-                common_edge_neighbor[e_id] = new Vertex [estimated_common_neighbor_count[e_id]*3+1];
-                Vertex* vec = common_edge_neighbor[e_id];
-                int offset = 1;
-                int count = 0;
-                uint32_t nbrs_count_inner;
-                const Vertex* nbrs_inner = getVertexNeighbors(n, nbrs_count_inner);
-                for(int j=0;j<nbrs_count_inner;++j){
-                    Vertex v_n = nbrs_inner[j];
-                    if(v_n !=v && checkEdgeExistence(v, v_n)){ // adj[v].find(v_n) != adj[v].end()
-                        vec[offset++] = v_n;
-                        count++;
-                        // first push_back the e_id connecting source vertex
-                        if(v_n<v){
-                            // if(edge_id_map[v_n].find(v)==edge_id_map[v_n].end()){
-                            //     cout<<"Error1:"<<v_n<<" is not connected to "<<v<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v_n][v];
-                            // vec.push_back(edge_id_map[v_n][v]);
-                        }else{
-                            // if(edge_id_map[v].find(v_n)==edge_id_map[v].end()){
-                            //     cout<<"Error2:"<<v<<" is not connected to "<<v_n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v][v_n];
-                            // vec.push_back(edge_id_map[v][v_n]);
-                        }
-                        // second push_back the e_id connecting target vertex
-                        if(v_n<n){
-                            // if(edge_id_map[v_n].find(n)==edge_id_map[v_n].end()){
-                            //     cout<<"Error3:"<<v_n<<" is not connected to "<<n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[v_n][n];
-                            // vec.push_back(edge_id_map[v_n][n]);
-                        }else{
-                            // if(edge_id_map[n].find(v_n)==edge_id_map[n].end()){
-                            //     cout<<"Error4:"<<n<<" is not connected to "<<v_n<<endl;
-                            // }
-                            vec[offset++] = edge_id_map[n][v_n];
-                            // vec.push_back(edge_id_map[n][v_n]);
-                        }
+    uint32_t edge_count = getEdgesCount();
+    uint32_t vertex_count = getVerticesCount();
+    // the neighbors in ascending order with the id of the connecting edge alongside; edge ids follow
+    // set_up_edge_id_map, and the smaller neighbors of v are placed in ascending order before v is visited
+    vector<Vertex> neighbors(offsets_[vertex_count]);
+    vector<Vertex> edge_ids(offsets_[vertex_count]);
+    vector<uint32_t> cursor(offsets_, offsets_+vertex_count);
+    Vertex e_id = 0;
+    for(Vertex v=0; v<vertex_count; ++v){
+        uint32_t begin = cursor[v];
+        for(uint32_t i=offsets_[v]; i<offsets_[v+1]; ++i){
+            if(neighbors_[i] > v){
+                neighbors[cursor[v]++] = neighbors_[i];
+            }
+        }
+        sort(neighbors.begin()+begin, neighbors.begin()+cursor[v]);
+        for(uint32_t i=begin; i<cursor[v]; ++i){
+            Vertex n = neighbors[i];
+            edge_ids[i] = e_id;
+            neighbors[cursor[n]] = v;
+            edge_ids[cursor[n]] = e_id;
+            cursor[n] ++;
+            e_id ++;
+        }
+    }
+
+    common_edge_neighbor_offsets.assign(edge_count+1, 0);
+    common_edge_neighbor = new Vertex* [edge_count];
+    for(int pass=0; pass<2; ++pass){
+        for(Vertex id=0; id<edge_count; ++id){
+            Vertex v = edge_set[id*2];
+            Vertex n = edge_set[id*2+1];
+            uint32_t i = offsets_[v], i_end = offsets_[v+1];
+            uint32_t j = offsets_[n], j_end = offsets_[n+1];
+            Vertex* vec = common_edge_neighbor[id];
+            Vertex count = 0;
+            while(i<i_end && j<j_end){
+                if(neighbors[i] < neighbors[j]){
+                    ++i;
+                }else if(neighbors[i] > neighbors[j]){
+                    ++j;
+                }else{
+                    if(pass == 1){
+                        // the neighbor, the e_id connecting the source vertex and the e_id connecting the target vertex
+                        vec[count*3+1] = neighbors[i];
+                        vec[count*3+2] = edge_ids[i];
+                        vec[count*3+3] = edge_ids[j];
                     }
+                    count ++;
+                    ++i;
+                    ++j;
                 }
+            }
+            if(pass == 1){
                 vec[0] = count;
+            }else{
+                common_edge_neighbor_offsets[id+1] = common_edge_neighbor_offsets[id]+3*count+1;
             }
         }
+        if(pass == 0){
+            common_edge_neighbor_data = new Vertex [common_edge_neighbor_offsets[edge_count]];
+            for(Vertex id=0; id<edge_count; ++id){
+                common_edge_neighbor[id] = common_edge_neighbor_data+common_edge_neighbor_offsets[id];
+            }
+        }
+    }
+}
+
+void Graph::storeRelabeledGraph(const std::string& graph_path, const std::string& mapping_path,
+                                const uint32_t* order) {
+    std::vector<Vertex> new_ids(vertices_count_);
+    for (uint32_t i = 0; i < vertices_count_; ++i) {
+        new_ids[order[i]] = i;
+    }
+
+    std::ofstream graph_outputfile(graph_path);
+    if (!graph_outputfile.is_open()) {
+        std::cerr << "Cannot open graph file " << graph_path << " ." << std::endl;
+        exit(-1);
+    }
+    graph_outputfile << "t " << vertices_count_ << " " << edges_count_ << "\n";
+    for (uint32_t i = 0; i < vertices_count_; ++i) {
+        graph_outputfile << "v " << i << " " << labels_[order[i]] << " " << getVertexDegree(order[i]) << "\n";
+    }
+    for (uint32_t i = 0; i < vertices_count_; ++i) {
+        uint32_t nbrs_count;
+        const Vertex* nbrs = getVertexNeighbors(order[i], nbrs_count);
+        for (uint32_t j = 0; j < nbrs_count; ++j) {
+            if (i < new_ids[nbrs[j]]) {
+                graph_outputfile << "e " << i << " " << new_ids[nbrs[j]] << "\n";
+            }
+        }
+    }
+    graph_outputfile.close();
+
+    std::ofstream mapping_outputfile(mapping_path);
+    if (!mapping_outputfile.is_open()) {
+        std::cerr << "Cannot open mapping file " << mapping_path << " ." << std::endl;
+        exit(-1);
+    }
+    for (uint32_t i = 0; i < vertices_count_; ++i) {
+        mapping_outputfile << i << " " << order[i] << "\n";
+    }
+    mapping_outputfile.close();
+}
+
+bool Graph::loadVertexMapping(const std::string& mapping_path, std::vector<Vertex>& original_ids) {
+    std::ifstream infile(mapping_path);
+    if (!infile.is_open()) {
+        std::cerr << "Cannot open mapping file " << mapping_path << " ." << std::endl;
+        return false;
+    }
+    original_ids.clear();
+    Vertex new_id, original_id;
+    while (infile >> new_id >> original_id) {
+        if (new_id >= original_ids.size()) {
+            original_ids.resize(new_id + 1);
+        }
+        original_ids[new_id] = original_id;
     }
+    return true;
 }
 
 void Graph::storeComparessedGraph(const std::string& degree_path, const std::string& edge_path,
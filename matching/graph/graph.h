@@ -60,6 +60,7 @@ public:
         labels_offsets_ = NULL;
         nlf_ = NULL;
         common_edge_neighbor = NULL;
+        common_edge_neighbor_data = NULL;
     }
 
     ~Graph() {
@@ -72,6 +73,8 @@ public:
         delete edge_index_;
         delete[] labels_offsets_;
         delete[] nlf_;
+        delete[] common_edge_neighbor;
+        delete[] common_edge_neighbor_data;
     }
 
 public:
@@ -81,10 +84,19 @@ public:
     void storeComparessedGraph(const std::string& degree_path, const std::string& edge_path,
                                const std::string& label_path);
     void printGraphMetaData();
+    // writes the graph with vertex order[i] renamed to i, and the original id of every new id to
+    // mapping_path, one "new_id original_id" line per vertex
+    void storeRelabeledGraph(const std::string& graph_path, const std::string& mapping_path,
+                             const uint32_t* order);
+    static bool loadVertexMapping(const std::string& mapping_path, std::vector<Vertex>& original_ids);
 
     vector<Vertex> edge_set;
     vector<Vertex> estimated_common_neighbor_count;
-    Vertex** common_edge_neighbor; // e_id -> list of neighbors
+    // e_id -> {count, (neighbor, e_id to the smaller end, e_id to the larger end)*}, pointing into
+    // common_edge_neighbor_data where the lists of all edges are stored back to back
+    Vertex** common_edge_neighbor;
+    Vertex* common_edge_neighbor_data;
+    vector<size_t> common_edge_neighbor_offsets;
     vector<unordered_map<Vertex, Vertex>> edge_id_map;
 
     void set_up_edge_id_map();
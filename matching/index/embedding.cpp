@@ -1,19 +1,12 @@
 #include "embedding.h"
+#include "../graph/graph.h"
 
 string vertex_path_index, edge_path_index, vertex_cycle_index, edge_cycle_index;
 Tensor *query_vertex_emb, *data_vertex_emb, *query_edge_emb, *data_edge_emb;
 CompactTensor *query_vertex_emb_comp, *data_vertex_emb_comp, *query_edge_emb_comp, *data_edge_emb_comp;
+ColumnTensor *data_vertex_emb_column;
 pair<vector<int>, vector<float>> query_gnn_emb, data_gnn_emb;
 
-inline void sum_safe_without_overflow(Value& a, Value& b){
-    Value tmp = a+b;
-    if(tmp<a || tmp<b){
-        a = 0xffffffff;
-    }else{
-        a = tmp;
-    }
-}
-
 bool cmp(const pair<Value, Value>& a, const pair<Value, Value>& b){
     return a.first < b.first;
 }
@@ -51,6 +44,106 @@ void dump_vector(ofstream& fout, Value* content, int dim){
     }
 }
 
+static inline const uint8_t* read_varint(const uint8_t* in, uint32_t& value){
+    value = 0;
+    int shift = 0;
+    while(*in & 0x80){
+        value |= (uint32_t)(*in & 0x7f) << shift;
+        shift += 7;
+        ++in;
+    }
+    value |= (uint32_t)(*in) << shift;
+    return in+1;
+}
+
+// count values of width bits packed from the lowest bit of in, 8 at a time with AVX2
+static const uint8_t* decode_bit_packed(const uint8_t* in, int count, int width, Value* out){
+    uint32_t mask = (1u<<width)-1;
+    int k = 0;
+#if defined(__AVX2__)
+    __m256i bit_offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(width));
+    __m256i low_bits = _mm256_set1_epi32(7);
+    __m256i masks = _mm256_set1_epi32(mask);
+    for(; k+8<=count; k+=8){
+        __m256i bits = _mm256_add_epi32(bit_offsets, _mm256_set1_epi32(k*width));
+        __m256i words = _mm256_i32gather_epi32((const int*)in, _mm256_srli_epi32(bits, 3), 1);
+        words = _mm256_and_si256(_mm256_srlv_epi32(words, _mm256_and_si256(bits, low_bits)), masks);
+        __m128i values = _mm_packus_epi32(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i*)(out+k), values);
+    }
+#endif
+    for(; k<count; ++k){
+        size_t bit = (size_t)k*width;
+        uint32_t word;
+        memcpy(&word, in+bit/8, sizeof(uint32_t));
+        out[k] = (word>>(bit%8)) & mask;
+    }
+    return in+((size_t)count*width+7)/8;
+}
+
+// column gaps to columns
+static void prefix_sum(Value* values, int count){
+    int k = 0;
+    Value carry = 0;
+#if defined(__SSE2__)
+    for(; k+8<=count; k+=8){
+        __m128i x = _mm_loadu_si128((__m128i*)(values+k));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi16(x, _mm_set1_epi16(carry));
+        _mm_storeu_si128((__m128i*)(values+k), x);
+        carry = values[k+7];
+    }
+#endif
+    for(; k<count; ++k){
+        carry += values[k];
+        values[k] = carry;
+    }
+}
+
+const uint8_t* decode_compressed_row(const uint8_t* in, Value* result){
+    uint32_t size;
+    in = read_varint(in, size);
+    result[0] = size;
+    if(size > 0){
+        int gap_width = (in[0]>>4)+1;
+        int count_width = (in[0]&0xf)+1;
+        in = decode_bit_packed(in+1, size, gap_width, result+1);
+        in = decode_bit_packed(in, size, count_width, result+1+size);
+        prefix_sum(result+1, size);
+    }
+    return in;
+}
+
+uint32_t compressed_row_count(const uint8_t* in){
+    uint32_t size;
+    read_varint(in, size);
+    return size;
+}
+
+size_t compressed_row_size(const uint8_t* in){
+    uint32_t size;
+    const uint8_t* widths = read_varint(in, size);
+    if(size == 0){
+        return widths-in;
+    }
+    int gap_width = (widths[0]>>4)+1;
+    int count_width = (widths[0]&0xf)+1;
+    return (widths-in)+1+((size_t)size*gap_width+7)/8+((size_t)size*count_width+7)/8;
+}
+
+// dense row of a row in the CompactTensor layout
+static Value* expand_compact_row(Value* compact, int dim){
+    Value* result = new Value[dim];
+    memset(result, 0, sizeof(Value)*dim);
+    Value size = compact[0];
+    for(int j=0;j<size;++j){
+        result[compact[1+j]] = compact[1+size+j];
+    }
+    return result;
+}
+
 void vector_concat(Value*& t1, Value* t2, int size_1, int size_2){
     Value* t1_tmp = t1;
     t1 = new Value [size_1+size_2];
@@ -275,6 +368,44 @@ vector<vector<Label>> load_label_path(string file_name){
 	return result;
 }
 
+// whether index_dir/index_file has the size and modification time of a merged.manifest stamp
+static bool same_index_stamp(string index_dir, string index_file, long long size, long long mtime){
+    struct stat st;
+    if(stat((index_dir+string("/")+index_file).c_str(), &st) != 0){
+        return false;
+    }
+    return (long long)st.st_size == size && (long long)st.st_mtime == mtime;
+}
+
+bool load_merged_manifest(string index_dir, string name, string cycle_index, string path_index, int cycle_columns, int path_columns){
+    string cycle_features = cycle_index.substr(0, cycle_index.size()-5)+string("features");
+    string path_features = path_index.substr(0, path_index.size()-5)+string("features");
+    ifstream fin(index_dir+string("/merged.manifest"));
+    string line;
+    while(getline(fin, line)){
+        stringstream ss(line);
+        string merged_file, listed_cycle_features, listed_path_features, listed_cycle_index, listed_path_index;
+        int listed_cycle_columns, listed_path_columns;
+        long long cycle_size, cycle_mtime, path_size, path_mtime;
+        if(!(ss>>merged_file>>listed_cycle_features>>listed_path_features>>listed_cycle_columns>>listed_path_columns
+            >>listed_cycle_index>>cycle_size>>cycle_mtime>>listed_path_index>>path_size>>path_mtime) || merged_file != name){
+            continue;
+        }
+        if(listed_cycle_features != cycle_features || listed_path_features != path_features || listed_cycle_index != cycle_index || listed_path_index != path_index
+            || listed_cycle_columns != cycle_columns || listed_path_columns != path_columns){
+            cout<<name<<" is merged from other indices, ignored"<<endl;
+            return false;
+        }
+        if(!same_index_stamp(index_dir, cycle_index, cycle_size, cycle_mtime) || !same_index_stamp(index_dir, path_index, path_size, path_mtime)){
+            cout<<name<<" is older than the indices it is merged from, ignored"<<endl;
+            return false;
+        }
+        ifstream merged(index_dir+string("/")+merged_file);
+        return merged.good();
+    }
+    return false;
+}
+
 ////////////////////////////////
 Direct_IO_reader::Direct_IO_reader(string filename_, int buffer_size_){
 	filename = filename_;
@@ -442,11 +573,15 @@ Tensor::~Tensor(){
 }
 
 ////////////////////////////////////////////
-Index_manager::Index_manager(){};
+Index_manager::Index_manager(){
+    is_scaned = false;
+    is_compressed = false;
+};
 
 Index_manager::Index_manager(string filename_){
     ifstream fin(filename_);
     is_scaned = false;
+    is_compressed = false;
     filename = filename_;
     fin.close();
 }
@@ -480,8 +615,26 @@ Value* Index_manager::load_embedding(ifstream& fin, Value dim){
 }
 
 vector<Tensor*> Index_manager::load_all_graphs(){
-    ifstream fin(filename, ios::binary);
     vector<Tensor*> results;
+    ifstream fin(filename, ios::binary);
+    uint32_t magic = 0;
+    fin.read((char*)&magic, sizeof(uint32_t));
+    if(magic == INDEX_MERGED_MAGIC){
+        cout<<filename<<" is a merged index, it is only loaded by load_graph_compact_tensor"<<endl;
+        exit(-1);
+    }
+    if(magic == INDEX_CODEC_MAGIC){
+        fin.close();
+        if(!is_scaned){
+            quick_scan();
+        }
+        for(int g=0;g<offset_graph_map.size();++g){
+            results.push_back(load_graph_tensor(g));
+        }
+        return results;
+    }
+    fin.clear();
+    fin.seekg(0, ios::beg);
     while(!fin.eof()){
         int row_size, dim;
         fin.read((char*)&row_size, sizeof(int));
@@ -502,12 +655,36 @@ vector<Tensor*> Index_manager::load_all_graphs(){
 CompactTensor::CompactTensor(int row_size_){
     row_size = row_size_;
     content = new Value* [row_size];
+    arena = NULL;
+    mapping = NULL;
+    mapping_size = 0;
 }
 
-CompactTensor::~CompactTensor(){
+void CompactTensor::allocate_rows(vector<uint32_t>& row_counts){
+    size_t arena_size = 0;
     for(int i=0;i<row_size;++i){
-        delete content[i];
+        arena_size += 1+2*row_counts[i];
+    }
+    arena = new Value[arena_size];
+    size_t position = 0;
+    for(int i=0;i<row_size;++i){
+        content[i] = arena+position;
+        content[i][0] = row_counts[i];
+        position += 1+2*row_counts[i];
+    }
+}
+
+CompactTensor::~CompactTensor(){
+    if(mapping != NULL){
+        munmap(mapping, mapping_size);
+    }else if(arena != NULL){
+        delete [] arena;
+    }else{
+        for(int i=0;i<row_size;++i){
+            delete content[i];
+        }
     }
+    delete [] content;
 }
 
 bool compact_vec_validation(Value* vec1, Value* vec2){
@@ -520,7 +697,8 @@ bool compact_vec_validation(Value* vec1, Value* vec2){
     Value* vec2_key = vec2+1;
     Value* vec1_value = vec1+1+vec1_size;
     Value* vec2_value = vec2+1+vec2_size;
-    for(int i=0,j=0;i<vec1_size && j<vec2_size;){
+    int i=0, j=0;
+    while(i<vec1_size && j<vec2_size){
         if(vec1_key[i] == vec2_key[j]){
             if(vec1_value[i] > vec2_value[j]){
                 return false;
@@ -533,7 +711,8 @@ bool compact_vec_validation(Value* vec1, Value* vec2){
             j++;
         }
     }
-    return true;
+    // keys of vec1 left over are missing in vec2
+    return i == vec1_size;
 }
 
 CompactTensor* merge_bi_CompactTensors(CompactTensor* ct1, CompactTensor* ct2){
@@ -543,13 +722,17 @@ CompactTensor* merge_bi_CompactTensors(CompactTensor* ct1, CompactTensor* ct2){
     Value** ct1_content = ct1->content;
     Value** ct2_content = ct2->content;
     int ct1_column_size = ct1->column_size;
+    vector<uint32_t> row_counts(row_size);
+    for(int i=0;i<row_size;++i){
+        row_counts[i] = ct1_content[i][0]+ct2_content[i][0];
+    }
+    result->allocate_rows(row_counts);
+    result->column_size = ct1_column_size+ct2->column_size;
     int v1_size;
     int v2_size;
     for(int i=0;i<row_size;++i){
         v1_size = ct1_content[i][0];
         v2_size = ct2_content[i][0];
-        result_content[i] = new Value [1+2*v1_size+2*v2_size];
-        result_content[i][0] = v1_size + v2_size;
         Value* start = result_content[i]+1;
         
         memcpy(start, ct1_content[i]+1, sizeof(Value)*v1_size);
@@ -601,64 +784,326 @@ CompactTensor* merge_bi_CompactTensors(Tensor* t1, Tensor* t2){
     return result;
 }
 
+ColumnTensor::ColumnTensor(CompactTensor* tensor, const Graph* graph){
+    row_size = tensor->row_size;
+    label_count = graph->getLabelsCount();
+    Value** content = tensor->content;
+
+    // the merged tensors do not carry a reliable column_size, take it from the keys
+    column_size = 0;
+    for(int i=0;i<row_size;++i){
+        Value size = content[i][0];
+        if(size > 0 && content[i][size] + 1 > column_size){
+            column_size = content[i][size] + 1;
+        }
+    }
+
+    size_t list_num = (size_t)column_size*label_count;
+    offsets = new size_t [list_num+1];
+    memset(offsets, 0, sizeof(size_t)*(list_num+1));
+    for(int i=0;i<row_size;++i){
+        Label l = graph->getVertexLabel(i);
+        Value size = content[i][0];
+        Value* keys = content[i]+1;
+        for(int j=0;j<size;++j){
+            offsets[(size_t)keys[j]*label_count+l+1] ++;
+        }
+    }
+    for(size_t i=0;i<list_num;++i){
+        offsets[i+1] += offsets[i];
+    }
+
+    size_t entry_num = offsets[list_num];
+    rows = new Vertex [entry_num];
+    values = new Value [entry_num];
+    vector<size_t> cursor(offsets, offsets+list_num);
+    // rows are visited in order, so every posting list is sorted by vertex id
+    for(int i=0;i<row_size;++i){
+        Label l = graph->getVertexLabel(i);
+        Value size = content[i][0];
+        Value* keys = content[i]+1;
+        Value* vals = content[i]+1+size;
+        for(int j=0;j<size;++j){
+            size_t pos = cursor[(size_t)keys[j]*label_count+l] ++;
+            rows[pos] = i;
+            values[pos] = vals[j];
+        }
+    }
+
+    hits = new Value [row_size];
+    memset(hits, 0, sizeof(Value)*row_size);
+}
+
+bool ColumnTensor::scan_candidates(Value* query_row, Label label, vector<Vertex>& result){
+    result.clear();
+    Value size = query_row[0];
+    if(size == 0){
+        return false;
+    }
+    if(label >= label_count){
+        return true;
+    }
+    Value* keys = query_row+1;
+    Value* vals = query_row+1+size;
+
+    // seed with the shortest posting list, the remaining lists can only shrink it
+    int seed = -1;
+    size_t seed_len = 0;
+    for(int i=0;i<size;++i){
+        if(keys[i] >= column_size){
+            return true;
+        }
+        size_t pos = (size_t)keys[i]*label_count+label;
+        size_t len = offsets[pos+1] - offsets[pos];
+        if(seed == -1 || len < seed_len){
+            seed = i;
+            seed_len = len;
+        }
+    }
+
+    size_t pos = (size_t)keys[seed]*label_count+label;
+    for(size_t j=offsets[pos];j<offsets[pos+1];++j){
+        if(values[j] >= vals[seed]){
+            hits[rows[j]] = 1;
+            result.push_back(rows[j]);
+        }
+    }
+
+    // hits[v] counts the columns v has passed so far
+    Value passed = 1;
+    for(int i=0;i<size && !result.empty();++i){
+        if(i == seed){
+            continue;
+        }
+        pos = (size_t)keys[i]*label_count+label;
+        Value threshold = vals[i];
+        for(size_t j=offsets[pos];j<offsets[pos+1];++j){
+            Vertex v = rows[j];
+            if(hits[v] == passed && values[j] >= threshold){
+                hits[v] ++;
+            }
+        }
+        passed ++;
+    }
+
+    int valid_count = 0;
+    for(auto v : result){
+        if(hits[v] == passed){
+            result[valid_count++] = v;
+        }
+        hits[v] = 0;
+    }
+    result.resize(valid_count);
+    return true;
+}
+
+size_t ColumnTensor::scan_cost(Value* query_row, Label label){
+    Value size = query_row[0];
+    if(label >= label_count){
+        return 0;
+    }
+    Value* keys = query_row+1;
+    size_t cost = 0;
+    for(int i=0;i<size;++i){
+        if(keys[i] >= column_size){
+            return cost;
+        }
+        size_t pos = (size_t)keys[i]*label_count+label;
+        cost += offsets[pos+1] - offsets[pos];
+    }
+    return cost;
+}
+
+ColumnTensor::~ColumnTensor(){
+    delete[] offsets;
+    delete[] rows;
+    delete[] values;
+    delete[] hits;
+}
+
 CompactTensor* Index_manager::load_graph_compact_tensor(int graph_offset){
-    if(!is_scaned){
-        quick_scan();
+    int fd = open(filename.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if(fd < 0 || fstat(fd, &file_stat) != 0){
+        cout<<"Failed to open file:"<<filename<<endl;
+        exit(-1);
     }
-    if(graph_offset>offset_graph_map.size()){
-        cout<<"graph offset overflow"<<endl;
-        return NULL;
+    size_t file_size = file_stat.st_size;
+    uint32_t magic = 0;
+    if(pread(fd, &magic, sizeof(uint32_t), 0) == sizeof(uint32_t)){
+        is_compressed = (magic == INDEX_CODEC_MAGIC);
     }
-    long offset = offset_graph_map[graph_offset];
-    ifstream fin(filename, ios::binary);
-    fin.seekg(offset, ios::beg);
+    if(magic == INDEX_MERGED_MAGIC){
+        // private and writable, pages are only copied if a row is modified
+        char* file = (char*)mmap(NULL, file_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(file == MAP_FAILED){
+            cout<<"Failed to map file:"<<filename<<endl;
+            exit(-1);
+        }
+        CompactTensor* emb = load_merged_rows(file, file_size, graph_offset);
+        if(emb == NULL){
+            munmap(file, file_size);
+        }
+        return emb;
+    }
+    // the first graph follows the header, the others are located by quick_scan
+    long offset = is_compressed ? 2*sizeof(uint32_t) : 0;
+    if(graph_offset > 0){
+        if(!is_scaned){
+            quick_scan();
+        }
+        if(graph_offset>=offset_graph_map.size()){
+            cout<<"graph offset overflow"<<endl;
+            close(fd);
+            return NULL;
+        }
+        offset = offset_graph_map[graph_offset];
+    }
+    CompactTensor* emb;
+    if(is_compressed){
+        close(fd);
+        ifstream fin(filename, ios::binary);
+        int row_size, dim;
+        uint8_t* rows = load_compressed_rows(fin, offset, row_size, dim);
+        vector<uint32_t> row_counts(row_size);
+        const uint8_t* in = rows;
+        for(int i=0;i<row_size;++i){
+            row_counts[i] = compressed_row_count(in);
+            in += compressed_row_size(in);
+        }
+        emb = new CompactTensor(row_size);
+        emb->column_size = dim;
+        emb->allocate_rows(row_counts);
+        in = rows;
+        for(int i=0;i<row_size;++i){
+            in = decode_compressed_row(in, emb->content[i]);
+        }
+        delete [] rows;
+        fin.close();
+    }else{
+        // the rows are parsed from a read-only mapping of the file
+        char* file = (char*)mmap(NULL, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if(file == MAP_FAILED){
+            cout<<"Failed to map file:"<<filename<<endl;
+            exit(-1);
+        }
+        madvise(file, file_size, MADV_SEQUENTIAL);
+        emb = load_compact_rows(file+offset, file+file_size);
+        munmap(file, file_size);
+    }
+    return emb;
+}
+
+CompactTensor* Index_manager::load_merged_rows(char* file, size_t file_size, int graph_offset){
+    uint32_t version;
+    memcpy(&version, file+sizeof(uint32_t), sizeof(uint32_t));
+    if(version != INDEX_MERGED_VERSION){
+        cout<<"unsupported version "<<version<<" of the merged index "<<filename<<endl;
+        exit(-1);
+    }
+    size_t header_size = 2*sizeof(int)+sizeof(uint64_t);
+    size_t position = 2*sizeof(uint32_t);
     int row_size, dim;
-    fin.read((char*)&row_size, sizeof(int));
-    fin.read((char*)&dim, sizeof(int));
+    uint64_t value_count;
+    for(int g=0; ; ++g){
+        if(position+header_size > file_size){
+            cout<<"graph offset overflow"<<endl;
+            return NULL;
+        }
+        memcpy(&row_size, file+position, sizeof(int));
+        memcpy(&dim, file+position+sizeof(int), sizeof(int));
+        memcpy(&value_count, file+position+2*sizeof(int), sizeof(uint64_t));
+        if(position+header_size+value_count*sizeof(Value) > file_size){
+            cout<<"truncated index file:"<<filename<<endl;
+            exit(-1);
+        }
+        if(g == graph_offset){
+            break;
+        }
+        position += header_size+value_count*sizeof(Value);
+    }
+    madvise(file, file_size, MADV_WILLNEED);
+    Value* rows = (Value*)(file+position+header_size);
     CompactTensor* emb = new CompactTensor(row_size);
     emb->column_size = dim;
+    emb->mapping = file;
+    emb->mapping_size = file_size;
+    uint64_t row_position = 0;
     for(int i=0;i<row_size;++i){
-        emb->content[i] = load_compact_embedding(fin, dim);
+        if(row_position >= value_count){
+            cout<<"truncated index file:"<<filename<<endl;
+            exit(-1);
+        }
+        emb->content[i] = rows+row_position;
+        row_position += 1+2*(uint64_t)rows[row_position];
     }
-    fin.close();
     return emb;
 }
 
-Value* Index_manager::load_compact_embedding(ifstream& fin, Value dim){
-    bool is_sparse;
-    fin.read((char*)&is_sparse, sizeof(bool));
-    if(is_sparse){
-        int content_size;
-        fin.read((char*)&content_size, sizeof(int));
-        Value* result = new Value[1+2*content_size];
-
-        // vector<Value> idx(content_size, 0);
-        // vector<Value> val(content_size, 0);
-        // fin.read((char*)&(idx[0]), content_size*sizeof(Value));
-        // fin.read((char*)&(val[0]), content_size*sizeof(Value));
-        result[0] = content_size;
-        fin.read((char*)(result+1), content_size*2*sizeof(Value));
-        return result;
-    }else{
-        Value* tmp = new Value[dim];
-        fin.read((char*)tmp, dim*sizeof(Value));
-        
-        vector<Value> tmp_key;
-        vector<Value> tmp_value;
-        for(Value i=0;i<dim;++i){
-            if(tmp[i] > 0){
-                tmp_key.push_back(i);
-                tmp_value.push_back(tmp[i]);
+CompactTensor* Index_manager::load_compact_rows(const char* record, const char* end){
+    int row_size, dim;
+    if(record+2*sizeof(int) > end){
+        cout<<"truncated index file:"<<filename<<endl;
+        exit(-1);
+    }
+    memcpy(&row_size, record, sizeof(int));
+    memcpy(&dim, record+sizeof(int), sizeof(int));
+    // where every row starts and how many counts it holds, the rows are copied once the arena is allocated
+    vector<const char*> rows(row_size);
+    vector<uint32_t> row_counts(row_size, 0);
+    const char* position = record+2*sizeof(int);
+    for(int i=0;i<row_size;++i){
+        if(position+sizeof(bool)+sizeof(int) > end){
+            cout<<"truncated index file:"<<filename<<endl;
+            exit(-1);
+        }
+        rows[i] = position;
+        bool is_sparse = position[0];
+        position += sizeof(bool);
+        if(is_sparse){
+            int content_size;
+            memcpy(&content_size, position, sizeof(int));
+            row_counts[i] = content_size;
+            position += sizeof(int)+2*sizeof(Value)*(size_t)content_size;
+        }else{
+            for(int j=0;j<dim;++j){
+                Value value;
+                memcpy(&value, position+j*sizeof(Value), sizeof(Value));
+                row_counts[i] += (value > 0);
             }
+            position += sizeof(Value)*dim;
+        }
+        if(position > end){
+            cout<<"truncated index file:"<<filename<<endl;
+            exit(-1);
         }
-        delete tmp;
-        int content_size = tmp_key.size();
-        Value* result = new Value[1+2*content_size];
-        result[0] = content_size;
-        memcpy(result+1, &(tmp_key[0]), content_size*sizeof(Value));
-        memcpy(result+1+content_size, &(tmp_value[0]), content_size*sizeof(Value));
-        return result;
     }
+    CompactTensor* emb = new CompactTensor(row_size);
+    emb->column_size = dim;
+    emb->allocate_rows(row_counts);
+    for(int i=0;i<row_size;++i){
+        Value* row = emb->content[i];
+        const char* source = rows[i]+sizeof(bool);
+        if(rows[i][0]){
+            memcpy(row+1, source+sizeof(int), 2*sizeof(Value)*row_counts[i]);
+        }else{
+            Value* columns = row+1;
+            Value* counts = row+1+row_counts[i];
+            int k = 0;
+            for(int j=0;j<dim;++j){
+                Value value;
+                memcpy(&value, source+j*sizeof(Value), sizeof(Value));
+                if(value > 0){
+                    columns[k] = j;
+                    counts[k] = value;
+                    ++ k;
+                }
+            }
+        }
+    }
+    return emb;
 }
 
 Tensor* Index_manager::load_graph_tensor(int graph_offset){
@@ -671,6 +1116,21 @@ Tensor* Index_manager::load_graph_tensor(int graph_offset){
     }
     long offset = offset_graph_map[graph_offset];
     ifstream fin(filename, ios::binary);
+    if(is_compressed){
+        int row_size, dim;
+        uint8_t* rows = load_compressed_rows(fin, offset, row_size, dim);
+        Tensor* emb = new Tensor(row_size);
+        emb->column_size = dim;
+        const uint8_t* in = rows;
+        vector<Value> compact(1+2*dim);
+        for(int i=0;i<row_size;++i){
+            in = decode_compressed_row(in, &(compact[0]));
+            emb->content[i] = expand_compact_row(&(compact[0]), dim);
+        }
+        delete [] rows;
+        fin.close();
+        return emb;
+    }
     fin.seekg(offset, ios::beg);
     int row_size, dim;
     fin.read((char*)&row_size, sizeof(int));
@@ -719,16 +1179,80 @@ void Index_manager::load_vertex_embedding(int graph_offset, Vertex v, vector<Val
     vector<size_t>& offset = offset_vertex_map[graph_offset][v];
     ifstream fin(filename, ios::binary);
     fin.seekg(offset[1], ios::beg);
-    Value* r = load_embedding(fin, offset_dim_map[graph_offset]);
+    Value* r;
+    if(is_compressed){
+        uint8_t* row = new uint8_t[offset[0]+INDEX_CODEC_PADDING];
+        fin.read((char*)row, offset[0]);
+        vector<Value> compact(1+2*offset_dim_map[graph_offset]);
+        decode_compressed_row(row, &(compact[0]));
+        r = expand_compact_row(&(compact[0]), offset_dim_map[graph_offset]);
+        delete [] row;
+    }else{
+        r = load_embedding(fin, offset_dim_map[graph_offset]);
+    }
     result.resize(offset_dim_map[graph_offset]);
     memcpy(&(result[0]), r, sizeof(Value)*offset_dim_map[graph_offset]);
     delete r;
     fin.close();
 }
 
+uint8_t* Index_manager::load_compressed_rows(ifstream& fin, long offset, int& row_size, int& dim){
+    fin.seekg(offset, ios::beg);
+    uint64_t byte_size;
+    fin.read((char*)&row_size, sizeof(int));
+    fin.read((char*)&dim, sizeof(int));
+    fin.read((char*)&byte_size, sizeof(uint64_t));
+    uint8_t* rows = new uint8_t[byte_size+INDEX_CODEC_PADDING];
+    fin.read((char*)rows, byte_size);
+    memset(rows+byte_size, 0, INDEX_CODEC_PADDING);
+    return rows;
+}
+
 void Index_manager::quick_scan(){
     is_scaned = true;
     ifstream fin(filename, ios::binary);
+    uint32_t magic = 0;
+    fin.read((char*)&magic, sizeof(uint32_t));
+    is_compressed = (magic == INDEX_CODEC_MAGIC);
+    if(magic == INDEX_MERGED_MAGIC){
+        cout<<filename<<" is a merged index, it is only loaded by load_graph_compact_tensor"<<endl;
+        exit(-1);
+    }
+    if(is_compressed){
+        uint32_t version;
+        fin.read((char*)&version, sizeof(uint32_t));
+        if(version != INDEX_CODEC_VERSION){
+            cout<<"unsupported version "<<version<<" of the compressed index "<<filename<<endl;
+            exit(-1);
+        }
+        fin.seekg(0, ios::end);
+        long file_end = fin.tellg();
+        long offset = 2*sizeof(uint32_t);
+        while(offset < file_end){
+            int num_rows, row_size;
+            uint8_t* rows = load_compressed_rows(fin, offset, num_rows, row_size);
+            long rows_offset = offset+2*sizeof(int)+sizeof(uint64_t);
+            offset_graph_map.push_back(offset);
+            offset_dim_map.push_back(row_size);
+            // [0] is the byte size of the row
+            vector<vector<size_t>> vertex_map(num_rows, vector<size_t>(2, 0));
+            const uint8_t* in = rows;
+            for(int i=0;i<num_rows;++i){
+                vertex_map[i][0] = compressed_row_size(in);
+                vertex_map[i][1] = rows_offset+(in-rows);
+                in += vertex_map[i][0];
+            }
+            offset_vertex_map.push_back(vertex_map);
+            offset = rows_offset+(in-rows);
+            delete [] rows;
+        }
+        fin.close();
+        offset_dim_map.shrink_to_fit();
+        offset_graph_map.shrink_to_fit();
+        offset_vertex_map.shrink_to_fit();
+        return;
+    }
+    fin.seekg(0, ios::beg);
     while(true){
         offset_graph_map.push_back(fin.tellg());
         int num_rows, row_size;
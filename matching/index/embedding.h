@@ -21,6 +21,8 @@
 #include <sys/types.h>
 #include <fcntl.h>
 #include <malloc.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include <errno.h>
 
@@ -32,8 +34,36 @@ using namespace std;
 
 bool cmp(const pair<Value, Value>& a, const pair<Value, Value>& b);
 
+// a+b saturated at the largest Value, as the counts of the indices are
+inline void sum_safe_without_overflow(Value& a, Value b){
+    Value tmp = a+b;
+    a = (tmp < a) ? (Value)~0 : tmp;
+}
+
 // utilities
 void dump_vector(ofstream& fout, Value* content, int dim);
+
+// Compressed index files (run_build_index --compress 1) start with INDEX_CODEC_MAGIC and
+// INDEX_CODEC_VERSION (uint32 each), then hold per graph [num of row (int)] [size of the row (int)]
+// [bytes of the rows (uint64)] and the rows. A row is its number n of non-zero counts as a varint,
+// then a byte of the bit widths of its column gaps and of its counts, minus one, in the high and low
+// 4 bits, then the n gaps and the n counts, each bit-packed at their width of the row. Readers keep
+// INDEX_CODEC_PADDING readable bytes after the rows for the vector loads.
+#define INDEX_CODEC_MAGIC 0x5a435050 // "PPCZ"
+#define INDEX_CODEC_VERSION 1
+#define INDEX_CODEC_PADDING 16
+// Merged index files (run_build_index --merged 1) start with INDEX_MERGED_MAGIC and
+// INDEX_MERGED_VERSION (uint32 each), then hold per graph [num of row (int)] [size of the row (int)]
+// [num of values (uint64)] and the rows of merge_bi_CompactTensors(cycle index, path index) in the
+// CompactTensor layout, one after the other. They are mapped and used in place.
+#define INDEX_MERGED_MAGIC 0x4d435050 // "PPCM"
+#define INDEX_MERGED_VERSION 1
+// decodes the row at in into result, in the CompactTensor layout [n] [columns] [counts] of
+// 1+2*compressed_row_count(in) values; returns the next row
+const uint8_t* decode_compressed_row(const uint8_t* in, Value* result);
+uint32_t compressed_row_count(const uint8_t* in);
+// byte size of the row at in
+size_t compressed_row_size(const uint8_t* in);
 void vector_concat(Value*& t1, Value* t2, int size_1, int size_2);
 void vector_add_mul(Value*& t1, Value* t2, Value* t3, int size);
 void vector_add(Value*& t1, Value* t2, int size);
@@ -64,17 +94,49 @@ public:
 	~Direct_IO_reader();
 };
 
+// row i is content[i] = [n] [n columns] [n counts]
 class CompactTensor{
 public:
     Value** content;
+    Value* arena; // all rows in one block when set, otherwise every row is allocated on its own
+    char* mapping; // the mapped merged index file holding the rows when set
+    size_t mapping_size;
     int row_size;
     int column_size;
     CompactTensor(int row_size_);
+    // points the rows into a new arena, row i with room for row_counts[i] columns and counts
+    void allocate_rows(vector<uint32_t>& row_counts);
     ~CompactTensor();
 };
 
 bool compact_vec_validation(Value* vec1, Value* vec2);
 CompactTensor* merge_bi_CompactTensors(CompactTensor* ct1, CompactTensor* ct2);
+
+class Graph;
+
+// feature-major layout of a CompactTensor: for every (feature, label) pair, a posting list of
+// the vertices with that label and a non-zero count, sorted by vertex id.
+class ColumnTensor{
+public:
+    int row_size;
+    int column_size;
+    int label_count;
+    size_t* offsets; // posting list of (f, l) is [offsets[f*label_count+l], offsets[f*label_count+l+1])
+    Vertex* rows;
+    Value* values;
+    Value* hits;
+
+    ColumnTensor(CompactTensor* tensor, const Graph* graph);
+
+    // collect the vertices with label `label` that dominate `query_row` (same semantics as
+    // compact_vec_validation). Returns false if the row has no feature, i.e., nothing is filtered.
+    bool scan_candidates(Value* query_row, Label label, vector<Vertex>& result);
+
+    // number of posting entries scan_candidates would visit for `query_row`
+    size_t scan_cost(Value* query_row, Label label);
+
+    ~ColumnTensor();
+};
 bool valid_gnn_embedding(float* query_emb, float* data_emb, int size);
 
 // class
@@ -114,6 +176,7 @@ public:
     vector<vector<vector<size_t>>> offset_vertex_map; //0->sparse/dense 1->offset
     vector<size_t> offset_graph_map;
     vector<size_t> offset_dim_map;
+    bool is_compressed; // the file is in the compressed layout, set by quick_scan
 
     Index_manager();
     Index_manager(string filename_);
@@ -121,7 +184,12 @@ public:
     // [sparse/dense (int)] [num of row (int)] [size of the row]
     void dump_tensor(Tensor* tensor);
     Value* load_embedding(ifstream& fin, Value dim);
-    Value* load_compact_embedding(ifstream& fin, Value dim);
+    // the rows of the graph at offset of a compressed file, followed by INDEX_CODEC_PADDING bytes
+    uint8_t* load_compressed_rows(ifstream& fin, long offset, int& row_size, int& dim);
+    // the rows of the uncompressed graph record at record, which ends before end, in one arena
+    CompactTensor* load_compact_rows(const char* record, const char* end);
+    // the rows of a merged index file, pointing into its mapping
+    CompactTensor* load_merged_rows(char* file, size_t file_size, int graph_offset);
     vector<Tensor*> load_all_graphs();
     Tensor* load_graph_tensor(int graph_offset);
     CompactTensor* load_graph_compact_tensor(int graph_offset);
@@ -146,7 +214,14 @@ void merge_multi_index_files_with_bounded_memory(vector<string>& filenames, stri
 
 vector<vector<Label>> load_label_path(string file_name);
 
+// true if merged.manifest in index_dir lists the merged file name (vertex.index or edge.index) as merged
+// from cycle_index and path_index (files in index_dir) with the given numbers of columns, counted for the
+// .features files next to them, and both indices still have the size and modification time they had
+// when the merged file was written
+bool load_merged_manifest(string index_dir, string name, string cycle_index, string path_index, int cycle_columns, int path_columns);
+
 extern string vertex_path_index, edge_path_index, vertex_cycle_index, edge_cycle_index;
 extern Tensor *query_vertex_emb, *data_vertex_emb, *query_edge_emb, *data_edge_emb;
 extern CompactTensor *query_vertex_emb_comp, *data_vertex_emb_comp, *query_edge_emb_comp, *data_edge_emb_comp;
+extern ColumnTensor *data_vertex_emb_column;
 extern pair<vector<int>, vector<float>> query_gnn_emb, data_gnn_emb;
\ No newline at end of file
@@ -20,6 +20,7 @@
 
 class feature_counter{
 public:
+    virtual ~feature_counter() {}
     virtual void count_for_edges(Graph& graph, Tensor**& result, int& result_size) = 0;
     virtual void count_for_vertices(Graph& graph, Tensor**& result, int& result_size) = 0;
     virtual vector<vector<Label>> get_features() = 0;
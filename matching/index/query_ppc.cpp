@@ -0,0 +1,143 @@
+#include "query_ppc.h"
+
+// the columns count_features keeps, in output order
+static void output_columns(bool enable_residual, vector<vector<Label>>& features, vector<pair<int, int>>& columns){
+    if(enable_residual){
+        vector<vector<bool>> redundant_mask;
+        Index_constructer con;
+        con.analyse_redundant_features(features, redundant_mask);
+        for(size_t level=0;level<redundant_mask.size();++level){
+            for(size_t f=0;f<redundant_mask[level].size();++f){
+                if(redundant_mask[level][f]){
+                    columns.push_back({level, f});
+                }
+            }
+        }
+    }else{
+        for(size_t f=0;f<features.size();++f){
+            columns.push_back({0, f});
+        }
+    }
+}
+
+static Value* compact_row(vector<Value>& keys, vector<Value>& values){
+    int size = keys.size();
+    Value* row = new Value [1+2*size];
+    row[0] = size;
+    memcpy(row+1, keys.data(), sizeof(Value)*size);
+    memcpy(row+1+size, values.data(), sizeof(Value)*size);
+    return row;
+}
+
+static void release(Tensor** tensors, int size){
+    for(int i=0;i<size;++i){
+        delete tensors[i];
+    }
+    delete [] tensors;
+}
+
+Query_ppc_builder::Query_ppc_builder(bool enable_residual, vector<vector<Label>>& vc_features, vector<vector<Label>>& vp_features,
+                                     vector<vector<Label>>& ec_features, vector<vector<Label>>& ep_features){
+    vc_counter = new Cycle_counter(enable_residual, vc_features);
+    ec_counter = new Cycle_counter(enable_residual, ec_features);
+    vp_feature_num = vp_features.size();
+    if(vp_features[0].size() == ep_features[0].size()){
+        vector<vector<Label>> path_features = vp_features;
+        path_features.insert(path_features.end(), ep_features.begin(), ep_features.end());
+        path_counter = new Path_counter(enable_residual, path_features);
+        ep_counter = NULL;
+    }else{
+        path_counter = new Path_counter(enable_residual, vp_features);
+        ep_counter = new Path_counter(enable_residual, ep_features);
+    }
+    output_columns(enable_residual, vc_features, columns[0]);
+    output_columns(enable_residual, vp_features, columns[1]);
+    output_columns(enable_residual, ec_features, columns[2]);
+    output_columns(enable_residual, ep_features, columns[3]);
+}
+
+Query_ppc_builder::~Query_ppc_builder(){
+    delete vc_counter;
+    delete ec_counter;
+    delete path_counter;
+    delete ep_counter;
+}
+
+void Query_ppc_builder::build(Graph& query_graph, CompactTensor*& vertex_emb, CompactTensor*& edge_emb){
+    query_graph.construct_edge_common_neighbor();
+    uint32_t vertex_count = query_graph.getVerticesCount();
+    uint32_t edge_count = query_graph.getEdgesCount();
+
+    Tensor **vc, **ec, **path, **ep = NULL;
+    int vc_size, ec_size, path_size, ep_size = 0;
+    vc_counter->count_for_vertices(query_graph, vc, vc_size);
+    ec_counter->count_for_edges(query_graph, ec, ec_size);
+    path_counter->count_for_vertices(query_graph, path, path_size);
+    if(ep_counter != NULL){
+        ep_counter->count_for_edges(query_graph, ep, ep_size);
+    }
+
+    vector<Value> keys, values;
+    vertex_emb = new CompactTensor(vertex_count);
+    for(Vertex v=0; v<vertex_count; ++v){
+        keys.clear();
+        values.clear();
+        int key = 0;
+        for(auto& c : columns[0]){
+            Value value = vc[c.first]->content[v][c.second];
+            if(value > 0){
+                keys.push_back(key);
+                values.push_back(value);
+            }
+            key++;
+        }
+        for(auto& c : columns[1]){
+            Value value = path[c.first]->content[v][c.second];
+            if(value > 0){
+                keys.push_back(key);
+                values.push_back(value);
+            }
+            key++;
+        }
+        vertex_emb->content[v] = compact_row(keys, values);
+    }
+
+    edge_emb = new CompactTensor(edge_count);
+    for(Vertex e_id=0; e_id<edge_count; ++e_id){
+        keys.clear();
+        values.clear();
+        int key = 0;
+        for(auto& c : columns[2]){
+            Value value = ec[c.first]->content[e_id][c.second];
+            if(value > 0){
+                keys.push_back(key);
+                values.push_back(value);
+            }
+            key++;
+        }
+        Vertex small_id = query_graph.edge_set[e_id*2];
+        Vertex large_id = query_graph.edge_set[e_id*2+1];
+        for(auto& c : columns[3]){
+            Value value;
+            if(ep_counter == NULL){
+                value = path[c.first]->content[small_id][vp_feature_num+c.second];
+                sum_safe_without_overflow(value, path[c.first]->content[large_id][vp_feature_num+c.second]);
+            }else{
+                value = ep[c.first]->content[e_id][c.second];
+            }
+            if(value > 0){
+                keys.push_back(key);
+                values.push_back(value);
+            }
+            key++;
+        }
+        edge_emb->content[e_id] = compact_row(keys, values);
+    }
+
+    release(vc, vc_size);
+    release(ec, ec_size);
+    release(path, path_size);
+    if(ep_counter != NULL){
+        release(ep, ep_size);
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "../graph/graph.h"
+#include "embedding.h"
+#include "index.h"
+
+/**
+ * PPC embeddings of a query graph in the layout the filters read: the vertex rows equal
+ * merge_bi_CompactTensors(vc, vp) and the edge rows merge_bi_CompactTensors(ec, ep) of the
+ * count_features outputs, without the dense merged tensors in between. The residual column masks
+ * are derived once per index instead of once per query, and when the vertex and edge path features
+ * have the same length a single propagation over both feature sets serves the two path variants
+ * (an edge path count is the sum over the two endpoints).
+ */
+class Query_ppc_builder{
+public:
+    Query_ppc_builder(bool enable_residual, vector<vector<Label>>& vc_features, vector<vector<Label>>& vp_features,
+                      vector<vector<Label>>& ec_features, vector<vector<Label>>& ep_features);
+    ~Query_ppc_builder();
+
+    void build(Graph& query_graph, CompactTensor*& vertex_emb, CompactTensor*& edge_emb);
+
+    // number of output columns of vc, vp, ec or ep (k = 0..3), which their data indices have as well
+    int column_count(int k) const { return columns[k].size(); }
+
+private:
+    Cycle_counter* vc_counter;
+    Cycle_counter* ec_counter;
+    Path_counter* path_counter; // vp features followed by ep features if fused, otherwise vp only
+    Path_counter* ep_counter;   // NULL if fused
+    int vp_feature_num;
+
+    // (level, feature) of every output column of vc, vp, ec, ep
+    vector<pair<int, int>> columns[4];
+};
@@ -0,0 +1,34 @@
+#include "graph/graph.h"
+#include "utility/graphoperations.h"
+
+// usage: RelabelGraph.out input.graph output.graph [degree|rcm]
+// writes the relabeled graph to output.graph and the original vertex ids to output.graph.map; build
+// the index on output.graph and pass the map to the matcher with --mapping
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cout << "usage: " << argv[0] << " input.graph output.graph [degree|rcm]" << std::endl;
+        return -1;
+    }
+    std::string input_src_file_path(argv[1]);
+    std::string output_dst_file_path(argv[2]);
+    std::string method = argc > 3 ? std::string(argv[3]) : std::string("rcm");
+
+    Graph graph(false);
+    graph.loadGraphFromFile(input_src_file_path);
+
+    uint32_t* order = new uint32_t[graph.getVerticesCount()];
+    if (method == "degree") {
+        GraphOperations::compute_degree_order(&graph, order);
+    }
+    else if (method == "rcm") {
+        GraphOperations::compute_rcm_order(&graph, order);
+    }
+    else {
+        std::cout << "unknown relabeling method " << method << std::endl;
+        return -1;
+    }
+
+    graph.storeRelabeledGraph(output_dst_file_path, output_dst_file_path + ".map", order);
+    delete[] order;
+    return 0;
+}
@@ -0,0 +1,154 @@
+#include "canonical_query.h"
+#include <algorithm>
+#include <functional>
+#include <sstream>
+
+#define ISOMORPHISM_STEP_LIMIT 100000
+
+// replaces every value by its rank among the distinct values
+template<typename T>
+static uint32_t rank_values(const std::vector<T> &values, std::vector<uint32_t> &ranks) {
+    std::vector<T> distinct(values);
+    std::sort(distinct.begin(), distinct.end());
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    ranks.resize(values.size());
+    for (uint32_t i = 0; i < values.size(); ++i) {
+        ranks[i] = std::lower_bound(distinct.begin(), distinct.end(), values[i]) - distinct.begin();
+    }
+    return distinct.size();
+}
+
+canonical_query::canonical_query(const Graph *query_graph) {
+    uint32_t n = query_graph->getVerticesCount();
+    std::vector<std::pair<Label, uint32_t>> initial(n);
+    for (uint32_t u = 0; u < n; ++u) {
+        initial[u] = {query_graph->getVertexLabel(u), query_graph->getVertexDegree(u)};
+    }
+    uint32_t classes = rank_values(initial, colors_);
+
+    // a signature starts with the old color, so the new ranks refine the old ones
+    std::vector<std::vector<uint32_t>> signatures(n);
+    while (true) {
+        for (uint32_t u = 0; u < n; ++u) {
+            uint32_t nbrs_cnt;
+            const uint32_t *nbrs = query_graph->getVertexNeighbors(u, nbrs_cnt);
+            signatures[u].assign(1, colors_[u]);
+            for (uint32_t i = 0; i < nbrs_cnt; ++i) {
+                signatures[u].push_back(colors_[nbrs[i]]);
+            }
+            std::sort(signatures[u].begin() + 1, signatures[u].end());
+        }
+        uint32_t refined_classes = rank_values(signatures, colors_);
+        if (refined_classes == classes)
+            break;
+        classes = refined_classes;
+    }
+
+    // per color class its label and size, then the colored edges
+    std::vector<Label> class_label(classes);
+    std::vector<uint32_t> class_size(classes, 0);
+    std::vector<std::pair<uint32_t, uint32_t>> colored_edges;
+    for (uint32_t u = 0; u < n; ++u) {
+        class_label[colors_[u]] = query_graph->getVertexLabel(u);
+        class_size[colors_[u]] += 1;
+        uint32_t nbrs_cnt;
+        const uint32_t *nbrs = query_graph->getVertexNeighbors(u, nbrs_cnt);
+        for (uint32_t i = 0; i < nbrs_cnt; ++i) {
+            if (u < nbrs[i])
+                colored_edges.emplace_back(std::min(colors_[u], colors_[nbrs[i]]), std::max(colors_[u], colors_[nbrs[i]]));
+        }
+    }
+    std::sort(colored_edges.begin(), colored_edges.end());
+
+    std::ostringstream out;
+    out << n << ':' << colored_edges.size() << '|';
+    for (uint32_t c = 0; c < classes; ++c) {
+        out << class_label[c] << 'x' << class_size[c] << ',';
+    }
+    out << '|';
+    for (auto &e : colored_edges) {
+        out << e.first << '-' << e.second << ',';
+    }
+    key_ = out.str();
+
+    adjacency_.resize(n);
+    for (uint32_t u = 0; u < n; ++u) {
+        uint32_t nbrs_cnt;
+        const uint32_t *nbrs = query_graph->getVertexNeighbors(u, nbrs_cnt);
+        adjacency_[u].assign(nbrs, nbrs + nbrs_cnt);
+    }
+}
+
+bool canonical_query::find_isomorphism(const Graph *query_graph, const std::vector<uint32_t> &colors,
+                                       std::vector<uint32_t> &mapping) const {
+    uint32_t n = colors_.size();
+    std::vector<uint32_t> class_size(n + 1, 0);
+    for (auto c : colors_) {
+        class_size[c] += 1;
+    }
+
+    // match the cached vertices in BFS order from the most selective ones, each next to a matched parent
+    std::vector<uint32_t> order;
+    std::vector<uint32_t> parent(n, n);
+    std::vector<bool> visited(n, false);
+    while (order.size() < n) {
+        uint32_t root = n;
+        for (uint32_t u = 0; u < n; ++u) {
+            if (!visited[u] && (root == n || class_size[colors_[u]] < class_size[colors_[root]]))
+                root = u;
+        }
+        visited[root] = true;
+        order.push_back(root);
+        for (uint32_t i = order.size() - 1; i < order.size(); ++i) {
+            for (auto w : adjacency_[order[i]]) {
+                if (!visited[w]) {
+                    visited[w] = true;
+                    parent[w] = order[i];
+                    order.push_back(w);
+                }
+            }
+        }
+    }
+
+    mapping.assign(n, n);
+    std::vector<bool> used(n, false);
+    uint32_t steps = 0;
+    std::function<bool(uint32_t)> extend = [&](uint32_t depth) -> bool {
+        if (depth == n)
+            return true;
+        uint32_t u = order[depth];
+        std::vector<uint32_t> candidates;
+        if (parent[u] != n) {
+            uint32_t nbrs_cnt;
+            const uint32_t *nbrs = query_graph->getVertexNeighbors(mapping[parent[u]], nbrs_cnt);
+            candidates.assign(nbrs, nbrs + nbrs_cnt);
+        } else {
+            for (uint32_t v = 0; v < n; ++v)
+                candidates.push_back(v);
+        }
+        for (auto v : candidates) {
+            if (used[v] || colors[v] != colors_[u])
+                continue;
+            if (++steps > ISOMORPHISM_STEP_LIMIT)
+                return false;
+            bool consistent = true;
+            for (auto w : adjacency_[u]) {
+                if (mapping[w] != n && !query_graph->checkEdgeExistence(v, mapping[w])) {
+                    consistent = false;
+                    break;
+                }
+            }
+            if (!consistent)
+                continue;
+            mapping[u] = v;
+            used[v] = true;
+            if (extend(depth + 1))
+                return true;
+            mapping[u] = n;
+            used[v] = false;
+        }
+        return false;
+    };
+    // with equal vertex and edge counts, an injective edge-preserving mapping is an isomorphism
+    return extend(0);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "../graph/graph.h"
+#include "../configuration/config.h"
+#include <vector>
+#include <string>
+
+/**
+ * Structure of a labeled query graph up to isomorphism. colors_ is the stable color-refinement
+ * partition (labels, degrees and refined neighborhoods), numbered canonically, and key_ is derived
+ * from it, so isomorphic queries always share the key. Equal keys do not imply isomorphism; callers
+ * confirm with find_isomorphism before reusing anything computed for another query.
+ */
+struct canonical_query {
+    std::string key_;
+    std::vector<uint32_t> colors_;
+    std::vector<std::vector<uint32_t>> adjacency_;
+
+    canonical_query() {}
+    explicit canonical_query(const Graph *query_graph);
+
+    // mapping[u] is the vertex of query_graph that plays the role of vertex u of this query; false
+    // if there is none or the search exceeds its step budget
+    bool find_isomorphism(const Graph *query_graph, const std::vector<uint32_t> &colors,
+                          std::vector<uint32_t> &mapping) const;
+};
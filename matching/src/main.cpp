@@ -13,6 +13,9 @@
 #include "../index/cycle_counting.h"
 #include "../index/path_counting.h"
 #include "../index/index.h"
+#include "../index/query_ppc.h"
+#include "query_emb_cache.h"
+#include "../utility/run_config.h"
 // #include "../utility/utils.h"
 // #include "../model/model.h"
 // #include "../graph_decomposition/decomposition.h"
@@ -87,7 +90,10 @@ struct Param{
     string EP_path;
     string EC_path;
     string index_path;
+    string mapping_file; // original ids of a relabeled data graph
     uint32_t num;
+    string config_file;
+    vector<string> config_overrides; // key=value, applied after config_file
 };
 
 static struct Param parsed_input_para;
@@ -101,7 +107,11 @@ static const struct option long_options[] = {
     // {"EP", required_argument, NULL, 'z'},
     // {"EC", required_argument, NULL, 'l'},
     {"num", required_argument, NULL, 'n'},
+    {"mapping", required_argument, NULL, 'm'},
+    {"config", required_argument, NULL, 'c'},
+    {"set", required_argument, NULL, 's'},
     {"help", no_argument, NULL, '?'},
+    {NULL, 0, NULL, 0},
 };
 
 void parse_args(int argc, char** argv){
@@ -109,7 +119,7 @@ void parse_args(int argc, char** argv){
     int options_index=0;
     string suffix;
     parsed_input_para.num = std::numeric_limits<uint32_t>::max();
-    while((opt=getopt_long_only(argc, argv, "q:d:n:x:y:z:l:?", long_options, &options_index)) != -1){
+    while((opt=getopt_long_only(argc, argv, "q:d:n:m:x:y:z:l:c:s:?", long_options, &options_index)) != -1){
         switch (opt)
         {
         case 0:
@@ -140,16 +150,43 @@ void parse_args(int argc, char** argv){
                 parsed_input_para.num = atoi(optarg);
             }
             break;
+        case 'm':
+            parsed_input_para.mapping_file = string(optarg);
+            break;
+        case 'c':
+            parsed_input_para.config_file = string(optarg);
+            break;
+        case 's':
+            parsed_input_para.config_overrides.push_back(string(optarg));
+            break;
         case '?':
             cout<<"------------------ args list ------------------------"<<endl;
             cout<<"--query\tpath of the query graph"<<endl;
             cout<<"--data\tpath of the data graph"<<endl;
             cout<<"--num\tnumber of results to be found"<<endl;
+            cout<<"--mapping\tvertex mapping written by RelabelGraph, printed results use the original ids"<<endl;
+            cout<<"--config\tfile of key=value runtime options"<<endl;
+            cout<<"--set\tkey=value, overrides the config file, repeatable"<<endl;
+            cout<<"\tkeys: ";
+            for(auto& entry : run_config.entries()){
+                cout<<entry.first<<" ";
+            }
+            cout<<endl;
             break;
         default:
             break;
         }
     }
+
+    if(!parsed_input_para.config_file.empty()){
+        run_config.load(parsed_input_para.config_file);
+    }
+    for(auto& assignment : parsed_input_para.config_overrides){
+        if(run_config.set(assignment) == false){
+            cout<<"invalid option '"<<assignment<<"'"<<endl;
+        }
+    }
+    run_config.resolve();
 }
 
 
@@ -220,6 +257,7 @@ void print_input_args(){
 
 int main(int argc, char** argv){
     parse_args(argc, argv);
+    cout<<"config: "<<run_config<<endl;
     Graph* data_graph = new Graph(true);
     
     data_graph->loadGraphFromFile(parsed_input_para.data_file);
@@ -229,8 +267,16 @@ int main(int argc, char** argv){
     getFiles(parsed_input_para.query_path, query_files);
     
     SubgraphEnum subgraph_enum(data_graph);
+    vector<Vertex> original_ids;
+    if(!parsed_input_para.mapping_file.empty()){
+        if(Graph::loadVertexMapping(parsed_input_para.mapping_file, original_ids) == false || original_ids.size() != data_graph->getVerticesCount()){
+            cout<<"invalid vertex mapping "<<parsed_input_para.mapping_file<<endl;
+            return -1;
+        }
+        subgraph_enum.original_ids_ = &original_ids;
+    }
 #if ENABLE_PRE_FILTERING==1 || GNN_PRUNING_MARGIN==1
-    if(parsed_input_para.index_path[parsed_input_para.index_path.size()-1] == '/'){
+    if(!parsed_input_para.index_path.empty() && parsed_input_para.index_path[parsed_input_para.index_path.size()-1] == '/'){
         parsed_input_para.index_path = parsed_input_para.index_path.substr(0, parsed_input_para.index_path.size()-1);
     }
     parsed_input_para.VC_path = parsed_input_para.index_path+string("/cycle_in_vertex.index");
@@ -240,6 +286,40 @@ int main(int argc, char** argv){
 #endif
 
 #if ENABLE_PRE_FILTERING==1
+    // the query embeddings are computed against the feature lists of the index
+    vector<vector<Label>> vc_features, vp_features, ec_features, ep_features;
+    if(run_config.pre_filtering_){
+        vc_features = load_label_path(parsed_input_para.VC_path.substr(0, parsed_input_para.VC_path.size()-5)+string("features"));
+        vp_features = load_label_path(parsed_input_para.VP_path.substr(0, parsed_input_para.VP_path.size()-5)+string("features"));
+        ec_features = load_label_path(parsed_input_para.EC_path.substr(0, parsed_input_para.EC_path.size()-5)+string("features"));
+        ep_features = load_label_path(parsed_input_para.EP_path.substr(0, parsed_input_para.EP_path.size()-5)+string("features"));
+    }
+#if COMPACT == 0
+    Cycle_counter *vc_counter = NULL, *ec_counter = NULL;
+    Path_counter *vp_counter = NULL, *ep_counter = NULL;
+    Index_constructer *vc_con = NULL, *ec_con = NULL, *vp_con = NULL, *ep_con = NULL;
+    if(run_config.pre_filtering_){
+        vc_counter = new Cycle_counter(true, vc_features);
+        ec_counter = new Cycle_counter(true, ec_features);
+        vp_counter = new Path_counter(true, vp_features);
+        ep_counter = new Path_counter(true, ep_features);
+
+        vc_con = new Index_constructer(vc_counter);
+        ec_con = new Index_constructer(ec_counter);
+        vp_con = new Index_constructer(vp_counter);
+        ep_con = new Index_constructer(ep_counter);
+    }
+#else
+    Query_ppc_builder* query_ppc = NULL;
+    query_emb_cache* emb_cache = NULL;
+    if(run_config.pre_filtering_){
+        query_ppc = new Query_ppc_builder(true, vc_features, vp_features, ec_features, ep_features);
+        if(run_config.query_emb_cache_){
+            emb_cache = new query_emb_cache(run_config.query_emb_cache_capacity_);
+        }
+    }
+#endif
+
 #if COMPACT == 0
     // loading data index
     Index_manager vc_manager(parsed_input_para.VC_path);
@@ -262,43 +342,55 @@ int main(int argc, char** argv){
     delete ec_d, ep_d;
     cout<<"done loading tensors"<<endl;
 #else
-    Index_manager vc_manager(parsed_input_para.VC_path);
-    Index_manager ec_manager(parsed_input_para.EC_path);
-    Index_manager vp_manager(parsed_input_para.VP_path);
-    Index_manager ep_manager(parsed_input_para.EP_path);
-    cout<<"start loading vertex tensors"<<endl;
-    CompactTensor* vc_d = vc_manager.load_graph_compact_tensor(0);
-    CompactTensor* vp_d = vp_manager.load_graph_compact_tensor(0);
-    cout<<"start merging vertex tensors"<<endl;
-    data_vertex_emb_comp = merge_bi_CompactTensors(vc_d, vp_d);
-    // data_vertex_emb = merge_multi_Tensors(vd);
-    delete vc_d, vp_d;
-    cout<<"start loading edge tensors"<<endl;
-    CompactTensor* ec_d = ec_manager.load_graph_compact_tensor(0);
-    CompactTensor* ep_d = ep_manager.load_graph_compact_tensor(0);
-    cout<<"start merging edge tensors"<<endl;
-    data_edge_emb_comp = merge_bi_CompactTensors(ec_d, ep_d);
-    delete ec_d, ep_d;
-    cout<<"done loading tensors"<<endl;
+    if(run_config.pre_filtering_){
+        // the vertex.index and edge.index written by run_build_index --merged 1 replace the merging of
+        // the four indices, as long as they are merged from the indices on disk and have the columns of
+        // the features the queries are counted with
+        bool vertex_merged = load_merged_manifest(parsed_input_para.index_path, "vertex.index", "cycle_in_vertex.index", "path_in_vertex.index",
+            query_ppc->column_count(0), query_ppc->column_count(1));
+        bool edge_merged = load_merged_manifest(parsed_input_para.index_path, "edge.index", "cycle_in_edge.index", "path_in_edge.index",
+            query_ppc->column_count(2), query_ppc->column_count(3));
+        cout<<"start loading vertex tensors"<<endl;
+        if(vertex_merged){
+            Index_manager vertex_manager(parsed_input_para.index_path+string("/vertex.index"));
+            data_vertex_emb_comp = vertex_manager.load_graph_compact_tensor(0);
+        }else{
+            Index_manager vc_manager(parsed_input_para.VC_path);
+            Index_manager vp_manager(parsed_input_para.VP_path);
+            CompactTensor* vc_d = vc_manager.load_graph_compact_tensor(0);
+            CompactTensor* vp_d = vp_manager.load_graph_compact_tensor(0);
+            cout<<"start merging vertex tensors"<<endl;
+            data_vertex_emb_comp = merge_bi_CompactTensors(vc_d, vp_d);
+            // data_vertex_emb = merge_multi_Tensors(vd);
+            delete vc_d;
+            delete vp_d;
+        }
+#if COLUMN_FILTER == 1
+        if(run_config.column_filter_){
+            cout<<"start building vertex columns"<<endl;
+            data_vertex_emb_column = new ColumnTensor(data_vertex_emb_comp, data_graph);
+        }
+#endif
+        cout<<"start loading edge tensors"<<endl;
+        if(edge_merged){
+            Index_manager edge_manager(parsed_input_para.index_path+string("/edge.index"));
+            data_edge_emb_comp = edge_manager.load_graph_compact_tensor(0);
+        }else{
+            Index_manager ec_manager(parsed_input_para.EC_path);
+            Index_manager ep_manager(parsed_input_para.EP_path);
+            CompactTensor* ec_d = ec_manager.load_graph_compact_tensor(0);
+            CompactTensor* ep_d = ep_manager.load_graph_compact_tensor(0);
+            cout<<"start merging edge tensors"<<endl;
+            data_edge_emb_comp = merge_bi_CompactTensors(ec_d, ep_d);
+            delete ec_d;
+            delete ep_d;
+        }
+        cout<<"done loading tensors"<<endl;
+    }
     // exit(0);
 #endif
 
 
-    vector<vector<Label>> vc_features = load_label_path(parsed_input_para.VC_path.substr(0, parsed_input_para.VC_path.size()-5)+string("features"));
-    vector<vector<Label>> vp_features = load_label_path(parsed_input_para.VP_path.substr(0, parsed_input_para.VP_path.size()-5)+string("features"));
-    vector<vector<Label>> ec_features = load_label_path(parsed_input_para.EC_path.substr(0, parsed_input_para.EC_path.size()-5)+string("features"));
-    vector<vector<Label>> ep_features = load_label_path(parsed_input_para.EP_path.substr(0, parsed_input_para.EP_path.size()-5)+string("features"));
-
-    Cycle_counter vc_counter = Cycle_counter(true, vc_features);
-    Cycle_counter ec_counter = Cycle_counter(true, ec_features);
-    Path_counter vp_counter = Path_counter(true, vp_features);
-    Path_counter ep_counter = Path_counter(true, ep_features);
-
-    Index_constructer vc_con = Index_constructer(&vc_counter);
-    Index_constructer ec_con = Index_constructer(&ec_counter);
-    Index_constructer vp_con = Index_constructer(&vp_counter);
-    Index_constructer ep_con = Index_constructer(&ep_counter);
-
     Tensor** query_emb_result;
     int query_emb_result_size;
 #endif
@@ -331,6 +423,12 @@ int main(int argc, char** argv){
 
         auto start = std::chrono::high_resolution_clock::now();
 
+        // shared by the embedding cache and the plan cache of subgraph_enum
+        canonical_query canonical;
+        if(run_config.plan_cache_ || (run_config.pre_filtering_ && run_config.query_emb_cache_)){
+            canonical = canonical_query(query_graph);
+        }
+
 #if GNN_PRUNING_MARGIN > 0
         vector<string> splitstr;
         stringsplit(file, '/', splitstr);
@@ -340,27 +438,29 @@ int main(int argc, char** argv){
 
 #if ENABLE_PRE_FILTERING==1
 #if COMPACT ==0
-        Tensor* vc_q = vc_con.count_features(*query_graph, 1, 0);
-        Tensor* vp_q = vp_con.count_features(*query_graph, 1, 0);
-        Tensor* ec_q = ec_con.count_features(*query_graph, 1, 1);
-        Tensor* ep_q = ep_con.count_features(*query_graph, 1, 1);
+        Tensor* vc_q = vc_con->count_features(*query_graph, 1, 0);
+        Tensor* vp_q = vp_con->count_features(*query_graph, 1, 0);
+        Tensor* ec_q = ec_con->count_features(*query_graph, 1, 1);
+        Tensor* ep_q = ep_con->count_features(*query_graph, 1, 1);
         vector<Tensor*> vq_tmp = {vc_q, vp_q};
         vector<Tensor*> eq_tmp = {ec_q, ep_q};
         query_vertex_emb = merge_multi_Tensors(vq_tmp);
         query_edge_emb = merge_multi_Tensors(eq_tmp);
 #else
-        Tensor* vc_q = vc_con.count_features(*query_graph, 1, 0);
-        Tensor* vp_q = vp_con.count_features(*query_graph, 1, 0);
-        Tensor* ec_q = ec_con.count_features(*query_graph, 1, 1);
-        Tensor* ep_q = ep_con.count_features(*query_graph, 1, 1);
-        query_vertex_emb_comp = merge_bi_CompactTensors(vc_q, vp_q);
-        query_edge_emb_comp = merge_bi_CompactTensors(ec_q, ep_q);
+        if(run_config.pre_filtering_){
+            if(emb_cache == NULL || emb_cache->lookup(query_graph, canonical, query_vertex_emb_comp, query_edge_emb_comp) == false){
+                query_ppc->build(*query_graph, query_vertex_emb_comp, query_edge_emb_comp);
+                if(emb_cache != NULL){
+                    emb_cache->insert(query_graph, canonical, query_vertex_emb_comp, query_edge_emb_comp);
+                }
+            }
+        }
 #endif
 #endif
         
         auto end = std::chrono::high_resolution_clock::now();
         float query_preocessing_time = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
-#if ENABLE_PRE_FILTERING==1
+#if ENABLE_PRE_FILTERING==1 && COMPACT == 0
         delete vc_q, vp_q, ec_q, ep_q;
 #endif
         // if(file_id<=191){
@@ -370,16 +470,21 @@ int main(int argc, char** argv){
         // cout<<file<<endl;
         double enumeration_time, preprocessing_time, ordering_time;
         long long state_count=0;
-        subgraph_enum.match(query_graph, string("nd"), parsed_input_para.num, 300);
+        subgraph_enum.match(query_graph, canonical, string("nd"), parsed_input_para.num, run_config.time_limit_);
         enumeration_time = subgraph_enum.enumeration_time_;
         preprocessing_time = subgraph_enum.preprocessing_time_;
         ordering_time = subgraph_enum.ordering_time_;
         state_count = subgraph_enum.state_count_;
         long result_count = subgraph_enum.emb_count_;
-        cout<<file<<":"<<file_id<<": results:"<<result_count<<" query_emb_time:"<<query_preocessing_time<<" query_time:"<<subgraph_enum.query_time_<<" enumeration_time:"<<enumeration_time<<" preprocessing_time:"<<preprocessing_time<<" ordering_time:"<<ordering_time<<" order_adjust_time:"<<subgraph_enum.order_adjust_time_<<" state_count:"<<state_count
-#if PRINT_MEM_INFO == 1
-        <<" peak_memory:"<<subgraph_enum.peak_memory_
-#endif  
+        cout<<file<<":"<<file_id<<": results:"<<result_count<<" query_emb_time:"<<query_preocessing_time<<" query_time:"<<subgraph_enum.query_time_<<" enumeration_time:"<<enumeration_time<<" preprocessing_time:"<<preprocessing_time<<" ordering_time:"<<ordering_time<<" order_adjust_time:"<<subgraph_enum.order_adjust_time_<<" race_time:"<<subgraph_enum.race_time_<<" raced_orders:"<<subgraph_enum.raced_orders_<<" state_count:"<<state_count<<" estimated_state_count:"<<subgraph_enum.estimated_states_<<" filters:"<<subgraph_enum.filter_plan_;
+        if(subgraph_enum.plans() != NULL){
+            cout<<" plan_cache:"<<(subgraph_enum.plan_cache_hit_ ? "hit" : "miss");
+        }
+        if(run_config.print_mem_info_){
+            cout<<" peak_memory:"<<subgraph_enum.peak_memory_
+                <<" catalog_memory:"<<subgraph_enum.catalog_memory_;
+        }
+        cout
 #if PRINT_LEAF_STATE == 1
         <<" CONFLICT:"<<subgraph_enum.leaf_states_counter_[CONFLICT]
         <<" EMPTYSET:"<<subgraph_enum.leaf_states_counter_[EMPTYSET]
@@ -400,6 +505,18 @@ int main(int argc, char** argv){
         // delete query_edge_emb;
         delete query_vertex_emb_comp;
         delete query_edge_emb_comp;
+        query_vertex_emb_comp = NULL;
+        query_edge_emb_comp = NULL;
+    }
+#if ENABLE_PRE_FILTERING==1 && COMPACT == 1
+    if(emb_cache != NULL){
+        cout<<"query_emb_cache_hits:"<<emb_cache->hits_<<" query_emb_cache_misses:"<<emb_cache->misses_<<" query_emb_cache_size:"<<emb_cache->size()<<endl;
+    }
+    delete emb_cache;
+    delete query_ppc;
+#endif
+    if(subgraph_enum.plans() != NULL){
+        cout<<"plan_cache_hits:"<<subgraph_enum.plans()->hits_<<" plan_cache_misses:"<<subgraph_enum.plans()->misses_<<" plan_cache_size:"<<subgraph_enum.plans()->size()<<endl;
     }
 
     
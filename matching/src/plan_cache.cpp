@@ -0,0 +1,54 @@
+#include "plan_cache.h"
+
+plan_cache::plan_cache(uint32_t capacity) {
+    capacity_ = capacity;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+bool plan_cache::lookup(const Graph *query_graph, const canonical_query &query, long result_limit, plan &result) {
+    auto range = index_.equal_range(std::to_string(result_limit) + '|' + query.key_);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        std::vector<uint32_t> mapping;
+        if (!iter->second->query_.find_isomorphism(query_graph, query.colors_, mapping))
+            continue;
+
+        entries_.splice(entries_.begin(), entries_, iter->second);
+        const plan &cached = iter->second->plan_;
+        result = cached;
+        for (auto &order : result.vertex_orders_) {
+            for (auto &u : order) {
+                u = mapping[u];
+            }
+        }
+        hits_ += 1;
+        return true;
+    }
+    misses_ += 1;
+    return false;
+}
+
+void plan_cache::insert(const canonical_query &query, long result_limit, const plan &value) {
+    if (capacity_ == 0)
+        return;
+    if (entries_.size() >= capacity_)
+        evict();
+
+    entries_.emplace_front();
+    entry &e = entries_.front();
+    e.query_ = query;
+    e.key_ = std::to_string(result_limit) + '|' + e.query_.key_;
+    e.plan_ = value;
+    index_.emplace(e.key_, entries_.begin());
+}
+
+void plan_cache::evict() {
+    auto range = index_.equal_range(entries_.back().key_);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        if (iter->second == std::prev(entries_.end())) {
+            index_.erase(iter);
+            break;
+        }
+    }
+    entries_.pop_back();
+}
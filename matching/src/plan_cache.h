@@ -0,0 +1,49 @@
+#pragma once
+#include "../graph/graph.h"
+#include "../configuration/config.h"
+#include "canonical_query.h"
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * Vertex orders of previously planned queries, keyed by the structure of the labeled query graph
+ * (see canonical_query). A lookup searches a label-preserving isomorphism to the cached query and
+ * maps the cached orders through it. Queries whose key collides without being isomorphic, or whose
+ * isomorphism search exceeds its step budget, count as misses.
+ */
+class plan_cache {
+public:
+    struct plan {
+        std::vector<std::vector<uint32_t>> vertex_orders_;
+        std::vector<double> estimated_states_;
+        std::vector<double> estimated_embeddings_;
+    };
+
+    uint64_t hits_;
+    uint64_t misses_;
+
+    explicit plan_cache(uint32_t capacity);
+
+    // query is the canonical form of query_graph. On a hit, result holds the cached plan in the vertex
+    // ids of query_graph; plans are ranked for a result limit, so they are only shared between
+    // queries with the same one
+    bool lookup(const Graph *query_graph, const canonical_query &query, long result_limit, plan &result);
+    void insert(const canonical_query &query, long result_limit, const plan &value);
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct entry {
+        std::string key_; // canonical key prefixed by the result limit
+        canonical_query query_;
+        plan plan_;
+    };
+
+    uint32_t capacity_;
+    std::list<entry> entries_; // most recently used first
+    std::unordered_multimap<std::string, std::list<entry>::iterator> index_;
+
+    void evict();
+};
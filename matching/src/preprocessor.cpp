@@ -5,24 +5,13 @@
 #include "../utility/primitive/semi_join.h"
 #include "../utility/primitive/projection.h"
 #include "../utility/utils.h"
+#include "../utility/run_config.h"
 
 void
 preprocessor::execute(Graph *query_graph, Graph *data_graph, catalog *storage, bool enable_elimination) {
     initialize(query_graph, data_graph);
     scan_relation(storage);
 
-    filter_time_ = 0;
-#ifndef HOMOMORPHISM
-    auto filter = new nlf_filter(query_graph, data_graph);
-    auto start = std::chrono::high_resolution_clock::now();
-    /**
-     * NLF filter.
-     */
-    filter->execute(storage);
-    auto end = std::chrono::high_resolution_clock::now();
-    filter_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-#endif
-
     /**
      * -------------------------------------------------------
      * Collect statistics. The elapsed time is not counted.
@@ -40,6 +29,21 @@ preprocessor::execute(Graph *query_graph, Graph *data_graph, catalog *storage, b
      * -------------------------------------------------------
      */
 
+    filter_time_ = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    plan_filters(storage);
+#ifndef HOMOMORPHISM
+    /**
+     * NLF filter.
+     */
+    if (filter_plan_.nlf_) {
+        filter_->set_query_graph(query_graph);
+        filter_->execute(storage);
+    }
+#endif
+    auto end = std::chrono::high_resolution_clock::now();
+    filter_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
     if (enable_elimination) {
         generate_preprocess_plan();
         eliminate_dangling_tuples(storage);
@@ -75,17 +79,19 @@ preprocessor::execute(Graph *query_graph, Graph *data_graph, catalog *storage, b
 }
 
 void preprocessor::initialize(Graph *query_graph, Graph *data_graph) {
+    if (data_graph != data_graph_) {
+        reserve(data_graph);
+    }
+
     query_graph_ = query_graph;
-    data_graph_ = data_graph;
     vertices_count_ = query_graph_->getVerticesCount();
     non_core_vertices_count_ = vertices_count_ - query_graph_->get2CoreSize();
-    degeneracy_ordering_ = new uint32_t[vertices_count_];
-    vertices_index_ = new uint32_t[vertices_count_];
-
-    if (non_core_vertices_count_ != 0) {
-        non_core_vertices_parent_ = new uint32_t[non_core_vertices_count_];
-        non_core_vertices_children_ = new uint32_t[non_core_vertices_count_];
-        non_core_vertices_children_offset_ = new uint32_t[non_core_vertices_count_ + 1];
+    if (degeneracy_ordering_ == nullptr) {
+        degeneracy_ordering_ = new uint32_t[MAX_QUERY_SIZE];
+        vertices_index_ = new uint32_t[MAX_QUERY_SIZE];
+        non_core_vertices_parent_ = new uint32_t[MAX_QUERY_SIZE];
+        non_core_vertices_children_ = new uint32_t[MAX_QUERY_SIZE];
+        non_core_vertices_children_offset_ = new uint32_t[MAX_QUERY_SIZE + 1];
     }
     preprocess_time_ = 0;
     scan_time_ = 0;
@@ -97,8 +103,42 @@ void preprocessor::initialize(Graph *query_graph, Graph *data_graph) {
 
 }
 
+void preprocessor::reserve(Graph *data_graph) {
+    release();
+    data_graph_ = data_graph;
+    scan_operator_ = new scan(data_graph_);
+    semi_join_operator_ = new semi_join(data_graph_->getVerticesCount());
+    filter_ = new nlf_filter(nullptr, data_graph_);
+
+    multi_join_index1 = new bool [data_graph_->getVerticesCount()];
+    multi_join_index2 = new bool [data_graph_->getVerticesCount()];
+    if(run_config.column_filter_){
+        column_filter_index_ = new bool [data_graph_->getVerticesCount()];
+        memset(column_filter_index_, 0, sizeof(bool) * data_graph_->getVerticesCount());
+    }
+    if(run_config.filter_cost_model_){
+        build_statistics();
+    }
+}
+
+void preprocessor::release() {
+    delete scan_operator_;
+    delete semi_join_operator_;
+    delete filter_;
+    delete[] multi_join_index1;
+    delete[] multi_join_index2;
+    delete[] column_filter_index_;
+    scan_operator_ = nullptr;
+    semi_join_operator_ = nullptr;
+    filter_ = nullptr;
+    multi_join_index1 = nullptr;
+    multi_join_index2 = nullptr;
+    column_filter_index_ = nullptr;
+}
+
 void preprocessor::scan_relation(catalog *storage) {
-    auto scan_operator = new scan(data_graph_);
+    auto scan_operator = scan_operator_;
+    scan_operator->set_arena(storage->get_arena());
 
     auto start = std::chrono::high_resolution_clock::now();
     for (uint32_t u = 0; u < vertices_count_; ++u) {
@@ -119,8 +159,6 @@ void preprocessor::scan_relation(catalog *storage) {
 
     auto end = std::chrono::high_resolution_clock::now();
     scan_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
-
-    delete scan_operator;
 }
 
 bool debug(edge_relation* relation){
@@ -139,7 +177,7 @@ bool debug(edge_relation* relation){
 }
 
 void preprocessor::eliminate_dangling_tuples(catalog *storage) {
-    auto semi_join_operator = new semi_join(data_graph_->getVerticesCount());
+    auto semi_join_operator = semi_join_operator_;
     auto start = std::chrono::high_resolution_clock::now();
     // Bottom-up semi-join along the degeneracy ordering for the non-core vertices.
     for (uint32_t i = 0; i < non_core_vertices_count_; ++i) {
@@ -168,8 +206,9 @@ void preprocessor::eliminate_dangling_tuples(catalog *storage) {
     bottom_up_non_core_semi_join_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
 
     start = std::chrono::high_resolution_clock::now();
-    multi_join_index1 = new bool [data_graph_->getVerticesCount()];
-    multi_join_index2 = new bool [data_graph_->getVerticesCount()];
+    if (filter_plan_.ppc_edge_ && filter_plan_.edge_first_) {
+        validate_edges(storage);
+    }
 
     int k=0;
     while(true){
@@ -195,7 +234,7 @@ void preprocessor::eliminate_dangling_tuples(catalog *storage) {
                 relation_keys.push_back(lkp);
             }
             uint32_t previous_candidate_count = storage->num_candidates_[u];
-            storage->num_candidates_[u] = multi_semi_join(edge_relations, relation_keys, (k==0), u);
+            storage->num_candidates_[u] = multi_semi_join(edge_relations, relation_keys, (k==0) && filter_plan_.ppc_vertex_, u);
             if(previous_candidate_count != storage->num_candidates_[u]){
                 stable = false;
             }
@@ -203,56 +242,8 @@ void preprocessor::eliminate_dangling_tuples(catalog *storage) {
         if(stable == true){
             break;
         }
-        if(k==0){
-#if ENABLE_PRE_FILTERING == 1
-#if COMPACT == 0
-            Value **query_edge_content = query_edge_emb->content;
-            Value **data_edge_content = data_edge_emb->content;
-            int val_dim = data_edge_emb->column_size;
-#else
-            Value **query_edge_content = query_edge_emb_comp->content;
-            Value **data_edge_content = data_edge_emb_comp->content;
-            int val_dim = data_edge_emb_comp->column_size;
-#endif
-            // Value **query_edge_content = query_edge_emb->content;
-            // Value **data_edge_content = data_edge_emb->content;
-
-            for (uint32_t u = 0; u < query_graph_->getVerticesCount(); ++u) {
-                uint32_t u_nbrs_cnt;
-                const uint32_t* u_nbrs = query_graph_->getVertexNeighbors(u, u_nbrs_cnt);
-                for(int i=0;i<u_nbrs_cnt;++i){
-                    uint32_t u_n = u_nbrs[i];
-                    if(u<u_n){
-                        edge_relation* relation = &storage->edge_relations_[u][u_n];
-                        Vertex q_e_id = query_graph_->edge_id_map[u][u_n];
-
-                        uint32_t valid_edge_count = 0;
-                        for(uint j=0;j<relation->size_;++j){
-                            uint32_t v0 = relation->edges_[j].vertices_[0];
-                            uint32_t v1 = relation->edges_[j].vertices_[1];
-                            Vertex d_e_id;
-                            if(v0 < v1){
-                                d_e_id = data_graph_->edge_id_map[v0][v1];
-                            }else{
-                                d_e_id = data_graph_->edge_id_map[v1][v0];
-                            }
-#if COMPACT == 0
-                            if(vec_validation(query_edge_content[q_e_id], data_edge_content[d_e_id], val_dim) == true){
-                                relation->edges_[valid_edge_count] = relation->edges_[j];
-                                valid_edge_count ++;
-                            }
-#else
-                            if(compact_vec_validation(query_edge_content[q_e_id], data_edge_content[d_e_id]) == true){
-                                relation->edges_[valid_edge_count] = relation->edges_[j];
-                                valid_edge_count ++;
-                            }
-#endif
-                        }
-                        relation->size_ = valid_edge_count;
-                    }
-                }
-            }
-#endif
+        if(k==0 && filter_plan_.ppc_edge_ && !filter_plan_.edge_first_){
+            validate_edges(storage);
         }
         k++;
     }
@@ -312,7 +303,6 @@ void preprocessor::eliminate_dangling_tuples(catalog *storage) {
 
     semi_join_time_ = bottom_up_non_core_semi_join_time_ + bottom_up_core_semi_join_time_ + top_down_non_core_semi_join_time_
             + top_down_core_semi_join_time_;
-    delete semi_join_operator;
 }
 
 
@@ -361,26 +351,35 @@ uint32_t preprocessor::multi_semi_join(vector<edge_relation*>& relations, vector
         uint32_t left_key = keys[relation_id];
 
 #if ENABLE_PRE_FILTERING == 1 || GNN_PRUNING_MARGIN > 0
+        if(relation_id == relations.size() - 1 && check_index == true){
+            // the embeddings are only loaded if the PPC filter is switched on
 #if ENABLE_PRE_FILTERING == 1
 #if COMPACT == 0
-        Value **query_vertex_content = query_vertex_emb->content;
-        Value **data_vertex_content = data_vertex_emb->content;
-        int val_dim = query_vertex_emb->column_size;
+            Value **query_vertex_content = query_vertex_emb->content;
+            Value **data_vertex_content = data_vertex_emb->content;
+            int val_dim = query_vertex_emb->column_size;
 #else
-        Value **query_vertex_content = query_vertex_emb_comp->content;
-        Value **data_vertex_content = data_vertex_emb_comp->content;
-        int val_dim = query_vertex_emb_comp->column_size;
+            Value **query_vertex_content = query_vertex_emb_comp->content;
+            Value **data_vertex_content = data_vertex_emb_comp->content;
+            int val_dim = query_vertex_emb_comp->column_size;
 #endif
 #endif
 
 #if GNN_PRUNING_MARGIN > 0
-    int val_dim = query_gnn_emb.first[1];
-    float* query_emb = &(query_gnn_emb.second[0]);
-    float* data_emb = &(data_gnn_emb.second[0]);
+            int val_dim = query_gnn_emb.first[1];
+            float* query_emb = &(query_gnn_emb.second[0]);
+            float* data_emb = &(data_gnn_emb.second[0]);
+#endif
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1 && COLUMN_FILTER == 1
+            // one scan over the columns of join_u's features instead of a row check per candidate
+            bool column_filtered = run_config.column_filter_ && data_vertex_emb_column->scan_candidates(query_vertex_content[join_u],
+                    query_graph_->getVertexLabel(join_u), column_filter_candidates_);
+            if(column_filtered){
+                for(auto v : column_filter_candidates_){
+                    column_filter_index_[v] = true;
+                }
+            }
 #endif
-
-
-        if(relation_id == relations.size() - 1 && check_index == true){
             for(uint32_t i=0; i<left_relation->size_; ++i){
                 uint32_t k = left_relation->edges_[i].vertices_[left_key];
                 if(multi_join_index1[k]){
@@ -389,6 +388,11 @@ uint32_t preprocessor::multi_semi_join(vector<edge_relation*>& relations, vector
                     if(vec_validation(query_vertex_content[join_u], data_vertex_content[k], val_dim) == false){
                         multi_join_index1[k] = false;
                     }
+#elif COLUMN_FILTER == 1
+                    if(column_filtered ? column_filter_index_[k] == false
+                                       : compact_vec_validation(query_vertex_content[join_u], data_vertex_content[k]) == false){
+                        multi_join_index1[k] = false;
+                    }
 #else
                     if(compact_vec_validation(query_vertex_content[join_u], data_vertex_content[k]) == false){
                         multi_join_index1[k] = false;
@@ -410,6 +414,13 @@ uint32_t preprocessor::multi_semi_join(vector<edge_relation*>& relations, vector
                     }
                 }
             }
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1 && COLUMN_FILTER == 1
+            if(column_filtered){
+                for(auto v : column_filter_candidates_){
+                    column_filter_index_[v] = false;
+                }
+            }
+#endif
         }else{
             for(uint32_t i=0; i<left_relation->size_; ++i){
                 uint32_t k = left_relation->edges_[i].vertices_[left_key];
@@ -555,3 +566,188 @@ void preprocessor::print_metrics() {
     printf("Top-down semi-join time on non-core relations (seconds): %.6f\n", NANOSECTOSEC(top_down_non_core_semi_join_time_));
     printf("Top-down semi-join time on core relations (seconds): %.6f\n", NANOSECTOSEC(top_down_core_semi_join_time_));
 }
+
+void preprocessor::validate_edges(catalog *storage) {
+#if ENABLE_PRE_FILTERING == 1
+#if COMPACT == 0
+    Value **query_edge_content = query_edge_emb->content;
+    Value **data_edge_content = data_edge_emb->content;
+    int val_dim = data_edge_emb->column_size;
+#else
+    Value **query_edge_content = query_edge_emb_comp->content;
+    Value **data_edge_content = data_edge_emb_comp->content;
+    int val_dim = data_edge_emb_comp->column_size;
+#endif
+    // Value **query_edge_content = query_edge_emb->content;
+    // Value **data_edge_content = data_edge_emb->content;
+
+    for (uint32_t u = 0; u < query_graph_->getVerticesCount(); ++u) {
+        uint32_t u_nbrs_cnt;
+        const uint32_t* u_nbrs = query_graph_->getVertexNeighbors(u, u_nbrs_cnt);
+        for(int i=0;i<u_nbrs_cnt;++i){
+            uint32_t u_n = u_nbrs[i];
+            if(u<u_n){
+                edge_relation* relation = &storage->edge_relations_[u][u_n];
+                Vertex q_e_id = query_graph_->edge_id_map[u][u_n];
+
+                uint32_t valid_edge_count = 0;
+                for(uint j=0;j<relation->size_;++j){
+                    uint32_t v0 = relation->edges_[j].vertices_[0];
+                    uint32_t v1 = relation->edges_[j].vertices_[1];
+                    Vertex d_e_id;
+                    if(v0 < v1){
+                        d_e_id = data_graph_->edge_id_map[v0][v1];
+                    }else{
+                        d_e_id = data_graph_->edge_id_map[v1][v0];
+                    }
+#if COMPACT == 0
+                    if(vec_validation(query_edge_content[q_e_id], data_edge_content[d_e_id], val_dim) == true){
+                        relation->edges_[valid_edge_count] = relation->edges_[j];
+                        valid_edge_count ++;
+                    }
+#else
+                    if(compact_vec_validation(query_edge_content[q_e_id], data_edge_content[d_e_id]) == true){
+                        relation->edges_[valid_edge_count] = relation->edges_[j];
+                        valid_edge_count ++;
+                    }
+#endif
+                }
+                relation->size_ = valid_edge_count;
+            }
+        }
+    }
+#endif
+
+}
+
+// fraction of the sorted values that are at least `value`
+template<typename T>
+static double fraction_at_least(const std::vector<T>& sorted_values, T value) {
+    if (sorted_values.empty())
+        return 1.0;
+    auto iter = std::lower_bound(sorted_values.begin(), sorted_values.end(), value);
+    return (double)(sorted_values.end() - iter) / sorted_values.size();
+}
+
+void preprocessor::build_statistics() {
+    uint32_t labels_count = data_graph_->getLabelsCount();
+    label_degrees_.assign(labels_count, std::vector<uint32_t>());
+    label_vertex_density_.assign(labels_count, std::vector<Value>());
+    edge_density_.clear();
+    average_edge_density_ = 0;
+
+    for (uint32_t v = 0; v < data_graph_->getVerticesCount(); ++v) {
+        Label l = data_graph_->getVertexLabel(v);
+        label_degrees_[l].push_back(data_graph_->getVertexDegree(v));
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1
+        if(run_config.pre_filtering_){
+            label_vertex_density_[l].push_back(data_vertex_emb_comp->content[v][0]);
+        }
+#endif
+    }
+    for (uint32_t l = 0; l < labels_count; ++l) {
+        std::sort(label_degrees_[l].begin(), label_degrees_[l].end());
+        std::sort(label_vertex_density_[l].begin(), label_vertex_density_[l].end());
+    }
+
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1
+    for (int e = 0; run_config.pre_filtering_ && e < data_edge_emb_comp->row_size; ++e) {
+        edge_density_.push_back(data_edge_emb_comp->content[e][0]);
+        average_edge_density_ += data_edge_emb_comp->content[e][0];
+    }
+    if (!edge_density_.empty())
+        average_edge_density_ /= edge_density_.size();
+    std::sort(edge_density_.begin(), edge_density_.end());
+#endif
+}
+
+/**
+ * Selectivities are upper bounds on the surviving fraction: a data vertex passes NLF only if its
+ * degree is at least deg(u), and it dominates a PPC row only if it has at least as many non-zero
+ * features. A filter runs if the downstream work on the tuples it is expected to prune outweighs
+ * its own cost. The edge validation runs before the first semi-join round if it is the more
+ * efficient of the two PPC filters, so that the vertex check sees smaller relations.
+ */
+void preprocessor::plan_filters(catalog *storage) {
+    filter_plan_ = filter_plan();
+    if (run_config.filter_cost_model_) {
+        std::vector<double> incident_tuples(vertices_count_, 0);
+        for (auto& element : storage->catalog_info_) {
+            incident_tuples[element.first.first] += element.second.after_scan_;
+            incident_tuples[element.first.second] += element.second.after_scan_;
+        }
+
+        for (uint32_t u = 0; u < vertices_count_; ++u) {
+            uint32_t u_nbrs_cnt;
+            const uint32_t* u_nbrs = query_graph_->getVertexNeighbors(u, u_nbrs_cnt);
+            // an isolated vertex has no relation to filter
+            if (u_nbrs_cnt == 0)
+                continue;
+            // the NLF filter and the PPC vertex check both work on the relation of the last neighbor
+            uint32_t uu = u_nbrs[u_nbrs_cnt - 1];
+            double relation_size = storage->get_edge_relation_cardinality(u, uu);
+            Label label = query_graph_->getVertexLabel(u);
+            double pruned = incident_tuples[u] * FILTER_DOWNSTREAM_TOUCHES;
+
+            filter_plan_.nlf_cost_ += relation_size * (1 + query_graph_->getVertexNLF(u)->size());
+            filter_plan_.nlf_benefit_ += pruned * (1 - fraction_at_least(label_degrees_[label], query_graph_->getVertexDegree(u)));
+
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1
+            // a vertex of degree one has a single relation and is never checked in multi_semi_join
+            if (run_config.pre_filtering_ && u_nbrs_cnt > 1) {
+                Value* query_row = query_vertex_emb_comp->content[u];
+#if COLUMN_FILTER == 1
+                if (run_config.column_filter_)
+                    filter_plan_.vertex_cost_ += data_vertex_emb_column->scan_cost(query_row, label);
+                else
+#endif
+                    filter_plan_.vertex_cost_ += relation_size * query_row[0];
+                filter_plan_.vertex_benefit_ += pruned * (1 - fraction_at_least(label_vertex_density_[label], query_row[0]));
+            }
+#endif
+        }
+
+#if ENABLE_PRE_FILTERING == 1 && COMPACT == 1
+        if (run_config.pre_filtering_) {
+            for (auto& element : storage->catalog_info_) {
+                uint32_t u = element.first.first;
+                uint32_t v = element.first.second;
+                Value* query_row = query_edge_emb_comp->content[query_graph_->edge_id_map[u][v]];
+                double relation_size = element.second.after_scan_;
+                // one hash probe for the edge id, then a merge of the two rows
+                filter_plan_.edge_cost_ += relation_size * (1 + query_row[0] + average_edge_density_);
+                filter_plan_.edge_benefit_ += relation_size * FILTER_DOWNSTREAM_TOUCHES * (1 - fraction_at_least(edge_density_, query_row[0]));
+            }
+        }
+#endif
+
+        filter_plan_.nlf_ = filter_plan_.nlf_benefit_ > filter_plan_.nlf_cost_;
+        filter_plan_.ppc_vertex_ = filter_plan_.vertex_benefit_ > filter_plan_.vertex_cost_;
+        filter_plan_.ppc_edge_ = filter_plan_.edge_benefit_ > filter_plan_.edge_cost_;
+        filter_plan_.edge_first_ = filter_plan_.ppc_edge_ && filter_plan_.ppc_vertex_ &&
+                filter_plan_.edge_benefit_ * filter_plan_.vertex_cost_ > filter_plan_.vertex_benefit_ * filter_plan_.edge_cost_;
+    }
+    if (!run_config.pre_filtering_) {
+        filter_plan_.ppc_vertex_ = false;
+        filter_plan_.ppc_edge_ = false;
+    }
+}
+
+std::string filter_plan::to_string() const {
+    std::string plan;
+    if (nlf_)
+        plan += "nlf,";
+    if (edge_first_)
+        plan += "edge,vertex";
+    else {
+        if (ppc_vertex_)
+            plan += "vertex,";
+        if (ppc_edge_)
+            plan += "edge,";
+    }
+    if (!plan.empty() && plan.back() == ',')
+        plan.pop_back();
+    if (plan.empty())
+        plan = "none";
+    return plan;
+}
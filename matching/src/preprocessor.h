@@ -7,8 +7,34 @@
 #include "../graph/graph.h"
 #include "../utility/relation/catalog.h"
 
+class scan;
+class semi_join;
+class nlf_filter;
+
+/**
+ * Which filters run for the current query. Costs and benefits are estimated in tuple touches:
+ * cost is the work of the filter itself, benefit the downstream work on the tuples it is
+ * expected to prune.
+ */
+struct filter_plan {
+    bool nlf_;
+    bool ppc_vertex_;
+    bool ppc_edge_;
+    bool edge_first_; // validate the edges before the first semi-join round instead of after it
+
+    double nlf_cost_, nlf_benefit_;
+    double vertex_cost_, vertex_benefit_;
+    double edge_cost_, edge_benefit_;
+
+    filter_plan() : nlf_(true), ppc_vertex_(true), ppc_edge_(true), edge_first_(false),
+                    nlf_cost_(0), nlf_benefit_(0), vertex_cost_(0), vertex_benefit_(0), edge_cost_(0), edge_benefit_(0) {}
+
+    std::string to_string() const;
+};
+
 class preprocessor {
 public:
+    filter_plan filter_plan_;
     double preprocess_time_;
     double filter_time_;
     double scan_time_;
@@ -31,10 +57,33 @@ private:
     Graph* data_graph_;
 
     bool* multi_join_index1, *multi_join_index2;
+    bool* column_filter_index_;
+    vector<Vertex> column_filter_candidates_;
+
+    // operators holding |V(G)|-sized buffers, kept across queries on the same data graph
+    scan* scan_operator_;
+    semi_join* semi_join_operator_;
+    nlf_filter* filter_;
+
+    // per data graph statistics of the cost model, sorted ascending
+    std::vector<std::vector<uint32_t>> label_degrees_;
+    std::vector<std::vector<Value>> label_vertex_density_; // non-zero features per vertex
+    std::vector<Value> edge_density_; // non-zero features per edge
+    double average_edge_density_;
 
 private:
     void initialize(Graph* query_graph, Graph* data_graph);
 
+    void reserve(Graph* data_graph);
+
+    void release();
+
+    void build_statistics();
+
+    void plan_filters(catalog* storage);
+
+    void validate_edges(catalog* storage);
+
     void scan_relation(catalog* storage);
 
     void eliminate_dangling_tuples(catalog *storage);
@@ -48,18 +97,22 @@ private:
     // void debug(catalog *storage);
 
 public:
+    /**
+     * A preprocessor can be reused for any number of queries; the buffers sized by the data graph
+     * and by MAX_QUERY_SIZE are allocated on the first execute and kept until the data graph changes.
+     */
     preprocessor() : vertices_count_(0), non_core_vertices_count_(0), degeneracy_ordering_(nullptr), vertices_index_(nullptr),
-                     non_core_vertices_parent_(nullptr), non_core_vertices_children_(nullptr), non_core_vertices_children_offset_(nullptr) {}
+                     non_core_vertices_parent_(nullptr), non_core_vertices_children_(nullptr), non_core_vertices_children_offset_(nullptr),
+                     query_graph_(nullptr), data_graph_(nullptr),
+                     multi_join_index1(nullptr), multi_join_index2(nullptr), column_filter_index_(nullptr),
+                     scan_operator_(nullptr), semi_join_operator_(nullptr), filter_(nullptr) {}
     ~preprocessor() {
+        release();
         delete[] degeneracy_ordering_;
         delete[] vertices_index_;
         delete[] non_core_vertices_parent_;
         delete[] non_core_vertices_children_;
         delete[] non_core_vertices_children_offset_;
-#if PREPROCESSING == 1
-        delete[] multi_join_index1;
-        delete[] multi_join_index2;
-#endif
     }
 
     void execute(Graph *query_graph, Graph *data_graph, catalog *storage, bool enable_elimination);
@@ -0,0 +1,79 @@
+#include "query_emb_cache.h"
+
+static Value *copy_row(const Value *row) {
+    Value *result = new Value[1 + 2 * row[0]];
+    memcpy(result, row, sizeof(Value) * (1 + 2 * row[0]));
+    return result;
+}
+
+query_emb_cache::query_emb_cache(uint32_t capacity) {
+    capacity_ = capacity;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+bool query_emb_cache::lookup(Graph *query_graph, const canonical_query &query, CompactTensor *&vertex_emb,
+                             CompactTensor *&edge_emb) {
+    auto range = index_.equal_range(query.key_);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        std::vector<uint32_t> mapping;
+        if (!iter->second->query_.find_isomorphism(query_graph, query.colors_, mapping))
+            continue;
+
+        entries_.splice(entries_.begin(), entries_, iter->second);
+        const entry &cached = *iter->second;
+        vertex_emb = new CompactTensor(cached.vertex_rows_.size());
+        for (uint32_t u = 0; u < cached.vertex_rows_.size(); ++u) {
+            vertex_emb->content[mapping[u]] = copy_row(cached.vertex_rows_[u].data());
+        }
+        // the edge rows do not depend on the orientation of the edge
+        query_graph->set_up_edge_id_map();
+        edge_emb = new CompactTensor(cached.edge_rows_.size());
+        for (uint32_t e_id = 0; e_id < cached.edge_rows_.size(); ++e_id) {
+            Vertex v1 = mapping[cached.edge_set_[e_id * 2]];
+            Vertex v2 = mapping[cached.edge_set_[e_id * 2 + 1]];
+            Vertex query_e_id = query_graph->edge_id_map[std::min(v1, v2)][std::max(v1, v2)];
+            edge_emb->content[query_e_id] = copy_row(cached.edge_rows_[e_id].data());
+        }
+        hits_ += 1;
+        return true;
+    }
+    misses_ += 1;
+    return false;
+}
+
+void query_emb_cache::insert(Graph *query_graph, const canonical_query &query, CompactTensor *vertex_emb,
+                             CompactTensor *edge_emb) {
+    if (capacity_ == 0)
+        return;
+    if (entries_.size() >= capacity_)
+        evict();
+
+    entries_.emplace_front();
+    entry &e = entries_.front();
+    e.query_ = query;
+    query_graph->set_up_edge_id_map();
+    e.edge_set_ = query_graph->edge_set;
+    e.vertex_rows_.resize(vertex_emb->row_size);
+    for (int i = 0; i < vertex_emb->row_size; ++i) {
+        Value *row = vertex_emb->content[i];
+        e.vertex_rows_[i].assign(row, row + 1 + 2 * row[0]);
+    }
+    e.edge_rows_.resize(edge_emb->row_size);
+    for (int i = 0; i < edge_emb->row_size; ++i) {
+        Value *row = edge_emb->content[i];
+        e.edge_rows_[i].assign(row, row + 1 + 2 * row[0]);
+    }
+    index_.emplace(e.query_.key_, entries_.begin());
+}
+
+void query_emb_cache::evict() {
+    auto range = index_.equal_range(entries_.back().query_.key_);
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        if (iter->second == std::prev(entries_.end())) {
+            index_.erase(iter);
+            break;
+        }
+    }
+    entries_.pop_back();
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "../graph/graph.h"
+#include "../index/embedding.h"
+#include "canonical_query.h"
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+/**
+ * PPC embeddings of previously seen queries, keyed by the structure of the labeled query graph
+ * (see canonical_query). The embeddings only depend on that structure, so on a hit the cached rows
+ * are mapped through the isomorphism to the vertex and edge ids of the new query.
+ */
+class query_emb_cache {
+public:
+    uint64_t hits_;
+    uint64_t misses_;
+
+    explicit query_emb_cache(uint32_t capacity);
+
+    // query is the canonical form of query_graph. On a hit, vertex_emb and edge_emb are new tensors in
+    // the ids of query_graph, owned by the caller
+    bool lookup(Graph *query_graph, const canonical_query &query, CompactTensor *&vertex_emb, CompactTensor *&edge_emb);
+    // keeps a copy of the rows
+    void insert(Graph *query_graph, const canonical_query &query, CompactTensor *vertex_emb, CompactTensor *edge_emb);
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct entry {
+        canonical_query query_;
+        std::vector<Vertex> edge_set_; // endpoints of every cached edge id
+        std::vector<std::vector<Value>> vertex_rows_;
+        std::vector<std::vector<Value>> edge_rows_;
+    };
+
+    uint32_t capacity_;
+    std::list<entry> entries_; // most recently used first
+    std::unordered_multimap<std::string, std::list<entry>::iterator> index_;
+
+    void evict();
+};
@@ -1,11 +1,14 @@
 #include "query_plan_generator.h"
 #include "../utility/computesetintersection.h"
+#include "../utility/run_config.h"
 #include <cmath>
 #include <bits/stdc++.h>
 
 double query_plan_generator::ordering_time_;
 double query_plan_generator::traversal_time_;
 double query_plan_generator::nd_time_;
+std::vector<double> query_plan_generator::estimated_states_;
+std::vector<double> query_plan_generator::estimated_embeddings_;
 
 
 void query_plan_generator::generate_query_plan_for_test(Graph *query_graph, std::vector<uint32_t> &order) {
@@ -154,7 +157,8 @@ void query_plan_generator::generate_query_plan_for_test(Graph *query_graph, std:
 }
 
 void query_plan_generator::generate_query_plan_with_nd(Graph *query_graph, catalog *storage,
-                                                       std::vector<std::vector<uint32_t>>& vertex_orders) {
+                                                       std::vector<std::vector<uint32_t>>& vertex_orders,
+                                                       double result_limit) {
     std::vector<nd_tree_node> density_tree;
     std::vector<nd_tree_node> k12_tree;
     std::vector<nd_tree_node> k23_tree;
@@ -173,6 +177,7 @@ void query_plan_generator::generate_query_plan_with_nd(Graph *query_graph, catal
 
     std::vector<std::vector<uint32_t>> node_orders;
     traversal_density_tree(query_graph, storage, density_tree, vertex_orders, node_orders);
+    rank_vertex_orders(query_graph, storage, vertex_orders, result_limit);
 
     end = std::chrono::high_resolution_clock::now();
     traversal_time_ = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
@@ -181,7 +186,103 @@ void query_plan_generator::generate_query_plan_with_nd(Graph *query_graph, catal
     // nd_interface::print_nd_tree(2, 3, k23_tree);
     // nd_interface::print_nd_tree(3, 4, k34_tree);
     // print_density_tree(density_tree);
-    print_vertex_orders(query_graph, vertex_orders, node_orders);
+    // print_vertex_orders(query_graph, vertex_orders, node_orders);
+}
+
+/**
+ * Each leaf of the density tree yields an order. With order_by_cost they are ranked by the
+ * estimated number of search states, ties broken by the utility value; otherwise by the utility
+ * value alone (the first maximum wins, as before).
+ */
+void query_plan_generator::rank_vertex_orders(Graph *query_graph, catalog *storage,
+                                              std::vector<std::vector<uint32_t>> &vertex_orders, double result_limit) {
+    // drop repeated orders, keeping the first of each in generation order
+    std::set<std::vector<uint32_t>> seen;
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < vertex_orders.size(); ++i) {
+        if (seen.insert(vertex_orders[i]).second) {
+            if (kept != i)
+                vertex_orders[kept].swap(vertex_orders[i]);
+            kept += 1;
+        }
+    }
+    vertex_orders.resize(kept);
+
+    uint32_t orders_count = vertex_orders.size();
+    std::vector<uint32_t> utility(orders_count);
+    std::vector<double> states(orders_count), embeddings(orders_count);
+    for (uint32_t i = 0; i < orders_count; ++i) {
+        query_plan_correctness_check(query_graph, vertex_orders[i]);
+        std::vector<uint32_t> bn_cnt_list;
+        utility[i] = query_plan_utility_value(query_graph, vertex_orders[i], bn_cnt_list);
+        states[i] = estimate_order_cost(query_graph, storage, vertex_orders[i], result_limit, embeddings[i]);
+    }
+
+    std::vector<uint32_t> rank(orders_count);
+    for (uint32_t i = 0; i < orders_count; ++i) {
+        rank[i] = i;
+    }
+    bool by_cost = run_config.order_by_cost_;
+    std::stable_sort(rank.begin(), rank.end(), [&](uint32_t l, uint32_t r) {
+        if (by_cost && states[l] != states[r])
+            return states[l] < states[r];
+        return utility[l] > utility[r];
+    });
+
+    std::vector<std::vector<uint32_t>> ranked_orders(orders_count);
+    estimated_states_.resize(orders_count);
+    estimated_embeddings_.resize(orders_count);
+    for (uint32_t i = 0; i < orders_count; ++i) {
+        ranked_orders[i].swap(vertex_orders[rank[i]]);
+        estimated_states_[i] = states[rank[i]];
+        estimated_embeddings_[i] = embeddings[rank[i]];
+    }
+    vertex_orders.swap(ranked_orders);
+}
+
+/**
+ * Expected number of search states of an order: the partial embeddings summed over all depths.
+ * The statistics come from the relations left by the preprocessor, so NLF and the PPC filters
+ * are already accounted for. A data edge of R(b, u) connects a given pair of candidates with
+ * probability |R(b, u)| / (|C(b)| |C(u)|); assuming independence, a partial embedding extends to
+ * u by |C(u)| times the product of these over the backward neighbors of u, but never by more than
+ * the smallest average fan-out. If the result limit is hit, only that fraction of the search
+ * space is explored.
+ */
+double query_plan_generator::estimate_order_cost(Graph *query_graph, catalog *storage, std::vector<uint32_t> &vertex_order,
+                                                 double result_limit, double &embeddings) {
+    std::vector<bool> visited(query_graph->getVerticesCount(), false);
+    double partial = 0;
+    double states = 0;
+    for (auto u : vertex_order) {
+        double u_candidates = std::max(storage->num_candidates_[u], 1u);
+        if (states == 0) {
+            partial = u_candidates;
+        } else {
+            uint32_t nbrs_cnt;
+            const uint32_t *nbrs = query_graph->getVertexNeighbors(u, nbrs_cnt);
+            double extension = u_candidates;
+            double min_fan_out = u_candidates;
+            for (uint32_t i = 0; i < nbrs_cnt; ++i) {
+                uint32_t b = nbrs[i];
+                if (!visited[b])
+                    continue;
+                double b_candidates = std::max(storage->num_candidates_[b], 1u);
+                double relation_size = storage->get_edge_relation_cardinality(b, u);
+                extension *= relation_size / (b_candidates * u_candidates);
+                min_fan_out = std::min(min_fan_out, relation_size / b_candidates);
+            }
+            partial *= std::min(extension, min_fan_out);
+        }
+        visited[u] = true;
+        states += partial;
+    }
+
+    embeddings = partial;
+    if (embeddings > result_limit) {
+        states *= result_limit / embeddings;
+    }
+    return states;
 }
 
 void query_plan_generator::construct_density_tree(std::vector<nd_tree_node> &density_tree,
@@ -6,12 +6,16 @@
 #include "../utility/nucleus_decomposition/nd_interface.h"
 #include <vector>
 #include <unordered_set>
+#include <limits>
 
 class query_plan_generator {
 public:
     static double ordering_time_;
     static double nd_time_;
     static double traversal_time_;
+    // per returned vertex order: expected search states and embeddings, see estimate_order_cost
+    static std::vector<double> estimated_states_;
+    static std::vector<double> estimated_embeddings_;
 
 private:
     static void construct_density_tree(std::vector<nd_tree_node>& density_tree, std::vector<nd_tree_node>& k12_tree,
@@ -51,9 +55,16 @@ private:
 
     static void print_density_tree(std::vector<nd_tree_node>& density_tree);
 
+    static void rank_vertex_orders(Graph *query_graph, catalog *storage,
+                                   std::vector<std::vector<uint32_t>> &vertex_orders, double result_limit);
+
     public:
     static void generate_query_plan_for_test(Graph *query_graph, std::vector<uint32_t> &order);
-    static void generate_query_plan_with_nd(Graph *query_graph, catalog *storage, std::vector<std::vector<uint32_t>>& vertex_orders);
+    // vertex_orders is filled with the distinct candidate orders, the preferred one first
+    static void generate_query_plan_with_nd(Graph *query_graph, catalog *storage, std::vector<std::vector<uint32_t>>& vertex_orders,
+                                            double result_limit = std::numeric_limits<double>::infinity());
+    static double estimate_order_cost(Graph *query_graph, catalog *storage, std::vector<uint32_t> &vertex_order,
+                                      double result_limit, double &embeddings);
     static void print_vertex_orders(Graph* query_graph, std::vector<std::vector<uint32_t>>& vertex_orders,
                                     std::vector<std::vector<uint32_t>>& node_orders);
     static void print_metrics();
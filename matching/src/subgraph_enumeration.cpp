@@ -10,7 +10,7 @@ void set_stop_flag_enum(union sigval val){
     timer_delete(id);
 }
 
-void register_timer_enum(bool* stop_flag){
+void register_timer_enum(bool* stop_flag, uint32_t time_limit){
     struct timespec spec;
     struct sigevent ent;
     struct itimerspec value;
@@ -28,14 +28,13 @@ void register_timer_enum(bool* stop_flag){
     timer_create(CLOCK_MONOTONIC, &ent, &id);
 
     /* start a timer */
-    value.it_value.tv_sec = TIME_LIMIT;
+    value.it_value.tv_sec = time_limit;
     value.it_value.tv_nsec = 0;
     value.it_interval.tv_sec = 0;
     value.it_interval.tv_nsec = 0;
     timer_settime(id, 0, &value, NULL);
 }
 
-#if PRINT_MEM_INFO == 1
 inline int GetCurrentPid(){
     return getpid();
 }
@@ -74,15 +73,32 @@ inline float GetMemoryUsage(int pid){
     // cnvert VmRSS from KB to MB
     return vmrss / 1024.0;
 }
-#endif
 
 
 
 SubgraphEnum::SubgraphEnum(Graph* data_graph){
     data_graph_ = data_graph;
 
-    storage_ = NULL;
-    pp_ = NULL;
+    // reused by every match() of this instance
+    storage_ = new catalog(data_graph_);
+    pp_ = new preprocessor();
+    plans_ = NULL;
+    original_ids_ = NULL;
+    encoder_ = NULL;
+    visited_query_depth_ = NULL;
+    candidates_offset_ = NULL;
+    find_matches_ = NULL;
+    search_done_ = true;
+    if(run_config.plan_cache_){
+        plans_ = new plan_cache(run_config.plan_cache_capacity_);
+    }
+}
+
+SubgraphEnum::~SubgraphEnum(){
+    end_search();
+    delete plans_;
+    delete pp_;
+    delete storage_;
 }
 
 void SubgraphEnum::initialization(){
@@ -231,91 +247,257 @@ bool cmp_score(pair<Vertex, float>& p1, pair<Vertex, float>& p2){
     return p1.second > p2.second;
 }
 
-struct CandidateBuffer{
-    Vertex* content;
-    uint32_t content_size;
-    uint32_t buffer_size;
-};
-
-void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_limit, uint32_t time_limit){
+void SubgraphEnum::match(Graph* query_graph, const canonical_query& canonical, string ordering_method, long count_limit, uint32_t time_limit){
     query_graph_ = query_graph;
+    count_limit_ = count_limit;
+    time_limit_ = time_limit;
     // Execute Preprocessor
     query_time_ = 0;
 
-#if PRINT_MEM_INFO == 1
     bool stop_thread = false;
     int current_pid = GetCurrentPid();
-    thread mem_info_thread(thread_get_mem_info, ref(peak_memory_), ref(stop_thread));
-    float starting_memory_cost = GetMemoryUsage(current_pid);
-#endif
+    thread mem_info_thread;
+    float starting_memory_cost = 0;
+    if(run_config.print_mem_info_){
+        mem_info_thread = thread(thread_get_mem_info, ref(peak_memory_), ref(stop_thread));
+        starting_memory_cost = GetMemoryUsage(current_pid);
+    }
 
-    pp_ = new preprocessor();
-    storage_ = new catalog(query_graph_, data_graph_);
+    storage_->reset(query_graph_);
     pp_->execute(query_graph, data_graph_, storage_, true);
     preprocessing_time_ = NANOSECTOSEC(pp_->preprocess_time_);
+    filter_plan_ = pp_->filter_plan_.to_string();
+    if(run_config.print_mem_info_){
+        catalog_memory_ = storage_->memory_cost() / 1024.0 / 1024.0;
+    }
     query_time_ += preprocessing_time_;
 
     // Generate Query Plan
     std::vector<std::vector<uint32_t>> spectrum;
-    query_plan_generator::generate_query_plan_with_nd(query_graph, storage_, spectrum);
-    ordering_time_ = NANOSECTOSEC(query_plan_generator::ordering_time_);
+    plan_cache_hit_ = false;
+    if(plans_ != NULL){
+        auto start = std::chrono::high_resolution_clock::now();
+        plan_cache::plan cached;
+        plan_cache_hit_ = plans_->lookup(query_graph, canonical, count_limit_, cached);
+        auto end = std::chrono::high_resolution_clock::now();
+        if(plan_cache_hit_){
+            // race_orders reads the estimates from the generator
+            spectrum = cached.vertex_orders_;
+            query_plan_generator::estimated_states_ = cached.estimated_states_;
+            query_plan_generator::estimated_embeddings_ = cached.estimated_embeddings_;
+            ordering_time_ = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        }
+    }
+    if(plan_cache_hit_ == false){
+        query_plan_generator::generate_query_plan_with_nd(query_graph, storage_, spectrum, count_limit_);
+        ordering_time_ = NANOSECTOSEC(query_plan_generator::ordering_time_);
+        if(plans_ != NULL){
+            plans_->insert(canonical, count_limit_, {spectrum, query_plan_generator::estimated_states_, query_plan_generator::estimated_embeddings_});
+        }
+    }
+    estimated_states_ = query_plan_generator::estimated_states_[0];
 
-    // Order Adjustment
+    // start timer, the order racing counts against the time limit as well
+    stop_ = false;
+    register_timer_enum(&stop_, time_limit_);
+
+#if PRINT_LEAF_STATE == 1
+    leaf_states_counter_ = vector<uint64_t>(20, 0);
+#endif
+
+    // Order Racing
     auto start = std::chrono::high_resolution_clock::now();
-    order_ = spectrum[0];
+    bool raced = race_orders(spectrum);
+    auto end = std::chrono::high_resolution_clock::now();
+    race_time_ = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    query_time_ += race_time_;
+
+    // Order Adjustment
+    start = std::chrono::high_resolution_clock::now();
+    if(raced == false){
+        set_order(spectrum[0]);
+    }
     // order_ = {22, 27, 25, 5, 23, 29, 21, 24, 26, 28, 31, 30, 3, 4, 17, 1, 11, 12, 15, 7, 2, 10, 16, 6, 8, 13, 14, 19, 18, 20, 9, 0};
-    order_.insert(order_.begin(), 0); // padding
     // cout<<"original_order:";
     // for(auto n : order_){
     //     cout<<n<<", ";
     // }
     cout<<endl;
     // order_adjustment();
-    initialization();
     // for(auto n : order_){
     //     cout<<n<<", ";
     // }
     // cout<<endl;
     // return;
-    auto end = std::chrono::high_resolution_clock::now();
+    end = std::chrono::high_resolution_clock::now();
     order_adjust_time_ = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
     query_time_ += order_adjust_time_;
 
-    // encoding the relations
+    // encoding the relations, the winner of a race keeps its encoder and its position
+    if(raced == false){
+        start = std::chrono::high_resolution_clock::now();
+        // TrieEncoder* encoder = new TrieEncoder(storage_, order_, order_index_, query_graph_, data_graph_, successor_neighbors_in_depth_);
+        begin_search(new TrieEncoder(storage_, order_, order_index_, query_graph_, data_graph_));
+        end = std::chrono::high_resolution_clock::now();
+        query_time_ += NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+
+    // start enumeration
     start = std::chrono::high_resolution_clock::now();
-    // TrieEncoder* encoder = new TrieEncoder(storage_, order_, order_index_, query_graph_, data_graph_, successor_neighbors_in_depth_);
-    TrieEncoder* encoder = new TrieEncoder(storage_, order_, order_index_, query_graph_, data_graph_);
+
+    // one instance per combination, so the per-state loop carries no configuration branches
+    typedef void (SubgraphEnum::*enumerate_kernel)(long long);
+    static const enumerate_kernel kernels[2][2][2] = {
+        {{&SubgraphEnum::enumerate<false, false, HYBRID_INTERSECTION, false>, &SubgraphEnum::enumerate<false, false, MERGE_INTERSECTION, false>},
+         {&SubgraphEnum::enumerate<false, true, HYBRID_INTERSECTION, false>, &SubgraphEnum::enumerate<false, true, MERGE_INTERSECTION, false>}},
+        {{&SubgraphEnum::enumerate<true, false, HYBRID_INTERSECTION, false>, &SubgraphEnum::enumerate<true, false, MERGE_INTERSECTION, false>},
+         {&SubgraphEnum::enumerate<true, true, HYBRID_INTERSECTION, false>, &SubgraphEnum::enumerate<true, true, MERGE_INTERSECTION, false>}},
+    };
+    (this->*kernels[run_config.index_order_][run_config.print_result_][run_config.intersection_])(0);
     end = std::chrono::high_resolution_clock::now();
-    query_time_ += NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    enumeration_time_ = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    query_time_ += enumeration_time_;
 
+    if(stop_ == false){
+        timer_delete(id);
+    }
 
-#if PRINT_LEAF_STATE == 1
-    leaf_states_counter_ = vector<uint64_t>(20, 0);
-#endif
+    if(run_config.print_mem_info_){
+        stop_thread = true;
+        mem_info_thread.join();
+        // sleep(1);
+        float cur_mem = GetMemoryUsage(current_pid);
+        peak_memory_ = (peak_memory_ > cur_mem) ? peak_memory_ : cur_mem;
+        peak_memory_ -= starting_memory_cost;
+    }
 
-    // start enumeration
-    // start timer
-    stop_ = false;
-    register_timer_enum(&stop_);
-    start = std::chrono::high_resolution_clock::now();
+    end_search();
+}
 
-    vector<CandidateBuffer> extending_candidates;
-    vector<CandidateBuffer> extending_candidates_tmp;
-    extending_candidates.resize(query_vertex_count_+1);
-    extending_candidates_tmp.resize(query_vertex_count_+1);
-    uint32_t max_degree = data_graph_->getGraphMaxDegree();
-    for(int i=0;i<query_vertex_count_+1;++i){
-        extending_candidates[i].content = new Vertex [max_degree];
-        extending_candidates[i].buffer_size = max_degree;
-        extending_candidates[i].content_size = 0;
-        extending_candidates_tmp[i].content = new Vertex [max_degree];
-        extending_candidates_tmp[i].buffer_size = max_degree;
-        extending_candidates_tmp[i].content_size = 0;
+void SubgraphEnum::set_order(vector<uint32_t>& order){
+    order_ = order;
+    order_.insert(order_.begin(), 0); // padding
+    initialization();
+}
+
+/**
+ * The ranked orders whose estimates are within race_margin of the best one are raced: their
+ * searches run in turns of RACE_SLICE_STATES states each until one of them finishes, which wins,
+ * or each has spent race_state_budget states. The estimates assume independent relations and are
+ * least reliable on exactly the large searches this is meant for.
+ *
+ * The number of embeddings does not depend on the order, so the states spent per embedding
+ * compare orders whether or not the result limit will be reached. Orders that found no embedding
+ * within the budget rank behind those that did, by the projected size of their search tree.
+ *
+ * The search of the winner stays in place and the enumeration resumes it, the others are
+ * dropped. Returns false, with no search in place, if there was nothing to race. Racing is
+ * skipped when the results are printed since the dropped searches would have printed theirs.
+ */
+bool SubgraphEnum::race_orders(vector<vector<uint32_t>>& spectrum){
+    raced_orders_ = 0;
+    if(run_config.race_orders_ == false || run_config.print_result_){
+        return false;
+    }
+    vector<double>& estimates = query_plan_generator::estimated_states_;
+    uint32_t contenders = 1;
+    while(contenders < spectrum.size() && contenders < run_config.race_top_k_
+          && estimates[contenders] <= estimates[0] * run_config.race_margin_){
+        contenders ++;
+    }
+    if(contenders < 2){
+        return false;
     }
 
+    typedef void (SubgraphEnum::*enumerate_kernel)(long long);
+    static const enumerate_kernel kernels[2][2] = {
+        {&SubgraphEnum::enumerate<false, false, HYBRID_INTERSECTION, true>, &SubgraphEnum::enumerate<false, false, MERGE_INTERSECTION, true>},
+        {&SubgraphEnum::enumerate<true, false, HYBRID_INTERSECTION, true>, &SubgraphEnum::enumerate<true, false, MERGE_INTERSECTION, true>},
+    };
+    enumerate_kernel kernel = kernels[run_config.index_order_][run_config.intersection_];
+
+    vector<search_state> searches(contenders);
+    for(uint32_t i=0; i<contenders; ++i){
+        set_order(spectrum[i]);
+        begin_search(new TrieEncoder(storage_, order_, order_index_, query_graph_, data_graph_));
+        swap_search(searches[i]);
+    }
+    raced_orders_ = contenders;
+
+    int winner = -1;
+    long long budget = run_config.race_state_budget_;
+    for(long long limit = 0; limit < budget && winner < 0; ){
+        limit = min(limit + RACE_SLICE_STATES, budget);
+        for(uint32_t i=0; i<contenders; ++i){
+            swap_search(searches[i]);
+            (this->*kernel)(limit);
+            bool done = search_done_;
+            swap_search(searches[i]);
+            // an order that finishes first cannot be beaten, a search stopped by the time limit
+            // is done as well
+            if(done){
+                winner = i;
+                break;
+            }
+        }
+    }
+    if(winner < 0){
+        bool winner_productive = false;
+        double winner_cost = 0;
+        for(uint32_t i=0; i<contenders; ++i){
+            swap_search(searches[i]);
+            bool productive = emb_count_ > 0;
+            double cost = productive ? (double)state_count_ / emb_count_ : project_states();
+            swap_search(searches[i]);
+            if(i == 0 || productive > winner_productive || (productive == winner_productive && cost < winner_cost)){
+                winner = i;
+                winner_productive = productive;
+                winner_cost = cost;
+            }
+        }
+    }
+    // between the turns no search is in place
+    for(uint32_t i=0; i<contenders; ++i){
+        if((int)i != winner){
+            swap_search(searches[i]);
+            end_search();
+            swap_search(searches[i]);
+        }
+    }
+    swap_search(searches[winner]);
+    return true;
+}
+
+// Knuth-style estimate: the ratio of sampled states at consecutive depths is the branching factor
+double SubgraphEnum::project_states(){
+    double level_states = root_candidates_;
+    double states = 0;
+    for(uint32_t depth=1; depth<=query_vertex_count_; ++depth){
+        states += level_states;
+        if(depth == query_vertex_count_ || depth_states_[depth] == 0){
+            break;
+        }
+        level_states *= (double)depth_states_[depth+1] / depth_states_[depth];
+    }
+    return states;
+}
+
+void SubgraphEnum::begin_search(TrieEncoder* encoder){
+    encoder_ = encoder;
     query_vertex_count_ = query_graph_->getVerticesCount();
     data_vertex_count_ = data_graph_->getVerticesCount();
 
+    uint32_t max_degree = data_graph_->getGraphMaxDegree();
+    extending_candidates_.resize(query_vertex_count_+1);
+    extending_candidates_tmp_.resize(query_vertex_count_+1);
+    for(int i=0;i<query_vertex_count_+1;++i){
+        extending_candidates_[i].content = new Vertex [max_degree];
+        extending_candidates_[i].buffer_size = max_degree;
+        extending_candidates_[i].content_size = 0;
+        extending_candidates_tmp_[i].content = new Vertex [max_degree];
+        extending_candidates_tmp_[i].buffer_size = max_degree;
+        extending_candidates_tmp_[i].content_size = 0;
+    }
 
     searching_candidates_.clear();
     searching_candidates_.resize(query_vertex_count_+1);
@@ -325,13 +507,15 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
     vector<Vertex> init_candidates;
     encoder->get_candidates(1, init_candidates);
     // realloc the initial candidate
-    delete extending_candidates[1].content;
-    delete extending_candidates_tmp[1].content;
-    extending_candidates[1].content = new Vertex [init_candidates.size()+1];
-    extending_candidates_tmp[1].content = new Vertex [init_candidates.size()+1];
+    delete extending_candidates_[1].content;
+    delete extending_candidates_tmp_[1].content;
+    extending_candidates_[1].content = new Vertex [init_candidates.size()+1];
+    extending_candidates_tmp_[1].content = new Vertex [init_candidates.size()+1];
 
-    extending_candidates[1].content_size = init_candidates.size();
-    memcpy(extending_candidates[1].content, &(init_candidates[0]), sizeof(Vertex)*init_candidates.size());
+    extending_candidates_[1].content_size = init_candidates.size();
+    root_candidates_ = init_candidates.size();
+    depth_states_.assign(query_vertex_count_+1, 0);
+    memcpy(extending_candidates_[1].content, &(init_candidates[0]), sizeof(Vertex)*init_candidates.size());
 
 
     embedding_depth_.clear();
@@ -342,45 +526,92 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
     memset(visited_query_depth_, 0, sizeof(Vertex)*data_vertex_count_);
     memset(candidates_offset_, 0, sizeof(Vertex)*(query_vertex_count_+1));
 
-    int cur_depth = 1;
-    candidates_offset_[cur_depth] = 0;
+    cur_depth_ = 1;
+    candidates_offset_[cur_depth_] = 0;
     find_matches_ = new bool [query_vertex_count_+1];
     find_matches_[query_vertex_count_] = true;
 
-    vector<float> candidate_score;
+    state_count_ = 0;
+    emb_count_ = 0;
+    search_done_ = false;
+
+    ordered_candidates_.clear();
+    if(run_config.index_order_){
+        ordered_candidates_.resize(order_.size());
+        unordered_map<Vertex, float>& score_map = encoder->scores[1];
+        for(int x=0;x<extending_candidates_[1].content_size;++x){
+            Vertex vc = extending_candidates_[1].content[x];
+            ordered_candidates_[1].push_back({vc, score_map[vc]});
+        }
+        sort(ordered_candidates_[1].begin(), ordered_candidates_[1].end(), cmp_score);
+    }
+}
+
+// releases the buffers and the encoder of the running search, if any
+void SubgraphEnum::end_search(){
+    delete candidates_offset_;
+    delete visited_query_depth_;
+    delete find_matches_;
+    for(int i=0;i<extending_candidates_.size();++i){
+        delete extending_candidates_[i].content;
+        delete extending_candidates_tmp_[i].content;
+    }
+    extending_candidates_.clear();
+    extending_candidates_tmp_.clear();
+    delete encoder_;
+    encoder_ = NULL;
+    candidates_offset_ = NULL;
+    visited_query_depth_ = NULL;
+    find_matches_ = NULL;
+    search_done_ = true;
+}
+
+void SubgraphEnum::swap_search(search_state& search){
+    swap(order_, search.order_);
+    swap(order_index_, search.order_index_);
+    swap(ancestors_depth_, search.ancestors_depth_);
+    swap(successor_neighbors_in_depth_, search.successor_neighbors_in_depth_);
+    swap(predecessor_neighbors_in_depth_, search.predecessor_neighbors_in_depth_);
+    swap(full_descendent_, search.full_descendent_);
+    swap(parent_failing_set_map_, search.parent_failing_set_map_);
+
+    swap(encoder_, search.encoder_);
+    swap(extending_candidates_, search.extending_candidates_);
+    swap(extending_candidates_tmp_, search.extending_candidates_tmp_);
+    swap(ordered_candidates_, search.ordered_candidates_);
+    swap(embedding_depth_, search.embedding_depth_);
+    swap(visited_query_depth_, search.visited_query_depth_);
+    swap(candidates_offset_, search.candidates_offset_);
+    swap(find_matches_, search.find_matches_);
+    swap(cur_depth_, search.cur_depth_);
+    swap(search_done_, search.search_done_);
+
+    swap(emb_count_, search.emb_count_);
+    swap(state_count_, search.state_count_);
+    swap(root_candidates_, search.root_candidates_);
+    swap(depth_states_, search.depth_states_);
+}
+
+template<bool index_order, bool print_result, IntersectionMethod intersection, bool sampling>
+void SubgraphEnum::enumerate(long long state_limit){
+    if(search_done_){
+        return;
+    }
+    TrieEncoder* encoder = encoder_;
+    vector<CandidateBuffer>& extending_candidates = extending_candidates_;
+    vector<CandidateBuffer>& extending_candidates_tmp = extending_candidates_tmp_;
+    vector<vector<pair<Vertex, float>>>& ordered_candidates = ordered_candidates_;
+    int cur_depth = cur_depth_;
+
     Vertex u, v;
     // Vertex conflicted_query_vertex;
     uint32_t conflicted_depth;
-    state_count_ = 0;
-    emb_count_ = 0;
 
     vector<bitset<MAX_QUERY_SIZE>> failing_set_depth;
     failing_set_depth.resize(query_vertex_count_+1);
 
-    // bool debug_print=false;
-    Vertex* intersection_buffer = new Vertex[data_graph_->getGraphMaxDegree()];
-    uint32_t intersection_buffer_size = 0;
-    Vertex* intersection_buffer_tmp = new Vertex[data_graph_->getGraphMaxDegree()];
-    uint32_t intersection_buffer_size_tmp = 0;
-
-#if INDEX_ORDER == 1
-    vector<vector<pair<Vertex, float>>> ordered_candidates;
-    ordered_candidates.resize(order_.size());
-    unordered_map<Vertex, float>& score_map = encoder->scores[1];
-    for(int x=0;x<extending_candidates[1].content_size;++x){
-        Vertex vc = extending_candidates[1].content[x];
-        ordered_candidates[1].push_back({vc, score_map[vc]});
-    }
-    sort(ordered_candidates[1].begin(), ordered_candidates[1].end(), cmp_score);
-#endif
-
     while(true){
-#if INDEX_ORDER==1
-        while(candidates_offset_[cur_depth]<ordered_candidates[cur_depth].size())
-#else
-        while(candidates_offset_[cur_depth]<extending_candidates[cur_depth].content_size)
-#endif
-        {
+        while(candidates_offset_[cur_depth]<(index_order ? ordered_candidates[cur_depth].size() : extending_candidates[cur_depth].content_size)){
             if(stop_==true){
                 for(int i=1;i<=cur_depth;++i){
                     cout<<embedding_depth_[i]<<" ";
@@ -390,44 +621,47 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
             }
             
 
+            if(sampling && state_count_ >= state_limit){
+                // paused, the next call continues with this state
+                cur_depth_ = cur_depth;
+                return;
+            }
+
             Vertex* current_candidates = extending_candidates[cur_depth].content;
             state_count_ ++;
+            if(sampling){
+                depth_states_[cur_depth] ++;
+            }
             find_matches_[cur_depth] = false;
             u = order_[cur_depth];
             uint32_t offset = candidates_offset_[cur_depth];
-#if INDEX_ORDER == 1
-            v = ordered_candidates[cur_depth][offset].first;
-#else
-            v = current_candidates[offset];
-#endif
+            v = index_order ? ordered_candidates[cur_depth][offset].first : current_candidates[offset];
             embedding_depth_[cur_depth] = v;
 
             // cout<<"searching:"<<cur_depth<<":"<<u<<":"<<v<<":"<<candidates_offset_[cur_depth]<<endl;
 
             if(cur_depth == query_vertex_count_){
                 for(int i=0;i<extending_candidates[cur_depth].content_size; ++i){
-#if INDEX_ORDER == 1
-                    v = ordered_candidates[cur_depth][i].first;
-#else
-                    v = current_candidates[i];
-#endif
+                    v = index_order ? ordered_candidates[cur_depth][i].first : current_candidates[i];
                     state_count_ ++;
+                    if(sampling){
+                        depth_states_[cur_depth] ++;
+                    }
                     if(visited_query_depth_[v] == 0){
                         find_matches_[cur_depth-1] = true;
                         find_matches_[cur_depth] = true;
                         emb_count_ ++;
                         embedding_depth_[cur_depth] = v;
 
-#if PRINT_RESULT==1
-                        matches_.push_back(embedding_depth_);
-                        for(Vertex z=1;z<=query_vertex_count_; ++z){
-                            cout<<embedding_depth_[z]<<" ";
+                        if(print_result){
+                            matches_.push_back(embedding_depth_);
+                            for(Vertex z=1;z<=query_vertex_count_; ++z){
+                                cout<<(original_ids_ == NULL ? embedding_depth_[z] : (*original_ids_)[embedding_depth_[z]])<<" ";
+                            }
+                            // cout<<validate_correctness(query_graph_, data_graph_, order_index_, embedding_depth_);
+                            cout<<endl;
                         }
-                        // cout<<validate_correctness(query_graph_, data_graph_, order_index_, embedding_depth_);
-                        cout<<endl;
-                        // exit(0);
-#endif
-                        if(emb_count_ >= count_limit){
+                        if(emb_count_ >= count_limit_){
                             goto EXIT;
                         }
                     }else{
@@ -437,11 +671,7 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
                     
                     // cout<<"conflict:"<<cur_depth<<":"<<v<<":"<<visited_query_depth_[v]<<":"<<state_count_<<endl;
                 }
-#if INDEX_ORDER==1
-                candidates_offset_[cur_depth] = ordered_candidates[cur_depth].size();
-#else
-                candidates_offset_[cur_depth] = extending_candidates[cur_depth].content_size;
-#endif
+                candidates_offset_[cur_depth] = index_order ? ordered_candidates[cur_depth].size() : extending_candidates[cur_depth].content_size;
                 // candidates_offset_[cur_depth] = searching_candidates_[cur_depth].size();
             }else{
                 // normal enumeration
@@ -476,20 +706,20 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
                 for(int x=1;x<predecessor_neighbors_in_depth_[next_depth].size();++x){
                     pred_depth = predecessor_neighbors_in_depth_[next_depth][x];
                     Vertex* cans = encoder->get_edge_candidate(pred_depth, next_depth, embedding_depth_[pred_depth], count);
-                    ComputeSetIntersection::ComputeCandidates(cans, count, extending_candidates[next_depth].content, extending_candidates[next_depth].content_size, extending_candidates_tmp[next_depth].content, extending_candidates_tmp[next_depth].content_size);
+                    ComputeSetIntersection::ComputeCandidates<intersection>(cans, count, extending_candidates[next_depth].content, extending_candidates[next_depth].content_size, extending_candidates_tmp[next_depth].content, extending_candidates_tmp[next_depth].content_size);
                     swap(extending_candidates[next_depth].content, extending_candidates_tmp[next_depth].content);
                     swap(extending_candidates[next_depth].content_size, extending_candidates_tmp[next_depth].content_size);
                 }
-#if INDEX_ORDER == 1
-                unordered_map<Vertex, float>& score_map = encoder->scores[next_depth];
-                vector<pair<Vertex, float>>& current_ordered_candidates = ordered_candidates[next_depth];
-                current_ordered_candidates.clear();
-                for(int x=0;x<extending_candidates[next_depth].content_size;++x){
-                    Vertex vc = extending_candidates[next_depth].content[x];
-                    current_ordered_candidates.push_back({vc, score_map[vc]});
+                if(index_order){
+                    unordered_map<Vertex, float>& score_map = encoder->scores[next_depth];
+                    vector<pair<Vertex, float>>& current_ordered_candidates = ordered_candidates[next_depth];
+                    current_ordered_candidates.clear();
+                    for(int x=0;x<extending_candidates[next_depth].content_size;++x){
+                        Vertex vc = extending_candidates[next_depth].content[x];
+                        current_ordered_candidates.push_back({vc, score_map[vc]});
+                    }
+                    sort(current_ordered_candidates.begin(), current_ordered_candidates.end(), cmp_score);
                 }
-                sort(current_ordered_candidates.begin(), current_ordered_candidates.end(), cmp_score);
-#endif
                 // for(uint32_t x=0;x<predecessor_neighbors_in_depth_[next_depth].size();++x){
                 //     uint32_t pred_depth = predecessor_neighbors_in_depth_[next_depth][x];
                 //     uint32_t count;
@@ -508,12 +738,7 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
                 candidates_offset_[cur_depth] = 0;
             }
         }
-#if INDEX_ORDER==1
-        if(ordered_candidates[cur_depth].size() == 0)
-#else
-        if(extending_candidates[cur_depth].content_size == 0)
-#endif
-
+        // all candidates of this depth are tried, backtrack
         cur_depth --;
         if(cur_depth == 0){
             break;
@@ -524,35 +749,6 @@ void SubgraphEnum::match(Graph* query_graph, string ordering_method, long count_
 
     }
 EXIT:
-    end = std::chrono::high_resolution_clock::now();
-    enumeration_time_ = NANOSECTOSEC(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
-    query_time_ += enumeration_time_;
-
-    if(stop_ == false){
-        timer_delete(id);
-    }
-
-#if PRINT_MEM_INFO == 1
-    stop_thread = true;
-    mem_info_thread.join();
-    // sleep(1);
-    float cur_mem = GetMemoryUsage(current_pid);
-    peak_memory_ = (peak_memory_ > cur_mem) ? peak_memory_ : cur_mem;
-    peak_memory_ -= starting_memory_cost;
-#endif
-
-    delete pp_;
-    delete storage_;
-    delete candidates_offset_;
-    delete visited_query_depth_;
-    delete find_matches_;
-    delete intersection_buffer;
-    delete intersection_buffer_tmp;
-    for(int i=0;i<query_vertex_count_+1;++i){
-        delete extending_candidates[i].content;
-        delete extending_candidates_tmp[i].content;
-    }
-
-    pp_ = NULL;
-    storage_ = NULL;
+    cur_depth_ = cur_depth;
+    search_done_ = true;
 }
@@ -5,9 +5,10 @@
 // #include "encoder.h"
 #include "trie_encoder.h"
 #include "query_plan_generator.h"
+#include "plan_cache.h"
 #include "../utility/utils.h"
+#include "../utility/run_config.h"
 
-#if PRINT_MEM_INFO == 1
 #include <thread>
 #include <sys/stat.h>
 #include <sys/sysinfo.h>
@@ -22,7 +23,43 @@ inline int GetCurrentPid();
 inline float GetMemoryUsage(int pid);
 
 void thread_get_mem_info(float& peak_memory, bool& stop);
-#endif
+
+struct CandidateBuffer{
+    Vertex* content;
+    uint32_t content_size;
+    uint32_t buffer_size;
+};
+
+class TrieEncoder;
+
+// A search over one order, parked while another one runs: the order with the tables
+// SubgraphEnum::initialization derives from it, the encoder, the position of the backtracking
+// loop and the counters. SubgraphEnum::swap_search exchanges it with the running search.
+struct search_state{
+    vector<Vertex> order_;
+    vector<Vertex> order_index_;
+    vector<bitset<MAX_QUERY_SIZE>> ancestors_depth_;
+    vector<vector<uint32_t>> successor_neighbors_in_depth_;
+    vector<vector<uint32_t>> predecessor_neighbors_in_depth_;
+    bitset<MAX_QUERY_SIZE> full_descendent_;
+    vector<vector<bitset<MAX_QUERY_SIZE>>> parent_failing_set_map_;
+
+    TrieEncoder* encoder_ = NULL;
+    vector<CandidateBuffer> extending_candidates_;
+    vector<CandidateBuffer> extending_candidates_tmp_;
+    vector<vector<pair<Vertex, float>>> ordered_candidates_;
+    vector<Vertex> embedding_depth_;
+    Vertex* visited_query_depth_ = NULL;
+    Vertex* candidates_offset_ = NULL;
+    bool* find_matches_ = NULL;
+    int cur_depth_ = 0;
+    bool search_done_ = true;
+
+    long emb_count_ = 0;
+    long long state_count_ = 0;
+    uint64_t root_candidates_ = 0;
+    vector<uint64_t> depth_states_;
+};
 
 enum LeafStateType{
     CONFLICT, EMPTYSET, SUCCESSOR_EQ_CACHE, SUBTREE_REDUCTION, PGHOLE_FILTERING, FAILING_SETS, RESULT
@@ -36,31 +73,58 @@ public:
     vector<Vertex> order_;
     vector<Vertex> order_index_;
 
-    uint32_t time_limit_; // seconds
+    uint32_t time_limit_; // seconds, see RunConfig::time_limit_
 
     // enumeration metrics
     long count_limit_;
     long emb_count_;
     long long state_count_;
+    double estimated_states_; // the plan optimizer's guess for state_count_
     double enumeration_time_;
     double preprocessing_time_;
     double order_adjust_time_;
     double ordering_time_;
     double query_time_;
+    double race_time_;       // racing the candidate orders, part of query_time_
+    uint32_t raced_orders_;  // orders raced by race_orders, 0 if the first ranked order was taken
     float peak_memory_;
+    float catalog_memory_; // MB held by the relations after preprocessing
+    string filter_plan_; // filters chosen by the preprocessor
+    bool plan_cache_hit_;  // the orders of an isomorphic earlier query were reused
 
     vector<uint64_t> leaf_states_counter_;
 
+    // original ids of a relabeled data graph, used when printing the results; NULL if not relabeled
+    const vector<Vertex>* original_ids_;
+
+    // One instance per thread: the catalog, the preprocessor and the plan cache are recycled across queries.
     SubgraphEnum(Graph* data_graph);
+    ~SubgraphEnum();
+
+    // canonical is the canonical form of query_graph, only read when the plan cache is on
+    void match(Graph* query_graph, const canonical_query& canonical, string ordering_method, long count_limit, uint32_t time_limit);
 
-    void match(Graph* query_graph, string ordering_method, long count_limit, uint32_t time_limit);
+    const plan_cache* plans() const { return plans_; }
 
 private:
     catalog* storage_;
     preprocessor* pp_;
+    plan_cache* plans_; // NULL if the plan cache is switched off
     uint32_t query_vertex_count_, data_vertex_count_;
 
     bool stop_;
+
+    // the running search, see search_state; the enumeration resumes from here
+    TrieEncoder* encoder_;
+    vector<CandidateBuffer> extending_candidates_;
+    vector<CandidateBuffer> extending_candidates_tmp_;
+    vector<vector<pair<Vertex, float>>> ordered_candidates_;
+    int cur_depth_;
+    bool search_done_;
+
+    // statistics of a sampling run, indexed by depth
+    uint64_t root_candidates_;
+    vector<uint64_t> depth_states_;
     
     vector<bitset<MAX_QUERY_SIZE>> ancestors_depth_;
     vector<vector<uint32_t>> successor_neighbors_in_depth_;
@@ -94,4 +158,19 @@ private:
     void initialization();
 
     void order_adjustment();
+
+    // positions a search over order_ before its first state; the search owns the encoder
+    void begin_search(TrieEncoder* encoder);
+    void end_search();
+    void swap_search(search_state& search);
+
+    // the search loop, instantiated per runtime switch (see RunConfig); resumes the running search
+    // and runs it to the end, or with sampling until state_count_ reaches state_limit, recording
+    // the states per depth
+    template<bool index_order, bool print_result, IntersectionMethod intersection, bool sampling>
+    void enumerate(long long state_limit);
+
+    bool race_orders(vector<vector<uint32_t>>& spectrum);
+    double project_states();
+    void set_order(vector<uint32_t>& order);
 };
\ No newline at end of file
@@ -65,6 +65,16 @@ TrieRelation::TrieRelation(catalog* storage, Vertex src, Vertex dst){
             return l.vertices_[1] < r.vertices_[1];
         });
         swap(src_idx, dst_idx);
+    }else{
+        // an earlier encoder (e.g. of a raced order) may have sorted the relation by dst
+        auto by_src = [](const edge& l, const edge& r) -> bool {
+            if (l.vertices_[0] == r.vertices_[0])
+                return l.vertices_[1] < r.vertices_[1];
+            return l.vertices_[0] < r.vertices_[0];
+        };
+        if(!std::is_sorted(edges, edges + edge_size, by_src)){
+            std::sort(edges, edges + edge_size, by_src);
+        }
     }
 
     // start encoding
@@ -195,31 +205,31 @@ TrieEncoder::TrieEncoder(catalog* storage, vector<Vertex>& order, vector<Vertex>
             }
         }
     }
-#if INDEX_ORDER == 1
+    if(run_config.index_order_){
 #if COMPACT == 0
-    Value **query_vertex_content = query_vertex_emb->content;
-    Value **data_vertex_content = data_vertex_emb->content;
-    int val_dim = query_vertex_emb->column_size;
+        Value **query_vertex_content = query_vertex_emb->content;
+        Value **data_vertex_content = data_vertex_emb->content;
+        int val_dim = query_vertex_emb->column_size;
 #else
-    Value **query_vertex_content = query_vertex_emb_comp->content;
-    Value **data_vertex_content = data_vertex_emb_comp->content;
-    int val_dim = query_vertex_emb_comp->column_size;
+        Value **query_vertex_content = query_vertex_emb_comp->content;
+        Value **data_vertex_content = data_vertex_emb_comp->content;
+        int val_dim = query_vertex_emb_comp->column_size;
 #endif
-    scores.resize(order_.size());
-    for(uint32_t u_depth=1;u_depth<order_.size();++u_depth){
-        Vertex u = order_[u_depth];
-        for(int i=0;i<order_.size();++i){
-            Vertex u_n = order_[i];
-            if(candidate_edges[u_depth][i] != NULL){
-                for(auto& p : candidate_edges[u_depth][i]->offset_map){
-                    // cout<<u<<":"<<p.first<<endl;
-                    scores[u_depth].insert({p.first, calc_score(query_vertex_content[u], data_vertex_content[p.first], val_dim)});
+        scores.resize(order_.size());
+        for(uint32_t u_depth=1;u_depth<order_.size();++u_depth){
+            Vertex u = order_[u_depth];
+            for(int i=0;i<order_.size();++i){
+                Vertex u_n = order_[i];
+                if(candidate_edges[u_depth][i] != NULL){
+                    for(auto& p : candidate_edges[u_depth][i]->offset_map){
+                        // cout<<u<<":"<<p.first<<endl;
+                        scores[u_depth].insert({p.first, calc_score(query_vertex_content[u], data_vertex_content[p.first], val_dim)});
+                    }
+                    break;
                 }
-                break;
             }
         }
     }
-#endif
 }
 
 void TrieEncoder::get_candidates(uint32_t u_depth, vector<Vertex>& result){
@@ -234,19 +244,17 @@ void TrieEncoder::get_candidates(uint32_t u_depth, vector<Vertex>& result){
     }
 }
 
-#if INDEX_ORDER == 1
-    void TrieEncoder::get_candidates_ordered(uint32_t u_depth, vector<Vertex>& result){
-        for(int i=0;i<order_.size();++i){
-            if(candidate_edges[u_depth][i] != NULL){
-                for(auto& p : candidate_edges[u_depth][i]->offset_map){
-                    result.push_back(p.first);
-                }
-                sort(result.begin(), result.end());
-                return;
+void TrieEncoder::get_candidates_ordered(uint32_t u_depth, vector<Vertex>& result){
+    for(int i=0;i<order_.size();++i){
+        if(candidate_edges[u_depth][i] != NULL){
+            for(auto& p : candidate_edges[u_depth][i]->offset_map){
+                result.push_back(p.first);
             }
+            sort(result.begin(), result.end());
+            return;
         }
     }
-#endif
+}
 
 Vertex* TrieEncoder::get_edge_candidate(uint32_t src_depth, uint32_t dst_depth, Vertex src_v, uint32_t& count){
     auto& p = candidate_edges[src_depth][dst_depth]->offset_map[src_v];
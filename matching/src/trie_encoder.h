@@ -3,6 +3,7 @@
 #include "../utility/relation/catalog.h"
 #include "../graph/graph.h"
 #include "../index/embedding.h"
+#include "../utility/run_config.h"
 
 #include <vector>
 #include <unordered_map>
@@ -12,9 +13,7 @@ public:
     uint32_t size_;
     unordered_map<Vertex, pair<Vertex*, uint32_t>> offset_map; // id -> start_offset, size
     Vertex* children_;
-#if INDEX_ORDER == 1
     float* scores_;
-#endif
     Vertex src_, dst_;
 
     TrieRelation(catalog* storage, Vertex src, Vertex dst);
@@ -37,10 +36,8 @@ public:
     void get_candidates(uint32_t u_depth, vector<Vertex>& result);
     Vertex* get_edge_candidate(uint32_t src_depth, uint32_t dst_depth, Vertex src_v, uint32_t& count);
 
-#if INDEX_ORDER == 1
-    vector<unordered_map<Vertex, float>> scores;
+    vector<unordered_map<Vertex, float>> scores; // filled only if RunConfig::index_order_ is set
     void get_candidates_ordered(uint32_t u_depth, vector<Vertex>& result);
-#endif
 
     ~TrieEncoder();
 };
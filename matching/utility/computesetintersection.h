@@ -2,6 +2,7 @@
 #define SUBGRAPHMATCHING_COMPUTE_SET_INTERSECTION_H
 
 #include "../configuration/config.h"
+#include "run_config.h"
 #include <immintrin.h>
 #include <x86intrin.h>
 
@@ -19,6 +20,23 @@ public:
     static void ComputeCandidates(const Vertex* larray, uint32_t l_count, const Vertex* rarray,
                                   uint32_t r_count, uint32_t &cn_count);
 
+    // Strategy fixed at compile time, for loops that dispatch on RunConfig::intersection_ once per query.
+    template<IntersectionMethod method>
+    static inline void ComputeCandidates(const Vertex* larray, uint32_t l_count, const Vertex* rarray,
+                                         uint32_t r_count, Vertex* cn, uint32_t &cn_count) {
+        if (method == HYBRID_INTERSECTION) {
+            return ComputeCandidates(larray, l_count, rarray, r_count, cn, cn_count);
+        }
+        merge_cnt_ += 1;
+#if SI == 0
+        ComputeCNMergeBasedAVX2(larray, l_count, rarray, r_count, cn, cn_count);
+#elif SI == 1
+        ComputeCNMergeBasedAVX512(larray, l_count, rarray, r_count, cn, cn_count);
+#elif SI == 2
+        ComputeCNNaiveStdMerge(larray, l_count, rarray, r_count, cn, cn_count);
+#endif
+    }
+
 #if SI == 0
     static void ComputeCNGallopingAVX2(const Vertex* larray, uint32_t l_count,
                                        const Vertex* rarray, uint32_t r_count, Vertex* cn,
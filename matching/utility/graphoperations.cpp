@@ -1,6 +1,7 @@
 #include "graphoperations.h"
 #include <memory.h>
 #include <queue>
+#include <algorithm>
 
 void GraphOperations::getKCore(const Graph *graph, int *core_table) {
     int vertices_count = graph->getVerticesCount();
@@ -160,3 +161,63 @@ void GraphOperations::compute_degeneracy_order(const Graph *graph, uint32_t *deg
     delete[] degree_bin;
     delete[] offset;
 }
+
+// Descending degree, so that the hubs, whose neighbor lists are intersected most often, are
+// stored together.
+void GraphOperations::compute_degree_order(const Graph *graph, uint32_t *order) {
+    uint32_t vertices_count = graph->getVerticesCount();
+    for (uint32_t i = 0; i < vertices_count; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order, order + vertices_count, [graph](const uint32_t u, const uint32_t v) -> bool {
+        return graph->getVertexDegree(u) > graph->getVertexDegree(v);
+    });
+}
+
+// Reverse Cuthill-McKee: a BFS per connected component, started from a vertex of minimum degree and
+// visiting the neighbors in ascending degree, reversed at the end. Neighbors get close ids, which
+// keeps the neighbor lists of adjacent vertices close in memory.
+void GraphOperations::compute_rcm_order(const Graph *graph, uint32_t *order) {
+    uint32_t vertices_count = graph->getVerticesCount();
+    uint32_t* by_degree = new uint32_t[vertices_count];
+    for (uint32_t i = 0; i < vertices_count; ++i) {
+        by_degree[i] = i;
+    }
+    auto degree_less = [graph](const uint32_t u, const uint32_t v) -> bool {
+        return graph->getVertexDegree(u) < graph->getVertexDegree(v);
+    };
+    std::stable_sort(by_degree, by_degree + vertices_count, degree_less);
+
+    std::vector<bool> visited(vertices_count, false);
+    std::vector<uint32_t> next;
+    next.reserve(graph->getGraphMaxDegree());
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < vertices_count; ++i) {
+        uint32_t root = by_degree[i];
+        if (visited[root]) {
+            continue;
+        }
+        visited[root] = true;
+        uint32_t head = count;
+        order[count++] = root;
+        while (head < count) {
+            uint32_t v = order[head++];
+            uint32_t nbrs_count;
+            const Vertex* nbrs = graph->getVertexNeighbors(v, nbrs_count);
+            next.clear();
+            for (uint32_t j = 0; j < nbrs_count; ++j) {
+                if (!visited[nbrs[j]]) {
+                    visited[nbrs[j]] = true;
+                    next.push_back(nbrs[j]);
+                }
+            }
+            std::stable_sort(next.begin(), next.end(), degree_less);
+            for (auto u : next) {
+                order[count++] = u;
+            }
+        }
+    }
+    std::reverse(order, order + vertices_count);
+
+    delete[] by_degree;
+}
@@ -6,6 +6,9 @@ class GraphOperations {
 public:
     static void getKCore(const Graph *graph, int *core_table);
     static void compute_degeneracy_order(const Graph* graph, uint32_t* degeneracy_order);
+    // vertex orders for relabeling the data graph, order[i] is the vertex that gets id i
+    static void compute_degree_order(const Graph* graph, uint32_t* order);
+    static void compute_rcm_order(const Graph* graph, uint32_t* order);
 private:
     static void dfs(TreeNode* tree, Vertex cur_vertex, Vertex* dfs_order, uint32_t& count);
 };
@@ -112,18 +112,6 @@ void nlf_filter::execute(catalog *storage) {
 void nlf_filter::filter_ordered_relation(uint32_t u, edge_relation *relation, uint32_t other) {
     uint32_t u_deg = query_graph_->getVertexDegree(u);
 
-#if ENABLE_PRE_FILTERING == 1
-#if COMPACT == 0
-    Value **query_vertex_content = query_vertex_emb->content;
-    Value **data_vertex_content = data_vertex_emb->content;
-    int val_dim = query_vertex_emb->column_size;
-#else
-    Value **query_vertex_content = query_vertex_emb_comp->content;
-    Value **data_vertex_content = data_vertex_emb_comp->content;
-    int val_dim = query_vertex_emb_comp->column_size;
-#endif
-#endif
-
 #if OPTIMIZED_LABELED_GRAPH == 1
     auto u_nlf = query_graph_->getVertexNLF(u);
     std::vector<std::pair<uint32_t, uint32_t>> nlf_array;
@@ -196,18 +184,6 @@ void nlf_filter::filter_unordered_relation(uint32_t u, edge_relation *relation,
     }
 #endif
 
-#if ENABLE_PRE_FILTERING == 1
-#if COMPACT == 0
-    Value **query_vertex_content = query_vertex_emb->content;
-    Value **data_vertex_content = data_vertex_emb->content;
-    int val_dim = query_vertex_emb->column_size;
-#else
-    Value **query_vertex_content = query_vertex_emb_comp->content;
-    Value **data_vertex_content = data_vertex_emb_comp->content;
-    int val_dim = query_vertex_emb_comp->column_size;
-#endif
-#endif
-
     uint32_t valid_edge_count = 0;
     for (uint32_t i = 0; i < relation->size_; ++i) {
         uint32_t v = relation->edges_[i].vertices_[1];
@@ -24,6 +24,10 @@ public:
         updated_.reserve(1024);
     }
 
+    void set_query_graph(Graph* query_graph) {
+        query_graph_ = query_graph;
+    }
+
     void execute(std::vector<std::vector<uint32_t>> &candidate_sets);
     void execute(catalog* storage);
 };
@@ -36,7 +36,7 @@ void scan::execute(std::vector<uint32_t> &src_candidate_set, std::vector<uint32_
     }
 
     relation->size_ = edge_count;
-    relation->edges_ = new edge[edge_count];
+    relation->edges_ = allocate_edges(edge_count);
     memcpy(relation->edges_, buffer_, sizeof(edge) * edge_count);
 
     for (auto u : dst_candidate_set) {
@@ -50,7 +50,7 @@ void scan::execute_with_index(uint32_t src_label, uint32_t dst_label, edge_relat
     if (data_graph_->getEdgeIndex()->contains(key)) {
         auto edges = data_graph_->getEdgeIndex()->at(key);
         relation->size_ = edges->size();
-        relation->edges_ = new edge[relation->size_];
+        relation->edges_ = allocate_edges(relation->size_);
         memcpy(relation->edges_, edges->data(), sizeof(edge) * relation->size_);
     }
     else {
@@ -83,6 +83,13 @@ void scan::execute_without_index(uint32_t src_label, uint32_t dst_label, edge_re
     }
 
     relation->size_ = edge_count;
-    relation->edges_ = new edge[edge_count];
+    relation->edges_ = allocate_edges(edge_count);
     memcpy(relation->edges_, buffer_, sizeof(edge) * edge_count);
 }
+
+edge* scan::allocate_edges(uint32_t size) {
+    if (arena_ != nullptr) {
+        return arena_->allocate(size);
+    }
+    return new edge[size];
+}
@@ -10,14 +10,18 @@ private:
     std::vector<bool> flag_;
     edge* buffer_;
     const Graph* data_graph_;
+    edge_arena* arena_;
 
 private:
     void execute_without_index(uint32_t src_label, uint32_t dst_label, edge_relation *relation);
     void execute_with_index(uint32_t src_label, uint32_t dst_label, edge_relation *relation);
+    edge* allocate_edges(uint32_t size);
 
 public:
-    scan(const Graph* data_graph) {
+    /// The output tuples are taken from arena if one is given, otherwise each relation owns its array.
+    scan(const Graph* data_graph, edge_arena* arena = nullptr) {
         data_graph_ = data_graph;
+        arena_ = arena;
         buffer_ = new edge[data_graph_->getEdgesCount() * 2];
         flag_.resize(data_graph->getVerticesCount(), false);
     }
@@ -26,6 +30,10 @@ public:
         delete[] buffer_;
     }
 
+    void set_arena(edge_arena* arena) {
+        arena_ = arena;
+    }
+
     void execute(uint32_t src_label, uint32_t dst_label, edge_relation *relation, bool indexed);
 
     void execute(std::vector<uint32_t>& src_candidate_set, std::vector<uint32_t>& dst_candidate_set, edge_relation *relation);
@@ -1,5 +1,7 @@
 #include "catalog.h"
 #include <vector>
+#include <cstring>
+#include <algorithm>
 
 void catalog::initialize_catalog_info() {
      for (uint32_t u = 0; u < num_sets_; ++u) {
@@ -16,7 +18,137 @@ void catalog::initialize_catalog_info() {
                     meta_info.type = EdgeType::TreeEdge;
                 }
                 catalog_info_.insert(std::make_pair(std::make_pair(u, v), meta_info));
+
+                relation_slots_[u][v] = static_cast<uint32_t>(hash_relations_.size());
+                relation_slots_[v][u] = static_cast<uint32_t>(hash_relations_.size()) + 1;
+                hash_relations_.resize(hash_relations_.size() + 2, nullptr);
             }
         }
     }
 }
+
+void catalog::reset(Graph *query_graph) {
+    // The tuples of the previous query live in the arena, detach them before rewinding it.
+    release_edge_relations();
+    release_lazy_relations();
+    arena_.reset();
+    catalog_info_.clear();
+
+    query_graph_ = query_graph;
+    num_sets_ = query_graph_->getVerticesCount();
+    if (num_sets_ > capacity_) {
+        reserve(num_sets_);
+    }
+
+    max_num_candidates_per_vertex_ = data_graph_->getGraphMaxLabelFrequency();
+    memset(num_candidates_, 0, sizeof(uint32_t) * num_sets_);
+    initialize_catalog_info();
+
+    trie_relations_.resize(hash_relations_.size(), nullptr);
+    encoded_trie_relations_.resize(hash_relations_.size(), nullptr);
+    bsr_relations_.resize(hash_relations_.size(), nullptr);
+}
+
+void catalog::reserve(uint32_t num_sets) {
+    release_relations();
+    capacity_ = num_sets;
+
+    candidate_sets_ = new uint32_t*[capacity_];
+    num_candidates_ = new uint32_t[capacity_];
+    edge_relations_ = new edge_relation*[capacity_];
+    relation_slots_ = new uint32_t*[capacity_];
+
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        candidate_sets_[i] = nullptr;
+        edge_relations_[i] = new edge_relation[capacity_];
+        relation_slots_[i] = new uint32_t[capacity_];
+        std::fill(relation_slots_[i], relation_slots_[i] + capacity_, INVALID_SLOT);
+    }
+}
+
+void catalog::release_relations() {
+    if (capacity_ == 0)
+        return;
+
+    for (uint32_t i = 0; i < capacity_; ++i) {
+        delete[] candidate_sets_[i];
+        delete[] edge_relations_[i];
+        delete[] relation_slots_[i];
+    }
+    delete[] num_candidates_;
+    delete[] candidate_sets_;
+    delete[] edge_relations_;
+    delete[] relation_slots_;
+    capacity_ = 0;
+}
+
+void catalog::release_edge_relations() {
+    // Only the query edges (u < v) are ever scanned, and they are exactly the keys of catalog_info_.
+    for (auto& element : catalog_info_) {
+        edge_relation& relation = edge_relations_[element.first.first][element.first.second];
+        relation.edges_ = nullptr;
+        relation.size_ = 0;
+    }
+}
+
+void catalog::release_lazy_relations() {
+    for (auto& element : catalog_info_) {
+        relation_slots_[element.first.first][element.first.second] = INVALID_SLOT;
+        relation_slots_[element.first.second][element.first.first] = INVALID_SLOT;
+    }
+
+    for (uint32_t i = 0; i < hash_relations_.size(); ++i) {
+        delete hash_relations_[i];
+        delete trie_relations_[i];
+        delete encoded_trie_relations_[i];
+        delete bsr_relations_[i];
+    }
+    hash_relations_.clear();
+    trie_relations_.clear();
+    encoded_trie_relations_.clear();
+    bsr_relations_.clear();
+}
+
+template<typename T>
+static T* get_or_create(std::vector<T*>& relations, uint32_t slot) {
+    if (slot == catalog::INVALID_SLOT)
+        return nullptr;
+
+    if (relations[slot] == nullptr) {
+        relations[slot] = new T();
+    }
+    return relations[slot];
+}
+
+hash_relation *catalog::get_hash_relation(uint32_t u, uint32_t v) {
+    return get_or_create(hash_relations_, relation_slots_[u][v]);
+}
+
+trie_relation *catalog::get_trie_relation(uint32_t u, uint32_t v) {
+    return get_or_create(trie_relations_, relation_slots_[u][v]);
+}
+
+encoded_trie_relation *catalog::get_encoded_trie_relation(uint32_t u, uint32_t v) {
+    return get_or_create(encoded_trie_relations_, relation_slots_[u][v]);
+}
+
+BSRGraph *catalog::get_bsr_relation(uint32_t u, uint32_t v) {
+    return get_or_create(bsr_relations_, relation_slots_[u][v]);
+}
+
+uint64_t catalog::memory_cost() {
+    uint64_t memory_cost = 0;
+    for (auto& element : catalog_info_) {
+        memory_cost += edge_relations_[element.first.first][element.first.second].memory_cost();
+    }
+
+    for (uint32_t i = 0; i < hash_relations_.size(); ++i) {
+        if (hash_relations_[i] != nullptr)
+            memory_cost += hash_relations_[i]->memory_cost();
+        if (trie_relations_[i] != nullptr)
+            memory_cost += trie_relations_[i]->memory_cost();
+        if (encoded_trie_relations_[i] != nullptr)
+            memory_cost += encoded_trie_relations_[i]->memory_cost();
+    }
+    return memory_cost;
+}
@@ -37,61 +37,78 @@ public:
     Graph* query_graph_;
     Graph* data_graph_;
 
-    hash_relation** hash_relations_;
-    trie_relation** trie_relations_;
-    encoded_trie_relation** encoded_trie_relations_;
-    BSRGraph** bsr_relations_;
     edge_relation** edge_relations_;
 
+private:
+    // number of query vertices the matrices are allocated for
+    uint32_t capacity_;
+    // owns the tuples of edge_relations_
+    edge_arena arena_;
+
+    /**
+     * The other relation kinds are built on first access, and only for query edges:
+     * relation_slots_[u][v] is the slot of the directed edge (u, v), or INVALID_SLOT for non-edges.
+     */
+    uint32_t** relation_slots_;
+    std::vector<hash_relation*> hash_relations_;
+    std::vector<trie_relation*> trie_relations_;
+    std::vector<encoded_trie_relation*> encoded_trie_relations_;
+    std::vector<BSRGraph*> bsr_relations_;
+
 private:
     void initialize_catalog_info();
 
+    void reserve(uint32_t num_sets);
+
+    void release_relations();
+
+    void release_edge_relations();
+
+    void release_lazy_relations();
+
 public:
-    explicit catalog(Graph* query_graph, Graph* data_graph) {
-        query_graph_ = query_graph;
+    /**
+     * A catalog bound to the data graph only. Call reset() before each query; the storage of the
+     * previous query is recycled, so one catalog per thread serves any number of queries.
+     */
+    explicit catalog(Graph* data_graph) {
+        query_graph_ = nullptr;
         data_graph_ = data_graph;
-        num_sets_ = query_graph_->getVerticesCount();
+        num_sets_ = 0;
+        capacity_ = 0;
         max_num_candidates_per_vertex_ = data_graph->getGraphMaxLabelFrequency();
         max_data_vertex_id_ = data_graph->getVerticesCount();
 
-        candidate_sets_ = new uint32_t*[num_sets_];
-        num_candidates_ = new uint32_t[num_sets_];
-        edge_relations_ = new edge_relation*[num_sets_];
-        hash_relations_ = new hash_relation*[num_sets_];
-        trie_relations_ = new trie_relation*[num_sets_];
-        encoded_trie_relations_ = new encoded_trie_relation*[num_sets_];
-        bsr_relations_ = new BSRGraph*[num_sets_];
-
-        for (uint32_t i = 0; i < num_sets_; ++i) {
-            candidate_sets_[i] = nullptr;
-            edge_relations_[i] = new edge_relation[num_sets_];
-            hash_relations_[i] = new hash_relation[num_sets_];
-            trie_relations_[i] = new trie_relation[num_sets_];
-            encoded_trie_relations_[i] = new encoded_trie_relation[num_sets_];
-            bsr_relations_[i] = new BSRGraph[num_sets_];
-        }
+        candidate_sets_ = nullptr;
+        num_candidates_ = nullptr;
+        edge_relations_ = nullptr;
+        relation_slots_ = nullptr;
+    }
 
-        initialize_catalog_info();
+    explicit catalog(Graph* query_graph, Graph* data_graph) : catalog(data_graph) {
+        reset(query_graph);
     }
 
     ~catalog() {
-        for (uint32_t i = 0; i < num_sets_; ++i) {
-            delete[] candidate_sets_[i];
-            delete[] edge_relations_[i];
-            delete[] hash_relations_[i];
-            delete[] trie_relations_[i];
-            delete[] encoded_trie_relations_[i];
-            delete[] bsr_relations_[i];
-        }
-        delete[] num_candidates_;
-        delete[] candidate_sets_;
-        delete[] edge_relations_;
-        delete[] hash_relations_;
-        delete[] trie_relations_;
-        delete[] encoded_trie_relations_;
-        delete[] bsr_relations_;
+        release_edge_relations();
+        release_lazy_relations();
+        release_relations();
+    }
+
+    void reset(Graph* query_graph);
+
+    edge_arena* get_arena() {
+        return &arena_;
     }
 
+    static const uint32_t INVALID_SLOT = 0xffffffff;
+
+    // nullptr if (u, v) is not a query edge
+    hash_relation* get_hash_relation(uint32_t u, uint32_t v);
+    trie_relation* get_trie_relation(uint32_t u, uint32_t v);
+    encoded_trie_relation* get_encoded_trie_relation(uint32_t u, uint32_t v);
+    BSRGraph* get_bsr_relation(uint32_t u, uint32_t v);
+
     uint32_t get_edge_relation_cardinality(uint32_t u, uint32_t v) {
         uint32_t src = std::min(u, v);
         uint32_t dst = std::max(u, v);
@@ -112,34 +129,34 @@ public:
 
     uint32_t get_cardinality(uint32_t bn, uint32_t u) {
 #if RELATION_STRUCTURE == 0
-        return encoded_trie_relations_[bn][u].get_cardinality();
+        return get_encoded_trie_relation(bn, u)->get_cardinality();
 #elif RELATION_STRUCTURE == 1
-        return hash_relations_[bn][u].get_cardinality();
+        return get_hash_relation(bn, u)->get_cardinality();
 #elif RELATION_STRUCTURE == 2
-        return trie_relations_[bn][u].get_cardinality();
+        return get_trie_relation(bn, u)->get_cardinality();
 #endif
     }
 
     uint32_t get_max_degree(uint32_t bn, uint32_t u) {
 #if RELATION_STRUCTURE == 0
         if (query_graph_->getCoreValue(bn) > 1 && query_graph_->getCoreValue(u) > 1)
-            return encoded_trie_relations_[bn][u].max_degree();
+            return get_encoded_trie_relation(bn, u)->max_degree();
         else
-            return hash_relations_[bn][u].max_degree();
+            return get_hash_relation(bn, u)->max_degree();
 #elif RELATION_STRUCTURE == 1
-        return hash_relations_[bn][u].max_degree();
+        return get_hash_relation(bn, u)->max_degree();
 #elif RELATION_STRUCTURE == 2
-        return trie_relations_[bn][u].max_degree();
+        return get_trie_relation(bn, u)->max_degree();
 #endif
     }
 
     uint32_t get_size(uint32_t bn, uint32_t u) {
 #if RELATION_STRUCTURE == 0
-        return encoded_trie_relations_[bn][u].get_size();
+        return get_encoded_trie_relation(bn, u)->get_size();
 #elif RELATION_STRUCTURE == 1
-        return hash_relations_[bn][u].get_size();
+        return get_hash_relation(bn, u)->get_size();
 #elif RELATION_STRUCTURE == 2
-        return trie_relations_[bn][u].get_size();
+        return get_trie_relation(bn, u)->get_size();
 #endif
     }
 
@@ -149,35 +166,35 @@ public:
 
     uint32_t* get_non_core_relation_children(uint32_t bn, uint32_t u, uint32_t key, uint32_t &count) {
 #if RELATION_STRUCTURE == 0
-        return hash_relations_[bn][u].get_children(key, count);
+        return get_hash_relation(bn, u)->get_children(key, count);
 #elif RELATION_STRUCTURE == 1
-        return hash_relations_[bn][u].get_children(key, count);
+        return get_hash_relation(bn, u)->get_children(key, count);
 #elif RELATION_STRUCTURE == 2
-        return trie_relations_[bn][u].get_children(key, count);
+        return get_trie_relation(bn, u)->get_children(key, count);
 #endif
     }
 
     uint32_t* get_core_relation_children(uint32_t bn, uint32_t u, uint32_t key, uint32_t &count) {
 #if RELATION_STRUCTURE == 0
-        return encoded_trie_relations_[bn][u].get_children(key, count);
+        return get_encoded_trie_relation(bn, u)->get_children(key, count);
 #elif RELATION_STRUCTURE == 1
-        return hash_relations_[bn][u].get_children(key, count);
+        return get_hash_relation(bn, u)->get_children(key, count);
 #elif RELATION_STRUCTURE == 2
-        return trie_relations_[bn][u].get_children(key, count);
+        return get_trie_relation(bn, u)->get_children(key, count);
 #endif
     }
 
     BSRSet get_core_relation_bsr_set(uint32_t bn, uint32_t u, uint32_t key) {
 #if RELATION_STRUCTURE == 0
-        return bsr_relations_[bn][u].bsrs[key];
+        return get_bsr_relation(bn, u)->bsrs[key];
 #elif RELATION_STRUCTURE == 1
-        if (!hash_relations_[bn][u].contains(key))
+        if (!get_hash_relation(bn, u)->contains(key))
             return BSRSet();
-        return bsr_relations_[bn][u].hash_bsrs_[key];
+        return get_bsr_relation(bn, u)->hash_bsrs_[key];
 #elif RELATION_STRUCTURE == 2
-        if (!trie_relations_[bn][u].contains(key))
+        if (!get_trie_relation(bn, u)->contains(key))
             return BSRSet();
-        return bsr_relations_[bn][u].hash_bsrs_[key];
+        return get_bsr_relation(bn, u)->hash_bsrs_[key];
 #endif
     }
 
@@ -185,6 +202,10 @@ public:
         return query_graph_->checkEdgeExistence(u, v);
     }
 
+    /**
+     * Bytes held by the relations of the current query: the edge relations plus every relation
+     * built on demand. The slack of the edge arena is not counted, see edge_arena::memory_cost().
+     */
     uint64_t memory_cost();
 
     // void print_cardinality();
@@ -2,6 +2,8 @@
 #define SUBGRAPHMATCHING_EDGE_RELATION_H
 
 #include <cstdint>
+#include <vector>
+#include <algorithm>
 #include "../../configuration/config.h"
 
 
@@ -20,4 +22,54 @@ public:
     }
 };
 
+/// Bump allocator for the tuples of edge relations. Blocks are kept on reset(), so a catalog reused
+/// across queries stops allocating once it has seen its largest query.
+class edge_arena {
+private:
+    std::vector<edge*> blocks_;
+    std::vector<uint64_t> block_sizes_;
+    uint32_t block_id_;
+    uint64_t offset_;
+
+public:
+    edge_arena() : block_id_(0), offset_(0) {}
+    ~edge_arena() {
+        for (auto block : blocks_) {
+            delete [] block;
+        }
+    }
+
+    edge* allocate(uint64_t size) {
+        while (block_id_ < blocks_.size() && offset_ + size > block_sizes_[block_id_]) {
+            block_id_ += 1;
+            offset_ = 0;
+        }
+
+        if (block_id_ == blocks_.size()) {
+            uint64_t block_size = blocks_.empty() ? 1 << 16 : block_sizes_.back() * 2;
+            block_size = std::max(block_size, size);
+            blocks_.push_back(new edge[block_size]);
+            block_sizes_.push_back(block_size);
+            offset_ = 0;
+        }
+
+        edge* result = blocks_[block_id_] + offset_;
+        offset_ += size;
+        return result;
+    }
+
+    void reset() {
+        block_id_ = 0;
+        offset_ = 0;
+    }
+
+    uint64_t memory_cost() {
+        uint64_t cost = 0;
+        for (auto block_size : block_sizes_) {
+            cost += sizeof(edge) * block_size;
+        }
+        return cost;
+    }
+};
+
 #endif //SUBGRAPHMATCHING_EDGE_RELATION_H
@@ -0,0 +1,195 @@
+#include "run_config.h"
+#include <fstream>
+#include <iostream>
+
+RunConfig run_config;
+
+static bool parse_bool(const std::string& value, bool& result){
+    if(value == "1" || value == "true" || value == "on"){
+        result = true;
+    }else if(value == "0" || value == "false" || value == "off"){
+        result = false;
+    }else{
+        return false;
+    }
+    return true;
+}
+
+static bool parse_uint(const std::string& value, uint32_t& result){
+    if(value.empty() || value.find_first_not_of("0123456789") != std::string::npos){
+        return false;
+    }
+    result = std::stoul(value);
+    return true;
+}
+
+static bool parse_double(const std::string& value, double& result){
+    char* end;
+    double parsed = strtod(value.c_str(), &end);
+    if(value.empty() || *end != '\0'){
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+static std::string trim(const std::string& str){
+    size_t begin = str.find_first_not_of(" \t\r");
+    if(begin == std::string::npos){
+        return std::string();
+    }
+    size_t end = str.find_last_not_of(" \t\r");
+    return str.substr(begin, end-begin+1);
+}
+
+RunConfig::RunConfig(){
+    pre_filtering_ = ENABLE_PRE_FILTERING == 1;
+    column_filter_ = COLUMN_FILTER == 1;
+    filter_cost_model_ = FILTER_COST_MODEL == 1;
+    index_order_ = INDEX_ORDER == 1;
+    order_by_cost_ = true;
+    race_orders_ = false;
+    race_top_k_ = 3;
+    race_state_budget_ = 20000;
+    race_margin_ = 4;
+    plan_cache_ = true;
+    plan_cache_capacity_ = 1024;
+    query_emb_cache_ = true;
+    query_emb_cache_capacity_ = 1024;
+    intersection_ = HYBRID_INTERSECTION;
+    print_result_ = PRINT_RESULT == 1;
+    print_mem_info_ = PRINT_MEM_INFO == 1;
+    time_limit_ = TIME_LIMIT;
+}
+
+bool RunConfig::set(const std::string& key, const std::string& value){
+    if(key == "pre_filtering"){
+        return parse_bool(value, pre_filtering_);
+    }else if(key == "column_filter"){
+        return parse_bool(value, column_filter_);
+    }else if(key == "filter_cost_model"){
+        return parse_bool(value, filter_cost_model_);
+    }else if(key == "index_order"){
+        return parse_bool(value, index_order_);
+    }else if(key == "order_by_cost"){
+        return parse_bool(value, order_by_cost_);
+    }else if(key == "race_orders"){
+        return parse_bool(value, race_orders_);
+    }else if(key == "race_top_k"){
+        return parse_uint(value, race_top_k_);
+    }else if(key == "race_state_budget"){
+        return parse_uint(value, race_state_budget_);
+    }else if(key == "race_margin"){
+        return parse_double(value, race_margin_);
+    }else if(key == "plan_cache"){
+        return parse_bool(value, plan_cache_);
+    }else if(key == "plan_cache_capacity"){
+        return parse_uint(value, plan_cache_capacity_);
+    }else if(key == "query_emb_cache"){
+        return parse_bool(value, query_emb_cache_);
+    }else if(key == "query_emb_cache_capacity"){
+        return parse_uint(value, query_emb_cache_capacity_);
+    }else if(key == "intersection"){
+        if(value == "hybrid"){
+            intersection_ = HYBRID_INTERSECTION;
+        }else if(value == "merge"){
+            intersection_ = MERGE_INTERSECTION;
+        }else{
+            return false;
+        }
+        return true;
+    }else if(key == "print_result"){
+        return parse_bool(value, print_result_);
+    }else if(key == "print_mem_info"){
+        return parse_bool(value, print_mem_info_);
+    }else if(key == "time_limit"){
+        return parse_uint(value, time_limit_);
+    }
+    return false;
+}
+
+bool RunConfig::set(const std::string& assignment){
+    size_t pos = assignment.find('=');
+    if(pos == std::string::npos){
+        return false;
+    }
+    return set(trim(assignment.substr(0, pos)), trim(assignment.substr(pos+1)));
+}
+
+bool RunConfig::load(const std::string& file){
+    std::ifstream fin(file);
+    if(!fin.is_open()){
+        std::cout<<"cannot open config file "<<file<<std::endl;
+        return false;
+    }
+    std::string line;
+    uint32_t line_id = 0;
+    bool valid = true;
+    while(getline(fin, line)){
+        line_id ++;
+        size_t comment = line.find('#');
+        if(comment != std::string::npos){
+            line = line.substr(0, comment);
+        }
+        line = trim(line);
+        if(line.empty()){
+            continue;
+        }
+        if(set(line) == false){
+            std::cout<<file<<":"<<line_id<<": invalid option '"<<line<<"'"<<std::endl;
+            valid = false;
+        }
+    }
+    return valid;
+}
+
+void RunConfig::resolve(){
+#if ENABLE_PRE_FILTERING == 0 || GNN_PRUNING_MARGIN > 0
+    pre_filtering_ = false;
+#endif
+#if COMPACT == 0 || COLUMN_FILTER == 0
+    column_filter_ = false;
+#endif
+#if FILTER_COST_MODEL == 0
+    filter_cost_model_ = false;
+#endif
+    // both read the PPC embeddings
+    if(pre_filtering_ == false){
+        column_filter_ = false;
+        index_order_ = false;
+    }
+}
+
+std::vector<std::pair<std::string, std::string>> RunConfig::entries() const{
+    return {
+        {"pre_filtering", std::to_string(pre_filtering_)},
+        {"column_filter", std::to_string(column_filter_)},
+        {"filter_cost_model", std::to_string(filter_cost_model_)},
+        {"index_order", std::to_string(index_order_)},
+        {"order_by_cost", std::to_string(order_by_cost_)},
+        {"race_orders", std::to_string(race_orders_)},
+        {"race_top_k", std::to_string(race_top_k_)},
+        {"race_state_budget", std::to_string(race_state_budget_)},
+        {"race_margin", std::to_string(race_margin_)},
+        {"plan_cache", std::to_string(plan_cache_)},
+        {"plan_cache_capacity", std::to_string(plan_cache_capacity_)},
+        {"query_emb_cache", std::to_string(query_emb_cache_)},
+        {"query_emb_cache_capacity", std::to_string(query_emb_cache_capacity_)},
+        {"intersection", intersection_ == HYBRID_INTERSECTION ? "hybrid" : "merge"},
+        {"print_result", std::to_string(print_result_)},
+        {"print_mem_info", std::to_string(print_mem_info_)},
+        {"time_limit", std::to_string(time_limit_)},
+    };
+}
+
+std::ostream& operator<<(std::ostream& out, const RunConfig& config){
+    bool first = true;
+    for(auto& entry : config.entries()){
+        if(!first){
+            out<<",";
+        }
+        out<<entry.first<<"="<<entry.second;
+        first = false;
+    }
+    return out;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <ostream>
+
+#include "../configuration/config.h"
+
+enum IntersectionMethod{
+    HYBRID_INTERSECTION, // galloping for skewed pairs, merge otherwise
+    MERGE_INTERSECTION
+};
+
+/**
+ * Behaviour that can be switched without rebuilding. The macros in config.h still decide what is
+ * compiled in (ENABLE_PRE_FILTERING, COMPACT, COLUMN_FILTER, ...) and give the defaults; the fields
+ * below select among the compiled variants. Hot loops are instantiated once per variant and picked
+ * once per query, so a switch costs nothing per search state.
+ *
+ * Sources, later ones win: defaults, `--config <file>` (one key=value per line, '#' comments),
+ * `--set key=value`.
+ */
+class RunConfig{
+public:
+    bool pre_filtering_;      // PPC vertex and edge filtering, needs the index
+    bool column_filter_;      // feature-major scan for the PPC vertex check
+    bool filter_cost_model_;  // choose filters per query, otherwise run all of them
+    bool index_order_;        // visit candidates by PPC score
+    bool order_by_cost_;      // rank the nd orders by estimated search states instead of backward neighbors
+    bool race_orders_;        // race the top orders briefly before committing to one, off by default
+    uint32_t race_top_k_;     // at most this many orders are raced
+    uint32_t race_state_budget_; // search states per raced order
+    double race_margin_;      // only orders estimated within this factor of the best are raced
+    bool plan_cache_;         // reuse the orders of isomorphic earlier queries
+    uint32_t plan_cache_capacity_; // plans kept, least recently used ones are dropped
+    bool query_emb_cache_;    // reuse the PPC embeddings of isomorphic earlier queries
+    uint32_t query_emb_cache_capacity_;
+    IntersectionMethod intersection_;
+    bool print_result_;
+    bool print_mem_info_;
+    uint32_t time_limit_;     // enumeration time limit, unit: s
+
+    RunConfig();
+
+    // false if the key is unknown or the value is malformed
+    bool set(const std::string& key, const std::string& value);
+    bool set(const std::string& assignment);
+    bool load(const std::string& file);
+
+    // drops options whose prerequisites are switched off or not compiled in
+    void resolve();
+
+    std::vector<std::pair<std::string, std::string>> entries() const;
+};
+
+std::ostream& operator<<(std::ostream& out, const RunConfig& config);
+
+extern RunConfig run_config;
@@ -13,6 +13,9 @@
 
 #define OPTIMIZE 0
 
+// the header of the compressed index files of run_build_index --compress 1, which are not read here
+#define INDEX_CODEC_MAGIC 0x5a435050 // "PPCZ"
+
 using namespace std;
 
 
@@ -250,9 +253,15 @@ public:
     vector<size_t> offset_dim_map;
 
     Index_manager(string filename_){
-        ifstream fin(filename_);
+        ifstream fin(filename_, ios::binary);
         is_scaned = false;
         filename = filename_;
+        uint32_t magic = 0;
+        fin.read((char*)&magic, sizeof(uint32_t));
+        if(fin.good() && magic == INDEX_CODEC_MAGIC){
+            cout<<"[ERROR] "<<filename<<" is a compressed index, subgraph retrieval reads uncompressed indices only; rebuild it without --compress"<<endl;
+            exit(-1);
+        }
         fin.close();
     }
     Index_manager(){};